@@ -1,3 +1,3 @@
 CONFIG   += ordered
 TEMPLATE  = subdirs
-SUBDIRS   = src
+SUBDIRS   = src verifier tests
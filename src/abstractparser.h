@@ -25,35 +25,16 @@
 #include <QObject>
 #include <QVector>
 #include <QList>
-#include <QMap>
+
+#include <atomic>
 
 #include "logitem.h"
+#include "tooltable.h"
 
 
 class QFile;
 
 
-class AbstractTool
-{
-public:
-    AbstractTool()
-        : _id(0)
-        , _diameter(0)
-    {
-    }
-
-    int id() const { return _id; }
-    int diameter() const { return _diameter; }
-
-private:
-    int _id;
-    int _diameter;
-
-    friend class ExcellonParser;
-    friend class HpglParser;
-};
-
-
 class AbstractCurve
 {
 public:
@@ -64,9 +45,18 @@ public:
         CurveTypeCurve
     };
 
+    // The motion that arrives at a vertex
+    enum Motion
+    {
+        MotionLinear = 0,
+        MotionClockwise,
+        MotionCounterClockwise
+    };
+
     AbstractCurve()
         : _type(CurveTypeNone)
         , _tool(0)
+        , _line(0)
     {
     }
 
@@ -75,26 +65,69 @@ public:
     }
 
     int tool() const { return _tool; }
+    int line() const { return _line; }
     int count() const { return qMin(_x.size(), _y.size()); }
 
     const qint64* x() const { return _x.data(); }
     const qint64* y() const { return _y.data(); }
 
+    bool hasArcs() const { return !_motion.isEmpty(); }
+    int motion(int index) const { return _motion.isEmpty() ? MotionLinear : _motion[index]; }
+    qint64 centerX(int index) const { return _motion.isEmpty() ? 0 : _centerX[index]; }
+    qint64 centerY(int index) const { return _motion.isEmpty() ? 0 : _centerY[index]; }
+
     CurveType type() const { return _type; }
 
 private:
     QVector<qint64> _x;
     QVector<qint64> _y;
 
+    // Filled only for the curves that contain arcs
+    QVector<int> _motion;
+    QVector<qint64> _centerX;
+    QVector<qint64> _centerY;
+
     QString _stringX;
     QString _stringY;
 
     CurveType _type;
 
     int _tool;
+    int _line;
 
     friend class ExcellonParser;
     friend class HpglParser;
+    friend class GeometryTransform;
+};
+
+
+// The copies of the curves [first, last): the copy k = 1..count is moved by k times
+// the offset (in micrometres). The parsers keep the repeated geometry once, the
+// consumers expand the copies while they walk the curves.
+class CurveRepeat
+{
+public:
+    CurveRepeat()
+        : first(0)
+        , last(0)
+        , count(0)
+        , x(0)
+        , y(0)
+        , line(0)
+    {
+    }
+
+    int copies() const { return (last - first) * count; }
+
+    int first;
+    int last;
+    int count;
+
+    qint64 x;
+    qint64 y;
+
+    // The line of the repeat command, it is the line of all the copies
+    int line;
 };
 
 
@@ -122,8 +155,12 @@ public:
     virtual void clear() = 0;
     virtual bool parse(QFile& file) = 0;
 
-    virtual const QMap<int, AbstractTool>& tools() const = 0;
+    virtual const ToolTable& tools() const = 0;
     virtual const QList<AbstractCurve>& curves() const = 0;
+    virtual const QVector<CurveRepeat>& repeats() const;
+
+    // While parsing, the number of the first curves that will not change anymore
+    virtual int settledCount() const { return curves().size(); }
 
     void error(const QString& description, const QString& line = QString());
     void warning(const QString& description, const QString& line = QString());
@@ -143,10 +180,18 @@ signals:
 
 protected:
     int _lineNumber;
-    bool _interrupted;
+
+    // Set from the GUI thread while the file is parsed on a pool thread
+    std::atomic<bool> _interrupted;
 };
 
 
+inline const QVector<CurveRepeat>& AbstractParser::repeats() const
+{
+    static const QVector<CurveRepeat> none;
+    return none;
+}
+
 inline void AbstractParser::error(const QString& description, const QString& line)
 {
     emit log(LogItem::SeverityError, description,
@@ -0,0 +1,279 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "arcfitter.h"
+
+#include <QtConcurrent>
+#include <QtMath>
+
+
+namespace
+{
+
+// Longer arcs gain nothing and the R form is ambiguous beyond a half circle
+const double MaximumSweep = M_PI * 17.0 / 18.0;
+
+// Nearly straight runs are left to the polyline simplification
+const double MaximumRadius = 1000000.0;
+
+// Controllers reject the arcs whose end radius differs from the start one
+const double RadiusMismatch = 2.0;
+
+// A run that hardly bends is a straight line
+bool isFlat(const PathNode& start, const PathNode& arc, double tolerance)
+{
+    double sx = static_cast<double>(start.x - arc.centerX);
+    double sy = static_cast<double>(start.y - arc.centerY);
+    double dx = static_cast<double>(arc.x - start.x);
+    double dy = static_cast<double>(arc.y - start.y);
+
+    double radius = qSqrt(sx * sx + sy * sy);
+    double chord = qSqrt(dx * dx + dy * dy) / 2.0;
+
+    return radius - qSqrt(qMax(0.0, radius * radius - chord * chord)) <= tolerance;
+}
+
+int countArcs(const QVector<MillPath>& paths)
+{
+    int count = 0;
+
+    for (int i = 0; i < paths.size(); ++i)
+    {
+        const QVector<PathNode>& nodes = paths[i].nodes;
+
+        for (int j = 0; j < nodes.size(); ++j)
+        {
+            if (nodes[j].isArc())
+                ++count;
+        }
+    }
+
+    return count;
+}
+
+} // namespace
+
+
+int ArcFitter::fit(MillPath& path, qint64 tolerance)
+{
+    QVector<PathNode>& nodes = path.nodes;
+
+    if (nodes.size() < 4 || tolerance <= 0)
+        return 0;
+
+    QVector<PathNode> result;
+    result.reserve(nodes.size());
+    result.append(nodes[0]);
+
+    int arcs = 0;
+    int first = 0;
+
+    while (first < nodes.size() - 1)
+    {
+        PathNode arc;
+        int last = -1;
+
+        // Extend the arc while the nodes keep fitting, an arc spans three segments at least
+        for (int end = first + 3; end < nodes.size(); ++end)
+        {
+            PathNode candidate;
+
+            if (!fitRange(nodes, first, end, static_cast<double>(tolerance), candidate))
+                break;
+
+            arc = candidate;
+            last = end;
+        }
+
+        if (last < 0 || isFlat(nodes[first], arc, static_cast<double>(tolerance)))
+        {
+            result.append(nodes[++first]);
+            continue;
+        }
+
+        result.append(arc);
+        first = last;
+        ++arcs;
+    }
+
+    nodes.swap(result);
+
+    return arcs;
+}
+
+int ArcFitter::fit(QVector<MillPath>& paths, qint64 tolerance)
+{
+    int before = countArcs(paths);
+
+    QtConcurrent::blockingMap(paths, [tolerance](MillPath& path)
+    {
+        fit(path, tolerance);
+    });
+
+    return countArcs(paths) - before;
+}
+
+void ArcFitter::tessellate(MillPath& path, double chordAngle)
+{
+    QVector<PathNode>& nodes = path.nodes;
+
+    QVector<PathNode> result;
+    result.reserve(nodes.size());
+
+    double chord = qDegreesToRadians(qMax(0.1, chordAngle));
+
+    for (int i = 0; i < nodes.size(); ++i)
+    {
+        const PathNode& node = nodes[i];
+
+        if (i == 0 || !node.isArc())
+        {
+            result.append(node);
+            continue;
+        }
+
+        const PathNode& previous = nodes[i - 1];
+
+        double sx = static_cast<double>(previous.x - node.centerX);
+        double sy = static_cast<double>(previous.y - node.centerY);
+        double ex = static_cast<double>(node.x - node.centerX);
+        double ey = static_cast<double>(node.y - node.centerY);
+
+        double radius = qSqrt(sx * sx + sy * sy);
+        double start = qAtan2(sy, sx);
+        double sweep = qAtan2(ey, ex) - start;
+
+        // Coincident end points describe a full circle
+        if (node.motion == PathNode::MotionCounterClockwise)
+        {
+            if (sweep <= 0.0)
+                sweep += 2.0 * M_PI;
+        }
+        else
+        {
+            if (sweep >= 0.0)
+                sweep -= 2.0 * M_PI;
+        }
+
+        int steps = qMax(1, qCeil(qAbs(sweep) / chord));
+
+        for (int j = 1; j < steps; ++j)
+        {
+            result.append(PathNode(node.centerX + qRound64(radius * qCos(start + sweep * j / steps)),
+                node.centerY + qRound64(radius * qSin(start + sweep * j / steps))));
+        }
+
+        result.append(PathNode(node.x, node.y));
+    }
+
+    nodes.swap(result);
+}
+
+bool ArcFitter::fitRange(const QVector<PathNode>& nodes, int first, int last, double tolerance,
+    PathNode& arc)
+{
+    const PathNode& start = nodes[first];
+    const PathNode& middle = nodes[(first + last) / 2];
+    const PathNode& end = nodes[last];
+
+    // Circle through the start, middle and end nodes
+    double bx = static_cast<double>(middle.x - start.x);
+    double by = static_cast<double>(middle.y - start.y);
+    double cx = static_cast<double>(end.x - start.x);
+    double cy = static_cast<double>(end.y - start.y);
+
+    double determinant = 2.0 * (bx * cy - by * cx);
+
+    if (qAbs(determinant) < 1.0)
+        return false;
+
+    double b2 = bx * bx + by * by;
+    double c2 = cx * cx + cy * cy;
+
+    double ux = (cy * b2 - by * c2) / determinant;
+    double uy = (bx * c2 - cx * b2) / determinant;
+
+    if (qAbs(ux) > MaximumRadius || qAbs(uy) > MaximumRadius)
+        return false;
+
+    // The center is rounded to the coordinate grid like any other output value
+    qint64 centerX = start.x + qRound64(ux);
+    qint64 centerY = start.y + qRound64(uy);
+
+    double sx = static_cast<double>(start.x - centerX);
+    double sy = static_cast<double>(start.y - centerY);
+    double radius = qSqrt(sx * sx + sy * sy);
+
+    if (radius > MaximumRadius)
+        return false;
+
+    double direction = determinant > 0.0 ? 1.0 : -1.0;
+    double sweep = 0.0;
+
+    for (int i = first; i < last; ++i)
+    {
+        const PathNode& p = nodes[i];
+        const PathNode& q = nodes[i + 1];
+
+        if (q.isArc())
+            return false;
+
+        double px = static_cast<double>(p.x - centerX);
+        double py = static_cast<double>(p.y - centerY);
+        double qx = static_cast<double>(q.x - centerX);
+        double qy = static_cast<double>(q.y - centerY);
+
+        // Radial deviation of the node
+        if (qAbs(qSqrt(qx * qx + qy * qy) - radius) > tolerance)
+            return false;
+
+        // Every segment must advance in the direction of the arc
+        double angle = qAtan2(px * qy - py * qx, px * qx + py * qy) * direction;
+
+        if (angle <= 0.0)
+            return false;
+
+        sweep += angle;
+
+        // Deviation of the segment from the arc between its nodes
+        double dx = static_cast<double>(q.x - p.x);
+        double dy = static_cast<double>(q.y - p.y);
+        double half = qSqrt(dx * dx + dy * dy) / 2.0;
+
+        if (half >= radius || radius - qSqrt(radius * radius - half * half) > tolerance)
+            return false;
+    }
+
+    if (sweep > MaximumSweep)
+        return false;
+
+    double ex = static_cast<double>(end.x - centerX);
+    double ey = static_cast<double>(end.y - centerY);
+
+    if (qAbs(qSqrt(ex * ex + ey * ey) - radius) > RadiusMismatch)
+        return false;
+
+    arc = end;
+    arc.motion = direction > 0.0 ? PathNode::MotionCounterClockwise : PathNode::MotionClockwise;
+    arc.centerX = centerX;
+    arc.centerY = centerY;
+
+    return true;
+}
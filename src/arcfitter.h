@@ -0,0 +1,50 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef ARCFITTER_H
+#define ARCFITTER_H
+
+
+#include <QVector>
+
+#include "millpath.h"
+
+
+class ArcFitter
+{
+public:
+    // Replaces runs of linear nodes that lie within the tolerance (in micrometres)
+    // of a circular arc by a single arc node. The end points of the arcs are the
+    // original integer nodes, so the contours stay closed. Returns the number of arcs.
+    static int fit(MillPath& path, qint64 tolerance);
+
+    // Fits the arcs of all paths in parallel and returns the number of arcs
+    static int fit(QVector<MillPath>& paths, qint64 tolerance);
+
+    // Replaces the arcs by chords spanning the angle (in degrees) at most
+    static void tessellate(MillPath& path, double chordAngle);
+
+private:
+    static bool fitRange(const QVector<PathNode>& nodes, int first, int last, double tolerance,
+        PathNode& arc);
+};
+
+
+#endif // ARCFITTER_H
@@ -0,0 +1,60 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "boundingbox.h"
+
+
+namespace
+{
+
+void reduce(const qint64* values, int count, qint64& minimum, qint64& maximum)
+{
+    qint64 low = values[0];
+    qint64 high = values[0];
+
+    for (int i = 1; i < count; ++i)
+    {
+        low = (values[i] < low) ? values[i] : low;
+        high = (values[i] > high) ? values[i] : high;
+    }
+
+    minimum = low;
+    maximum = high;
+}
+
+} // namespace
+
+
+void BoundingBox::include(const qint64* x, const qint64* y, int count)
+{
+    if (count <= 0)
+        return;
+
+    qint64 low;
+    qint64 high;
+
+    reduce(x, count, low, high);
+    include(low, y[0]);
+    include(high, y[0]);
+
+    reduce(y, count, low, high);
+    include(x[0], low);
+    include(x[0], high);
+}
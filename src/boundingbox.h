@@ -0,0 +1,80 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef BOUNDINGBOX_H
+#define BOUNDINGBOX_H
+
+
+#include <QtGlobal>
+
+
+// The extents of a set of points in micrometres
+class BoundingBox
+{
+public:
+    BoundingBox()
+        : minX(0)
+        , maxX(0)
+        , minY(0)
+        , maxY(0)
+        , _empty(true)
+    {
+    }
+
+    bool isEmpty() const { return _empty; }
+
+    void include(qint64 x, qint64 y);
+
+    // Takes a whole coordinate array at once. The loops have no branches and no
+    // dependencies between the points, so the compiler turns them into vector
+    // min/max instructions where the target has them.
+    void include(const qint64* x, const qint64* y, int count);
+
+    qint64 minX;
+    qint64 maxX;
+    qint64 minY;
+    qint64 maxY;
+
+private:
+    bool _empty;
+};
+
+
+inline void BoundingBox::include(qint64 x, qint64 y)
+{
+    if (_empty)
+    {
+        minX = x;
+        maxX = x;
+        minY = y;
+        maxY = y;
+        _empty = false;
+    }
+    else
+    {
+        minX = qMin(minX, x);
+        maxX = qMax(maxX, x);
+        minY = qMin(minY, y);
+        maxY = qMax(maxY, y);
+    }
+}
+
+
+#endif // BOUNDINGBOX_H
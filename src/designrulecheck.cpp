@@ -0,0 +1,461 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "designrulecheck.h"
+
+#include <QHash>
+#include <QtMath>
+
+#include <algorithm>
+
+
+namespace
+{
+
+// The chords of the arcs stay that close to the arcs, micrometres
+const double ArcTolerance = 5.0;
+
+const qint64 MinimumCell = 100;
+
+
+class Hole
+{
+public:
+    Hole()
+        : x(0.0)
+        , y(0.0)
+        , radius(0.0)
+        , line(0)
+        , curve(0)
+    {
+    }
+
+    double x;
+    double y;
+    double radius;
+    int line;
+    int curve;
+};
+
+
+class Piece
+{
+public:
+    Piece()
+        : x1(0.0)
+        , y1(0.0)
+        , x2(0.0)
+        , y2(0.0)
+        , path(0)
+    {
+    }
+
+    double x1;
+    double y1;
+    double x2;
+    double y2;
+    int path;
+};
+
+
+inline qint64 cellOf(double coordinate, qint64 size)
+{
+    return static_cast<qint64>(qFloor(coordinate / size));
+}
+
+inline quint64 cellKey(qint64 x, qint64 y)
+{
+    return (static_cast<quint64>(static_cast<quint32>(x)) << 32) | static_cast<quint32>(y);
+}
+
+
+// Every cell refers to its last entry, the others are chained through "next"
+class Grid
+{
+public:
+    Grid(qint64 size, int count)
+        : _size(size)
+    {
+        _cells.reserve(count);
+    }
+
+    // Puts the object into the cells of the box, the visitor is called first for
+    // every object already in these cells, an object may be visited several times
+    template <class Visitor>
+    void insert(int object, double left, double bottom, double right, double top,
+        Visitor visitor)
+    {
+        for (qint64 cellX = cellOf(left, _size); cellX <= cellOf(right, _size); ++cellX)
+        {
+            for (qint64 cellY = cellOf(bottom, _size); cellY <= cellOf(top, _size); ++cellY)
+            {
+                quint64 key = cellKey(cellX, cellY);
+                QHash<quint64, int>::iterator cell = _cells.find(key);
+
+                _objects.append(object);
+
+                if (cell == _cells.end())
+                {
+                    _next.append(-1);
+                    _cells.insert(key, _objects.size() - 1);
+                    continue;
+                }
+
+                for (int entry = cell.value(); entry >= 0; entry = _next[entry])
+                    visitor(_objects[entry]);
+
+                _next.append(cell.value());
+                cell.value() = _objects.size() - 1;
+            }
+        }
+    }
+
+    template <class Visitor>
+    void visit(double left, double bottom, double right, double top, Visitor visitor) const
+    {
+        for (qint64 cellX = cellOf(left, _size); cellX <= cellOf(right, _size); ++cellX)
+        {
+            for (qint64 cellY = cellOf(bottom, _size); cellY <= cellOf(top, _size); ++cellY)
+            {
+                QHash<quint64, int>::const_iterator cell = _cells.constFind(cellKey(cellX, cellY));
+
+                if (cell == _cells.constEnd())
+                    continue;
+
+                for (int entry = cell.value(); entry >= 0; entry = _next[entry])
+                    visitor(_objects[entry]);
+            }
+        }
+    }
+
+private:
+    qint64 _size;
+
+    QHash<quint64, int> _cells;
+    QVector<int> _objects;
+    QVector<int> _next;
+};
+
+
+double pieceDistance(const Piece& piece, double x, double y)
+{
+    double dx = piece.x2 - piece.x1;
+    double dy = piece.y2 - piece.y1;
+    double square = dx * dx + dy * dy;
+    double t = 0.0;
+
+    if (square > 0.0)
+        t = qBound(0.0, ((x - piece.x1) * dx + (y - piece.y1) * dy) / square, 1.0);
+
+    double px = piece.x1 + t * dx - x;
+    double py = piece.y1 + t * dy - y;
+
+    return qSqrt(px * px + py * py);
+}
+
+void appendPieces(const QList<AbstractCurve>& paths, qint64 size, QVector<Piece>& pieces)
+{
+    for (int i = 0; i < paths.size(); ++i)
+    {
+        const AbstractCurve& curve = paths[i];
+
+        if (curve.type() != AbstractCurve::CurveTypeCurve)
+            continue;
+
+        const qint64* x = curve.x();
+        const qint64* y = curve.y();
+
+        QVector<double> pointsX;
+        QVector<double> pointsY;
+
+        pointsX.append(x[0]);
+        pointsY.append(y[0]);
+
+        for (int j = 1; j < curve.count(); ++j)
+        {
+            int motion = curve.motion(j);
+
+            if (motion != AbstractCurve::MotionLinear)
+            {
+                // The arcs become chords
+                double centerX = curve.centerX(j);
+                double centerY = curve.centerY(j);
+                double radius = qSqrt((x[j - 1] - centerX) * (x[j - 1] - centerX) +
+                    (y[j - 1] - centerY) * (y[j - 1] - centerY));
+
+                double start = qAtan2(y[j - 1] - centerY, x[j - 1] - centerX);
+                double sweep = qAtan2(y[j] - centerY, x[j] - centerX) - start;
+
+                if (motion == AbstractCurve::MotionClockwise && sweep >= 0.0)
+                    sweep -= 2.0 * M_PI;
+                else if (motion == AbstractCurve::MotionCounterClockwise && sweep <= 0.0)
+                    sweep += 2.0 * M_PI;
+
+                int count = 1;
+
+                if (radius > ArcTolerance)
+                {
+                    double step = 2.0 * qAcos(1.0 - ArcTolerance / radius);
+                    count = qBound(1, qCeil(qAbs(sweep) / step), 10000);
+                }
+
+                for (int k = 1; k < count; ++k)
+                {
+                    double angle = start + sweep * k / count;
+
+                    pointsX.append(centerX + radius * qCos(angle));
+                    pointsY.append(centerY + radius * qSin(angle));
+                }
+            }
+
+            pointsX.append(x[j]);
+            pointsY.append(y[j]);
+        }
+
+        // The long segments are split to keep the number of cells per piece small
+        for (int j = 1; j < pointsX.size(); ++j)
+        {
+            double dx = pointsX[j] - pointsX[j - 1];
+            double dy = pointsY[j] - pointsY[j - 1];
+            int count = qMax(1, qCeil(qSqrt(dx * dx + dy * dy) / size));
+
+            for (int k = 0; k < count; ++k)
+            {
+                Piece piece;
+                piece.x1 = pointsX[j - 1] + dx * k / count;
+                piece.y1 = pointsY[j - 1] + dy * k / count;
+                piece.x2 = pointsX[j - 1] + dx * (k + 1) / count;
+                piece.y2 = pointsY[j - 1] + dy * (k + 1) / count;
+                piece.path = i;
+
+                pieces.append(piece);
+            }
+        }
+    }
+}
+
+bool lineLess(const DesignRuleViolation& first, const DesignRuleViolation& second)
+{
+    if (first.line != second.line)
+        return first.line < second.line;
+
+    return first.otherLine < second.otherLine;
+}
+
+} // namespace
+
+
+QVector<DesignRuleViolation> DesignRuleCheck::check(const QList<AbstractCurve>& holes,
+    const QVector<CurveRepeat>& repeats, const ToolTable& tools,
+    const QList<AbstractCurve>& paths, qint64 cutterDiameter, qint64 clearance)
+{
+    QVector<DesignRuleViolation> violations;
+    QVector<Hole> points;
+
+    for (int i = 0; i < holes.size(); ++i)
+    {
+        const AbstractCurve& curve = holes[i];
+
+        if (curve.type() != AbstractCurve::CurveTypePoint || curve.count() < 1)
+            continue;
+
+        Hole hole;
+        hole.x = curve.x()[0];
+        hole.y = curve.y()[0];
+        hole.radius = tools[curve.tool()].diameter() / 2.0;
+        hole.line = curve.line();
+        hole.curve = i;
+
+        points.append(hole);
+    }
+
+    foreach (const CurveRepeat& repeat, repeats)
+    {
+        for (int k = 1; k <= repeat.count; ++k)
+        {
+            for (int i = qMax(repeat.first, 0); i < qMin(repeat.last, holes.size()); ++i)
+            {
+                const AbstractCurve& curve = holes[i];
+
+                if (curve.type() != AbstractCurve::CurveTypePoint || curve.count() < 1)
+                    continue;
+
+                Hole hole;
+                hole.x = curve.x()[0] + repeat.x * k;
+                hole.y = curve.y()[0] + repeat.y * k;
+                hole.radius = tools[curve.tool()].diameter() / 2.0;
+                hole.line = repeat.line;
+                hole.curve = i;
+
+                points.append(hole);
+            }
+        }
+    }
+
+    if (points.isEmpty())
+        return violations;
+
+    // The cell fits the typical hole with its clearance
+    QVector<double> radii(points.size());
+
+    for (int i = 0; i < points.size(); ++i)
+        radii[i] = points[i].radius;
+
+    std::nth_element(radii.begin(), radii.begin() + radii.size() / 2, radii.end());
+
+    qint64 size = qMax(MinimumCell, qRound64(2.0 * radii[radii.size() / 2]) + clearance);
+    double margin = clearance / 2.0;
+
+    // The holes go row by row through the cells, so the neighbouring cells are
+    // still in the cache when they are needed again
+    std::sort(points.begin(), points.end(), [size](const Hole& first, const Hole& second)
+    {
+        qint64 firstRow = cellOf(first.y, size);
+        qint64 secondRow = cellOf(second.y, size);
+
+        if (firstRow != secondRow)
+            return firstRow < secondRow;
+
+        return cellOf(first.x, size) < cellOf(second.x, size);
+    });
+
+    // Every hole meets the holes already in the cells it covers
+    Grid holeGrid(size, points.size());
+    QVector<int> stamp(points.size(), -1);
+
+    for (int i = 0; i < points.size(); ++i)
+    {
+        const Hole& hole = points[i];
+        double reach = hole.radius + margin;
+
+        holeGrid.insert(i, hole.x - reach, hole.y - reach, hole.x + reach, hole.y + reach,
+            [&](int j)
+        {
+            if (stamp[j] == i)
+                return;
+
+            stamp[j] = i;
+
+            const Hole& other = points[j];
+            double dx = other.x - hole.x;
+            double dy = other.y - hole.y;
+
+            // The coincident holes are the duplicates, they are removed when drilling
+            if (dx == 0.0 && dy == 0.0)
+                return;
+
+            double gap = qSqrt(dx * dx + dy * dy) - hole.radius - other.radius;
+
+            if (gap >= clearance)
+                return;
+
+            // The violation belongs to the later hole of the file
+            const Hole& later = (hole.line < other.line) ? other : hole;
+            const Hole& earlier = (hole.line < other.line) ? hole : other;
+
+            DesignRuleViolation violation;
+            violation.type = (gap < 0.0) ? DesignRuleViolation::TypeHoleOverlap
+                : DesignRuleViolation::TypeHoleClearance;
+            violation.line = later.line;
+            violation.otherLine = earlier.line;
+            violation.curve = later.curve;
+            violation.otherCurve = earlier.curve;
+            violation.x = qRound64(later.x);
+            violation.y = qRound64(later.y);
+            violation.clearance = qRound64(gap);
+
+            violations.append(violation);
+        });
+    }
+
+    if (paths.isEmpty())
+    {
+        std::sort(violations.begin(), violations.end(), lineLess);
+        return violations;
+    }
+
+    // The holes against the milling paths, the closest piece of every path counts
+    QVector<Piece> pieces;
+    appendPieces(paths, size, pieces);
+
+    double cutter = cutterDiameter / 2.0;
+
+    Grid pathGrid(size, pieces.size());
+
+    for (int i = 0; i < pieces.size(); ++i)
+    {
+        const Piece& piece = pieces[i];
+        double reach = cutter + margin;
+
+        pathGrid.insert(i, qMin(piece.x1, piece.x2) - reach, qMin(piece.y1, piece.y2) - reach,
+            qMax(piece.x1, piece.x2) + reach, qMax(piece.y1, piece.y2) + reach, [](int) {});
+    }
+
+    QVector<int> pathStamp(paths.size(), -1);
+    QVector<double> pathGap(paths.size(), 0.0);
+
+    for (int i = 0; i < points.size(); ++i)
+    {
+        const Hole& hole = points[i];
+        double reach = hole.radius + margin;
+
+        QVector<int> touched;
+
+        pathGrid.visit(hole.x - reach, hole.y - reach, hole.x + reach, hole.y + reach,
+            [&](int j)
+        {
+            const Piece& piece = pieces[j];
+            double gap = pieceDistance(piece, hole.x, hole.y) - hole.radius - cutter;
+
+            if (gap >= clearance)
+                return;
+
+            if (pathStamp[piece.path] != i)
+            {
+                pathStamp[piece.path] = i;
+                pathGap[piece.path] = gap;
+                touched.append(piece.path);
+            }
+            else
+            {
+                pathGap[piece.path] = qMin(pathGap[piece.path], gap);
+            }
+        });
+
+        foreach (int path, touched)
+        {
+            DesignRuleViolation violation;
+            violation.type = (pathGap[path] < 0.0) ? DesignRuleViolation::TypePathOverlap
+                : DesignRuleViolation::TypePathClearance;
+            violation.line = hole.line;
+            violation.otherLine = paths[path].line();
+            violation.curve = hole.curve;
+            violation.otherCurve = path;
+            violation.x = qRound64(hole.x);
+            violation.y = qRound64(hole.y);
+            violation.clearance = qRound64(pathGap[path]);
+
+            violations.append(violation);
+        }
+    }
+
+    std::sort(violations.begin(), violations.end(), lineLess);
+    return violations;
+}
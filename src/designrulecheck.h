@@ -0,0 +1,87 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef DESIGNRULECHECK_H
+#define DESIGNRULECHECK_H
+
+
+#include <QList>
+#include <QVector>
+
+#include "abstractparser.h"
+
+
+class DesignRuleViolation
+{
+public:
+    enum Type
+    {
+        TypeHoleOverlap = 0,
+        TypeHoleClearance,
+        TypePathOverlap,
+        TypePathClearance
+    };
+
+    DesignRuleViolation()
+        : type(TypeHoleOverlap)
+        , line(0)
+        , otherLine(0)
+        , curve(0)
+        , otherCurve(0)
+        , x(0)
+        , y(0)
+        , clearance(0)
+    {
+    }
+
+    int type;
+
+    // The line of the hole and the line of the other hole or of the path
+    int line;
+    int otherLine;
+
+    // The same for the indices of the curves, they tell the files of a job apart
+    int curve;
+    int otherCurve;
+
+    qint64 x;
+    qint64 y;
+
+    // The distance between the edges, negative for an overlap, in micrometres
+    qint64 clearance;
+};
+
+
+class DesignRuleCheck
+{
+public:
+    // Finds the holes that overlap or come closer than the clearance (in micrometres)
+    // to each other or to the milling paths. The holes take their diameters from the
+    // tool table, the paths are as wide as the cutter. Holes and path pieces are
+    // bucketed in a uniform grid with the typical hole as the cell size, so only the
+    // objects sharing a cell are compared and the expected time is O(n). The repeated
+    // copies of the holes are checked as well.
+    static QVector<DesignRuleViolation> check(const QList<AbstractCurve>& holes,
+        const QVector<CurveRepeat>& repeats, const ToolTable& tools, const QList<AbstractCurve>& paths, qint64 cutterDiameter,
+        qint64 clearance);
+};
+
+
+#endif // DESIGNRULECHECK_H
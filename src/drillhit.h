@@ -0,0 +1,52 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef DRILLHIT_H
+#define DRILLHIT_H
+
+
+#include <QtGlobal>
+
+
+// A single hole of the drilling program. The generator flattens the parsed
+// points into an array of hits, and the drilling stages reorder and rewrite it.
+class DrillHit
+{
+public:
+    DrillHit()
+        : x(0)
+        , y(0)
+        , tool(0)
+        , line(0)
+        , diameter(0)
+    {
+    }
+
+    qint64 x;
+    qint64 y;
+    int tool;
+    int line;
+
+    // The diameter of a hole milled along a helix, zero for drilled holes
+    int diameter;
+};
+
+
+#endif // DRILLHIT_H
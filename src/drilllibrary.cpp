@@ -0,0 +1,189 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "drilllibrary.h"
+
+#include <QRegExp>
+
+#include <algorithm>
+
+
+DrillLibrary::DrillLibrary()
+    : _tolerance(50)
+    , _policy(PolicyNearest)
+{
+}
+
+void DrillLibrary::clear()
+{
+    _bits.clear();
+    _maximum.clear();
+    _rejected.clear();
+}
+
+bool DrillLibrary::parse(const QString& text)
+{
+    clear();
+
+    QStringList entries = text.split(QRegExp("[\\s,;]+"));
+
+    foreach (const QString& entry, entries)
+    {
+        if (entry.isEmpty())
+            continue;
+
+        QStringList parts = entry.split(':');
+
+        bool ok = false;
+
+        Bit bit;
+        bit.diameter = qRound(parts[0].toDouble(&ok) * 1000.0);
+        bit.tolerance = -1;
+
+        if (ok && parts.size() == 2)
+            bit.tolerance = qRound(parts[1].toDouble(&ok) * 1000.0);
+
+        if (!ok || parts.size() > 2 || bit.diameter <= 0 ||
+            (parts.size() == 2 && bit.tolerance < 0))
+        {
+            _rejected.append(entry);
+            continue;
+        }
+
+        _bits.append(bit);
+    }
+
+    build();
+
+    return _rejected.isEmpty();
+}
+
+void DrillLibrary::setTolerance(int tolerance)
+{
+    _tolerance = qMax(0, tolerance);
+
+    build();
+}
+
+void DrillLibrary::setPolicy(int policy)
+{
+    if (policy < PolicyNearest || policy > PolicyUndersize)
+        policy = PolicyNearest;
+
+    _policy = policy;
+
+    build();
+}
+
+int DrillLibrary::find(int diameter) const
+{
+    int best = -1;
+
+    if (!_bits.isEmpty())
+        findNode(0, _bits.size(), diameter, best);
+
+    return best;
+}
+
+void DrillLibrary::build()
+{
+    for (int i = 0; i < _bits.size(); ++i)
+    {
+        Bit& bit = _bits[i];
+
+        int tolerance = bit.tolerance < 0 ? _tolerance : bit.tolerance;
+
+        // An oversize bit is never smaller than the hole, an undersize one never larger
+        bit.low = _policy == PolicyUndersize ? bit.diameter : bit.diameter - tolerance;
+        bit.high = _policy == PolicyOversize ? bit.diameter : bit.diameter + tolerance;
+    }
+
+    std::sort(_bits.begin(), _bits.end(), [](const Bit& left, const Bit& right)
+    {
+        return left.low < right.low || (left.low == right.low && left.diameter < right.diameter);
+    });
+
+    _maximum.resize(_bits.size());
+
+    if (!_bits.isEmpty())
+        buildNode(0, _bits.size());
+}
+
+void DrillLibrary::buildNode(int first, int last)
+{
+    // The subtree [first, last) is rooted at its middle element
+    int middle = first + (last - first) / 2;
+    int maximum = _bits[middle].high;
+
+    if (first < middle)
+    {
+        buildNode(first, middle);
+        maximum = qMax(maximum, _maximum[first + (middle - first) / 2]);
+    }
+
+    if (middle + 1 < last)
+    {
+        buildNode(middle + 1, last);
+        maximum = qMax(maximum, _maximum[middle + 1 + (last - middle - 1) / 2]);
+    }
+
+    _maximum[middle] = maximum;
+}
+
+void DrillLibrary::findNode(int first, int last, int diameter, int& best) const
+{
+    int middle = first + (last - first) / 2;
+
+    // No interval of this subtree reaches the diameter
+    if (_maximum[middle] < diameter)
+        return;
+
+    if (first < middle)
+        findNode(first, middle, diameter, best);
+
+    const Bit& bit = _bits[middle];
+
+    // The right subtree starts even further to the right
+    if (bit.low > diameter)
+        return;
+
+    if (bit.high >= diameter)
+    {
+        if (best < 0)
+        {
+            best = middle;
+        }
+        else
+        {
+            int distance = qAbs(bit.diameter - diameter);
+            int bestDistance = qAbs(_bits[best].diameter - diameter);
+
+            // Prefer the larger bit on a tie
+            if (distance < bestDistance ||
+                (distance == bestDistance && bit.diameter > _bits[best].diameter))
+            {
+                best = middle;
+            }
+        }
+    }
+
+    if (middle + 1 < last)
+        findNode(middle + 1, last, diameter, best);
+}
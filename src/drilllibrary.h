@@ -0,0 +1,91 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef DRILLLIBRARY_H
+#define DRILLLIBRARY_H
+
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+
+// The set of drill bits available on the machine. Every bit accepts the tool
+// diameters of an interval defined by its tolerance and the selection policy.
+// The intervals are kept in a static augmented interval tree (sorted by the
+// lower bound, every node stores the largest upper bound of its subtree), so a
+// lookup costs O(log n + k), where k is the number of the bits whose intervals
+// contain the diameter.
+class DrillLibrary
+{
+public:
+    enum Policy
+    {
+        PolicyNearest = 0,
+        PolicyOversize,
+        PolicyUndersize
+    };
+
+    DrillLibrary();
+
+    void clear();
+
+    // Bits are given in millimetres, separated by spaces, commas or semicolons.
+    // A bit may override the default tolerance: "0.8 1.0:0.1 1.2".
+    bool parse(const QString& text);
+    const QStringList& rejected() const { return _rejected; }
+
+    void setTolerance(int tolerance);
+    int tolerance() const { return _tolerance; }
+
+    void setPolicy(int policy);
+    int policy() const { return _policy; }
+
+    bool isEmpty() const { return _bits.isEmpty(); }
+    int count() const { return _bits.size(); }
+    int diameter(int index) const { return _bits[index].diameter; }
+
+    // Returns the index of the bit closest to the diameter or -1
+    int find(int diameter) const;
+
+private:
+    struct Bit
+    {
+        int diameter;
+        int tolerance;
+        int low;
+        int high;
+    };
+
+    void build();
+    void buildNode(int first, int last);
+    void findNode(int first, int last, int diameter, int& best) const;
+
+    QVector<Bit> _bits;
+    QVector<int> _maximum;
+
+    QStringList _rejected;
+
+    int _tolerance;
+    int _policy;
+};
+
+
+#endif // DRILLLIBRARY_H
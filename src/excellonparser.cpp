@@ -36,7 +36,7 @@ void ExcellonParser::clear()
 {
     _tools.clear();
     // Insert zero (default) tool
-    _tools[0] = AbstractTool();
+    _tools.insert(0);
 
     _points.clear();
 
@@ -47,13 +47,19 @@ void ExcellonParser::clear()
     _interrupted = false;
     _toolNumber = 0;
 
-    _minX = 0;
-    _maxX = 0;
-    _minY = 0;
-    _maxY = 0;
+    _limits = BoundingBox();
 
+    _relativeX.clear();
+    _relativeY.clear();
+
+    _repeats.clear();
+    _repeatOffsets.clear();
+    _patternFirst = -1;
+    _patternLast = -1;
+
+    _flagIncremental = false;
     _flagNeedRecalculate = false;
-    _flagSetLimits = true;
+    _flagRelative = false;
 }
 
 bool ExcellonParser::parse(QFile& file)
@@ -104,12 +110,12 @@ bool ExcellonParser::parse(QFile& file)
 
     emit progress(100, 100);
 
+    bool ok = true;
+
     if (_flagNeedRecalculate)
     {
         emit started(tr("Recalculating Points"));
 
-        bool ok = true;
-
         if (_format == FormatUnknown)
         {
             ok = false;
@@ -129,51 +135,85 @@ bool ExcellonParser::parse(QFile& file)
                     continue;
 
                 point._x.resize(1);
-                point._x[0] = parseNumber(point._stringX, &ok);
+                point._y.resize(1);
 
-                if (ok)
-                {
-                    point._y.resize(1);
-                    point._y[0] = parseNumber(point._stringY, &ok);
-                }
+                if (!point._stringX.isEmpty())
+                    point._x[0] = parseNumber(point._stringX, &ok);
 
-                if (ok)
-                {
-                    point._type = AbstractCurve::CurveTypePoint;
+                if (ok && !point._stringY.isEmpty())
+                    point._y[0] = parseNumber(point._stringY, &ok);
 
-                    if (_flagSetLimits)
-                    {
-                        _minX = point._x[0];
-                        _maxX = point._x[0];
-                        _minY = point._y[0];
-                        _maxY = point._y[0];
-                        _flagSetLimits = false;
-                    }
-                    else
-                    {
-                        _minX = qMin(_minX, point._x[0]);
-                        _maxX = qMax(_maxX, point._x[0]);
-                        _minY = qMin(_minY, point._y[0]);
-                        _maxY = qMax(_maxY, point._y[0]);
-                    }
-                }
-                else
-                {
+                if (!ok)
                     break;
-                }
+
+                point._type = AbstractCurve::CurveTypePoint;
             }
             emit progress(_points.size(), _points.size());
         }
+    }
 
-        if (!ok)
+    if (ok)
+        ok = resolveRepeats();
+
+    if (!ok)
+    {
+        error(tr("Unable to determine the number presentation format.\nTry to change the "
+            "Excellon export configuration in the Sprint-Layout:\n"
+            "- keep leading zeros,\n"
+            "- use the output with a decimal point,\n"
+            "- do not suppress comments."), " ");
+        return false;
+    }
+
+    if (_flagRelative)
+        resolvePoints();
+
+    // The hits are separate curves, their coordinates are gathered into arrays once,
+    // so the extents are a reduction over plain arrays as in the HP-GL parser
+    QVector<qint64> x(_points.size());
+    QVector<qint64> y(_points.size());
+
+    for (int i = 0; i < _points.size(); ++i)
+    {
+        x[i] = _points[i]._x[0];
+        y[i] = _points[i]._y[0];
+    }
+
+    _limits.include(x.constData(), y.constData(), x.size());
+
+    // The copies are linear in k, the first and the last copy give the extents
+    BoundingBox range;
+    int copies = 0;
+
+    for (int i = 0; i < _repeats.size(); ++i)
+    {
+        const CurveRepeat& repeat = _repeats[i];
+
+        if (repeat.copies() < 1)
+            continue;
+
+        if (i == 0 || repeat.first != _repeats[i - 1].first ||
+            repeat.last != _repeats[i - 1].last)
         {
-            error(tr("Unable to determine the number presentation format.\nTry to change the "
-                "Excellon export configuration in the Sprint-Layout:\n"
-                "- keep leading zeros,\n"
-                "- use the output with a decimal point,\n"
-                "- do not suppress comments."), " ");
-            return false;
+            range = BoundingBox();
+            range.include(x.constData() + repeat.first, y.constData() + repeat.first,
+                repeat.last - repeat.first);
         }
+
+        _limits.include(range.minX + repeat.x, range.minY + repeat.y);
+        _limits.include(range.maxX + repeat.x, range.maxY + repeat.y);
+        _limits.include(range.minX + repeat.x * repeat.count,
+            range.minY + repeat.y * repeat.count);
+        _limits.include(range.maxX + repeat.x * repeat.count,
+            range.maxY + repeat.y * repeat.count);
+
+        copies += repeat.copies();
+    }
+
+    if (copies > 0)
+    {
+        notice(tr("The step-and-repeat commands add %1 copies of the holes, they are kept "
+            "once and expanded only for the program.").arg(copies), " ");
     }
 
     if (_points.empty())
@@ -183,13 +223,13 @@ bool ExcellonParser::parse(QFile& file)
     }
     else
     {
-        QString minX = Utilities::coordinateToString(_minX);
-        QString maxX = Utilities::coordinateToString(_maxX);
-        QString dltX = Utilities::coordinateToString(_maxX - _minX);
+        QString minX = Utilities::coordinateToString(_limits.minX);
+        QString maxX = Utilities::coordinateToString(_limits.maxX);
+        QString dltX = Utilities::coordinateToString(_limits.maxX - _limits.minX);
 
-        QString minY = Utilities::coordinateToString(_minY);
-        QString maxY = Utilities::coordinateToString(_maxY);
-        QString dltY = Utilities::coordinateToString(_maxY - _minY);
+        QString minY = Utilities::coordinateToString(_limits.minY);
+        QString maxY = Utilities::coordinateToString(_limits.maxY);
+        QString dltY = Utilities::coordinateToString(_limits.maxY - _limits.minY);
 
         accept(tr("The file has been successfully loaded.\nBoundaries of coordinates:\n"
             "Xmin = %1 mm, Xmax = %2 mm, \xCE\x94X = %3 mm,\n"
@@ -202,6 +242,63 @@ bool ExcellonParser::parse(QFile& file)
     return true;
 }
 
+int ExcellonParser::merge(const ExcellonParser& other)
+{
+    QVector<int> numbers(other._tools.upperBound(), 0);
+    int shared = 0;
+
+    for (int id = 1; id < other._tools.upperBound(); ++id)
+    {
+        if (!other._tools.contains(id))
+            continue;
+
+        int diameter = other._tools[id].diameter();
+        int number = -1;
+
+        // The tools of an unknown diameter are never taken for each other
+        for (int own = 1; own < _tools.upperBound() && diameter > 0 && number < 0; ++own)
+        {
+            if (_tools.contains(own) && _tools[own].diameter() == diameter)
+                number = own;
+        }
+
+        if (number < 0)
+        {
+            number = _tools.upperBound();
+            _tools.insert(number, diameter);
+        }
+        else
+        {
+            ++shared;
+        }
+
+        numbers[id] = number;
+    }
+
+    int offset = _points.size();
+
+    foreach (const AbstractCurve& point, other._points)
+    {
+        _points.append(point);
+        _points.last()._tool = numbers.value(point._tool, 0);
+    }
+
+    foreach (CurveRepeat repeat, other._repeats)
+    {
+        repeat.first += offset;
+        repeat.last += offset;
+        _repeats.append(repeat);
+    }
+
+    if (!other._limits.isEmpty())
+    {
+        _limits.include(other._limits.minX, other._limits.minY);
+        _limits.include(other._limits.maxX, other._limits.maxY);
+    }
+
+    return shared;
+}
+
 void ExcellonParser::interrupt()
 {
     _interrupted = true;
@@ -341,6 +438,27 @@ bool ExcellonParser::parseHeader(const QString& line, bool& abort)
         return true;
     }
 
+    if (line.startsWith("ICI", Qt::CaseInsensitive))
+    {
+        if (line.compare("ICI", Qt::CaseInsensitive) == 0 ||
+            line.compare("ICI,ON", Qt::CaseInsensitive) == 0)
+        {
+            _flagIncremental = true;
+            notice(tr("Using the incremental input of coordinates."),
+                QString::number(_lineNumber));
+        }
+        else if (line.compare("ICI,OFF", Qt::CaseInsensitive) == 0)
+        {
+            _flagIncremental = false;
+        }
+        else
+        {
+            warning(tr("Unknown command: '%1'.")
+                .arg((line.size() > 20) ? (line.left(20) + "...") : line));
+        }
+        return true;
+    }
+
     if (line.startsWith('T', Qt::CaseInsensitive))
     {
         QRegExp expression;
@@ -367,20 +485,21 @@ bool ExcellonParser::parseHeader(const QString& line, bool& abort)
         if (toolNumber > -1)
         {
             _toolNumber = toolNumber;
-            _tools[toolNumber]._id = toolNumber;
+
+            AbstractTool& tool = _tools.insert(toolNumber);
 
             if (!toolDiameterString.isEmpty())
             {
                 if (_units != UnitsUnknown)
                 {
-                    _tools[toolNumber]._diameter = static_cast<int>(parseNumber(toolDiameterString));
+                    tool._diameter = static_cast<int>(parseNumber(toolDiameterString));
 
-                    int fractional = _tools[toolNumber]._diameter % 10;
+                    int fractional = tool._diameter % 10;
 
                     if (fractional > 4)
-                        _tools[toolNumber]._diameter += 10;
+                        tool._diameter += 10;
 
-                    _tools[toolNumber]._diameter -= fractional;
+                    tool._diameter -= fractional;
                 }
                 else
                 {
@@ -429,7 +548,16 @@ bool ExcellonParser::parseHeader(const QString& line, bool& abort)
 bool ExcellonParser::parseBody(const QString& line, bool& abort)
 {
     if (line.compare("G90", Qt::CaseInsensitive) == 0)
+    {
+        _flagIncremental = false;
+        return true;
+    }
+
+    if (line.compare("G91", Qt::CaseInsensitive) == 0)
+    {
+        _flagIncremental = true;
         return true;
+    }
 
     if (line.compare("G05", Qt::CaseInsensitive) == 0)
     {
@@ -456,62 +584,282 @@ bool ExcellonParser::parseBody(const QString& line, bool& abort)
         return true;
     }
 
-    if (line.startsWith('X', Qt::CaseInsensitive))
+    if (line.startsWith('M', Qt::CaseInsensitive) || line.startsWith('R', Qt::CaseInsensitive))
+        return parseRepeat(line);
+
+    if (line.startsWith('X', Qt::CaseInsensitive) || line.startsWith('Y', Qt::CaseInsensitive))
     {
         QRegExp expression;
         expression.setCaseSensitivity(Qt::CaseInsensitive);
-        expression.setPattern("^X([\\+\\-]?\\d*\\.?\\d+)Y([\\+\\-]?\\d*\\.?\\d+)");
+        expression.setPattern("^(?:X([\\+\\-]?\\d*\\.?\\d+))?(?:Y([\\+\\-]?\\d*\\.?\\d+))?");
 
-        if (expression.indexIn(line) < 0)
+        if (expression.indexIn(line) < 0 || expression.matchedLength() < 1)
             return false;
 
         AbstractCurve point;
         point._tool = _toolNumber;
+        point._line = _lineNumber;
         point._stringX = expression.cap(1);
         point._stringY = expression.cap(2);
 
-        bool ok;
+        bool ok = true;
 
         point._x.resize(1);
-        point._x[0] = parseNumber(point._stringX, &ok);
+        point._y.resize(1);
+
+        // An omitted axis keeps its previous value, i.e. it is a zero offset
+        if (!point._stringX.isEmpty())
+            point._x[0] = parseNumber(point._stringX, &ok);
+
+        if (ok && !point._stringY.isEmpty())
+            point._y[0] = parseNumber(point._stringY, &ok);
 
         if (ok)
+            point._type = AbstractCurve::CurveTypePoint;
+        else
+            _flagNeedRecalculate = true;
+
+        bool relativeX = _flagIncremental || point._stringX.isEmpty();
+        bool relativeY = _flagIncremental || point._stringY.isEmpty();
+
+        _relativeX << relativeX;
+        _relativeY << relativeY;
+
+        if (relativeX || relativeY)
+            _flagRelative = true;
+
+        _points << point;
+
+        return true;
+    }
+
+    return false;
+}
+
+bool ExcellonParser::parseRepeat(const QString& line)
+{
+    if (line.compare("M25", Qt::CaseInsensitive) == 0)
+    {
+        if (_patternFirst > -1 && _patternLast < 0)
+            warning(tr("The previous pattern has not been closed, a new pattern begins."));
+
+        _patternFirst = _points.size();
+        _patternLast = -1;
+        return true;
+    }
+
+    if (line.compare("M01", Qt::CaseInsensitive) == 0)
+    {
+        if (_patternFirst < 0 || _patternLast > -1)
+            warning(tr("The end of a pattern without its beginning will be ignored."));
+        else
+            _patternLast = _points.size();
+
+        return true;
+    }
+
+    // The end of the step-and-repeat, the pattern cannot be repeated anymore
+    if (line.compare("M08", Qt::CaseInsensitive) == 0)
+    {
+        _patternFirst = -1;
+        _patternLast = -1;
+        return true;
+    }
+
+    QRegExp expression;
+    expression.setCaseSensitivity(Qt::CaseInsensitive);
+    expression.setPattern("^(?:M02|R(\\d+))(?:X([\\+\\-]?\\d*\\.?\\d+))?"
+        "(?:Y([\\+\\-]?\\d*\\.?\\d+))?(M70|M80|M90)?$");
+
+    if (expression.indexIn(line) < 0)
+        return false;
+
+    RepeatOffset offset;
+    offset.stringX = expression.cap(2);
+    offset.stringY = expression.cap(3);
+    offset.pattern = expression.cap(1).isEmpty();
+    offset.next = _points.size();
+
+    CurveRepeat repeat;
+    repeat.line = _lineNumber;
+
+    if (offset.pattern)
+    {
+        if (!expression.cap(4).isEmpty())
         {
-            point._y.resize(1);
-            point._y[0] = parseNumber(point._stringY, &ok);
+            warning(tr("The swapped and mirrored copies of a pattern are not supported.\n"
+                "The repeat will be ignored."));
+            return true;
         }
 
-        if (ok)
+        if (_patternLast < 0)
         {
-            point._type = AbstractCurve::CurveTypePoint;
+            warning(tr("The repeat of a pattern that has not been closed will be ignored."));
+            return true;
+        }
 
-            if (_flagSetLimits)
-            {
-                _minX = point._x[0];
-                _maxX = point._x[0];
-                _minY = point._y[0];
-                _maxY = point._y[0];
-                _flagSetLimits = false;
-            }
-            else
+        repeat.first = _patternFirst;
+        repeat.last = _patternLast;
+        repeat.count = 1;
+    }
+    else
+    {
+        if (!expression.cap(4).isEmpty())
+            return false;
+
+        if (_points.isEmpty())
+        {
+            warning(tr("The repeat before the first hit will be ignored."));
+            return true;
+        }
+
+        // The last hit is repeated with the step
+        repeat.first = _points.size() - 1;
+        repeat.last = _points.size();
+        repeat.count = expression.cap(1).toInt();
+
+        if (repeat.count < 1)
+            return true;
+    }
+
+    _repeats << repeat;
+    _repeatOffsets << offset;
+
+    return true;
+}
+
+bool ExcellonParser::resolveRepeats()
+{
+    QVector<CurveRepeat> repeats;
+    repeats.reserve(_repeats.size());
+
+    int pattern = -1;
+    qint64 patternX = 0;
+    qint64 patternY = 0;
+
+    int next = -1;
+    qint64 shiftX = 0;
+    qint64 shiftY = 0;
+
+    for (int i = 0; i < _repeats.size(); ++i)
+    {
+        CurveRepeat repeat = _repeats[i];
+        RepeatOffset& offset = _repeatOffsets[i];
+
+        bool ok = true;
+        qint64 x = 0;
+        qint64 y = 0;
+
+        if (!offset.stringX.isEmpty())
+            x = parseNumber(offset.stringX, &ok);
+
+        if (ok && !offset.stringY.isEmpty())
+            y = parseNumber(offset.stringY, &ok);
+
+        if (!ok)
+            return false;
+
+        if (offset.next != next)
+        {
+            next = offset.next;
+            shiftX = 0;
+            shiftY = 0;
+        }
+
+        if (offset.pattern)
+        {
+            // Every M02 moves the pattern on from its previous copy
+            if (repeat.first != pattern)
             {
-                _minX = qMin(_minX, point._x[0]);
-                _maxX = qMax(_maxX, point._x[0]);
-                _minY = qMin(_minY, point._y[0]);
-                _maxY = qMax(_maxY, point._y[0]);
+                pattern = repeat.first;
+                patternX = 0;
+                patternY = 0;
             }
+
+            patternX += x;
+            patternY += y;
+
+            repeat.x = patternX;
+            repeat.y = patternY;
+            repeats << repeat;
+
+            shiftX = patternX;
+            shiftY = patternY;
+        }
+        else if (shiftX == 0 && shiftY == 0)
+        {
+            repeat.x = x;
+            repeat.y = y;
+            repeats << repeat;
+
+            shiftX = x * repeat.count;
+            shiftY = y * repeat.count;
         }
         else
         {
-            _flagNeedRecalculate = true;
+            // The hit is repeated from where the previous repeat has left the tool
+            for (int k = 1; k <= repeat.count; ++k)
+            {
+                CurveRepeat copy = repeat;
+                copy.count = 1;
+                copy.x = shiftX + x * k;
+                copy.y = shiftY + y * k;
+                repeats << copy;
+            }
+
+            shiftX += x * repeat.count;
+            shiftY += y * repeat.count;
         }
 
-        _points << point;
+        offset.shiftX = shiftX;
+        offset.shiftY = shiftY;
+    }
 
-        return true;
+    _repeats = repeats;
+
+    return true;
+}
+
+void ExcellonParser::resolvePoints()
+{
+    emit started(tr("Resolving Incremental Coordinates"));
+
+    QVector<qint64> x(_points.size());
+    QVector<qint64> y(_points.size());
+
+    for (int i = 0; i < _points.size(); ++i)
+    {
+        x[i] = _points[i]._x[0];
+        y[i] = _points[i]._y[0];
     }
 
-    return false;
+    // The tool stays at the last copy, the next incremental hit starts from there
+    for (int i = 0; i < _repeatOffsets.size(); ++i)
+    {
+        const RepeatOffset& offset = _repeatOffsets[i];
+
+        bool last = (i + 1 == _repeatOffsets.size() || _repeatOffsets[i + 1].next != offset.next);
+
+        if (!last || offset.next >= _points.size())
+            continue;
+
+        if (_relativeX[offset.next])
+            x[offset.next] += offset.shiftX;
+
+        if (_relativeY[offset.next])
+            y[offset.next] += offset.shiftY;
+    }
+
+    Utilities::prefixSum(x, _relativeX);
+    Utilities::prefixSum(y, _relativeY);
+
+    for (int i = 0; i < _points.size(); ++i)
+    {
+        AbstractCurve& point = _points[i];
+
+        point._x[0] = x[i];
+        point._y[0] = y[i];
+    }
 }
 
 qint64 ExcellonParser::parseNumber(const QString& number, bool* ok)
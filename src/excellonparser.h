@@ -23,6 +23,7 @@
 
 
 #include "abstractparser.h"
+#include "boundingbox.h"
 
 
 class QFile;
@@ -40,8 +41,14 @@ public:
     virtual void clear();
     virtual bool parse(QFile& file);
 
-    virtual const QMap<int, AbstractTool>& tools() const;
+    virtual const ToolTable& tools() const;
     virtual const QList<AbstractCurve>& curves() const;
+    virtual const QVector<CurveRepeat>& repeats() const;
+    virtual int settledCount() const;
+
+    // Appends the holes of another file, a tool of the same diameter is shared and
+    // the other tools get the next free numbers. Returns the number of shared tools.
+    int merge(const ExcellonParser& other);
 
 public slots:
     virtual void interrupt();
@@ -71,27 +78,62 @@ private:
         UnitsInch
     };
 
+    // The offset of a repeat as written, it is converted together with the points
+    class RepeatOffset
+    {
+    public:
+        RepeatOffset()
+            : pattern(false)
+            , next(0)
+            , shiftX(0)
+            , shiftY(0)
+        {
+        }
+
+        QString stringX;
+        QString stringY;
+
+        // The offsets of M02 add up from the pattern, the R offset is the step
+        bool pattern;
+
+        // The first point after the repeat
+        int next;
+
+        // Where the tool stays after the repeat, from the point before the next one
+        qint64 shiftX;
+        qint64 shiftY;
+    };
+
     bool parseComment(const QString& line, bool& abort);
     bool parseHeader(const QString& line, bool& abort);
     bool parseBody(const QString& line, bool& abort);
     qint64 parseNumber(const QString& number, bool* ok = nullptr);
+    bool parseRepeat(const QString& line);
+    bool resolveRepeats();
+    void resolvePoints();
 
-    QMap<int, AbstractTool> _tools;
+    ToolTable _tools;
     QList<AbstractCurve> _points;
+    QVector<bool> _relativeX;
+    QVector<bool> _relativeY;
+
+    // The step-and-repeat blocks (M25, M01, M02) and the repeated hits (R)
+    QVector<CurveRepeat> _repeats;
+    QVector<RepeatOffset> _repeatOffsets;
+    int _patternFirst;
+    int _patternLast;
 
     Stage _stage;
     Format _format;
     Units _units;
 
-    qint64 _minX;
-    qint64 _maxX;
-    qint64 _minY;
-    qint64 _maxY;
+    BoundingBox _limits;
 
     int _toolNumber;
 
+    bool _flagIncremental;
     bool _flagNeedRecalculate;
-    bool _flagSetLimits;
+    bool _flagRelative;
 };
 
 
@@ -100,7 +142,7 @@ inline AbstractParser::ParserType ExcellonParser::type() const
     return ParserDrilling;
 }
 
-inline const QMap<int, AbstractTool>& ExcellonParser::tools() const
+inline const ToolTable& ExcellonParser::tools() const
 {
     return _tools;
 }
@@ -110,5 +152,16 @@ inline const QList<AbstractCurve>& ExcellonParser::curves() const
     return _points;
 }
 
+inline const QVector<CurveRepeat>& ExcellonParser::repeats() const
+{
+    return _repeats;
+}
+
+inline int ExcellonParser::settledCount() const
+{
+    // Incremental and deferred coordinates are known only at the end
+    return (_flagRelative || _flagNeedRecalculate) ? 0 : _points.size();
+}
+
 
 #endif // EXCELLONPARSER_H
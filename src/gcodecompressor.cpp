@@ -0,0 +1,259 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "gcodecompressor.h"
+
+
+GcodeCompressor::GcodeCompressor(int options)
+    : _options(options)
+    , _modalMotion(true)
+{
+    reset();
+}
+
+void GcodeCompressor::reset()
+{
+    _words.clear();
+    _feed.clear();
+    invalidatePosition();
+
+    _motion = -1;
+    _absolute = true;
+
+    _inputSize = 0;
+    _outputSize = 0;
+}
+
+bool GcodeCompressor::compress(QString& output, int lineStart)
+{
+    int length = output.size() - lineStart;
+
+    _inputSize += length + 1;
+
+    // Split the line into words
+    _words.resize(0);
+
+    bool parsed = true;
+
+    int i = lineStart;
+    while (i < output.size())
+    {
+        QChar c = output.at(i);
+
+        if (c == ' ' || c == '\t')
+        {
+            ++i;
+            continue;
+        }
+
+        if (!c.isLetter())
+        {
+            parsed = false;
+            break;
+        }
+
+        int start = ++i;
+
+        if (i < output.size() && (output.at(i) == '+' || output.at(i) == '-'))
+            ++i;
+
+        int digits = 0;
+        while (i < output.size() && (output.at(i).isDigit() || output.at(i) == '.'))
+        {
+            ++digits;
+            ++i;
+        }
+
+        if (digits == 0)
+        {
+            parsed = false;
+            break;
+        }
+
+        Word word;
+        word.letter = c.toUpper();
+        word.value = output.mid(start, i - start);
+        _words.append(word);
+    }
+
+    if (!parsed || _words.isEmpty())
+    {
+        // Comments, messages and other unknown content are passed as is
+        invalidatePosition();
+        _outputSize += length + 1;
+        return true;
+    }
+
+    // Modal state of the line
+    int motion = -1;
+    bool invalidate = false;
+
+    for (int j = 0; j < _words.size(); ++j)
+    {
+        const Word& word = _words.at(j);
+
+        if (word.letter == 'G')
+        {
+            QString value = normalizeNumber(word.value);
+
+            bool ok;
+            int code = value.toInt(&ok);
+
+            if (!ok)
+            {
+                invalidate = true;
+            }
+            else if ((code >= 0 && code <= 3) || code == 73 || (code >= 80 && code <= 89))
+            {
+                motion = code;
+            }
+            else if (code == 90)
+            {
+                _absolute = true;
+            }
+            else if (code == 91)
+            {
+                _absolute = false;
+                invalidate = true;
+            }
+            else if (code != 17 && code != 40 && code != 49 && code != 61 && code != 64 &&
+                code != 94 && code != 98 && code != 99 && !(code >= 54 && code <= 59))
+            {
+                invalidate = true;
+            }
+        }
+        else if (word.letter == 'M')
+        {
+            if (normalizeNumber(word.value) == "6")
+                invalidate = true;
+        }
+    }
+
+    int activeMotion = (motion < 0) ? _motion : motion;
+    bool linear = (activeMotion == 0 || activeMotion == 1);
+
+    QString result;
+    result.reserve(length);
+
+    int kept = 0;
+    bool keptMotion = false;
+
+    for (int j = 0; j < _words.size(); ++j)
+    {
+        const Word& word = _words.at(j);
+
+        QString value = normalizeNumber(word.value);
+
+        bool skip = false;
+
+        if (word.letter == 'G')
+        {
+            if (value.toInt() == motion && motion == _motion && (motion >= 0 && motion <= 3))
+                skip = _modalMotion && (_options & OptionModalWords);
+        }
+        else if (word.letter == 'F')
+        {
+            if (value == _feed)
+                skip = (_options & OptionModalWords);
+
+            _feed = value;
+        }
+        else if (word.letter == 'X' || word.letter == 'Y' || word.letter == 'Z')
+        {
+            int axis = word.letter.toLatin1() - 'X';
+
+            if (_absolute && linear && value == _position[axis])
+                skip = (_options & OptionUnchangedAxes);
+
+            _position[axis] = value;
+        }
+
+        if (skip)
+            continue;
+
+        if (word.letter == 'G' && value.toInt() == motion)
+            keptMotion = true;
+
+        ++kept;
+
+        if (!result.isEmpty())
+            result.append(' ');
+
+        result.append(word.letter);
+        result.append((_options & OptionTrimZeros) ? value : word.value);
+    }
+
+    // A bare motion word that does not change the motion mode does nothing
+    if (kept == 1 && keptMotion && motion == _motion && (_options & OptionModalWords))
+        result.clear();
+
+    if (motion >= 0)
+        _motion = motion;
+
+    // The final height of the canned cycles depends on G98/G99
+    if (!linear && activeMotion != 2 && activeMotion != 3)
+        _position[AxisZ].clear();
+
+    if (invalidate || !_absolute)
+        invalidatePosition();
+
+    output.truncate(lineStart);
+
+    if (result.isEmpty())
+        return false;
+
+    output.append(result);
+    _outputSize += result.size() + 1;
+
+    return true;
+}
+
+QString GcodeCompressor::normalizeNumber(const QString& number)
+{
+    QString result = number;
+
+    if (result.startsWith('+'))
+        result.remove(0, 1);
+
+    bool negative = result.startsWith('-');
+
+    if (negative)
+        result.remove(0, 1);
+
+    if (result.contains('.'))
+    {
+        while (result.endsWith('0'))
+            result.chop(1);
+
+        if (result.endsWith('.'))
+            result.chop(1);
+    }
+
+    while (result.size() > 1 && result.at(0) == '0' && result.at(1) != '.')
+        result.remove(0, 1);
+
+    if (result.isEmpty() || result.startsWith('.'))
+        result.prepend('0');
+
+    if (negative && result != "0")
+        result.prepend('-');
+
+    return result;
+}
@@ -0,0 +1,93 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef GCODECOMPRESSOR_H
+#define GCODECOMPRESSOR_H
+
+
+#include <QString>
+#include <QVector>
+
+
+class GcodeCompressor
+{
+public:
+    enum Option
+    {
+        OptionNone = 0,
+        OptionModalWords = 1,
+        OptionUnchangedAxes = 2,
+        OptionTrimZeros = 4
+    };
+
+    explicit GcodeCompressor(int options = OptionModalWords | OptionUnchangedAxes | OptionTrimZeros);
+
+    int options() const { return _options; }
+
+    void setModalMotion(bool modal) { _modalMotion = modal; }
+
+    void reset();
+    bool compress(QString& output, int lineStart);
+
+    qint64 inputSize() const { return _inputSize; }
+    qint64 outputSize() const { return _outputSize; }
+
+    static QString normalizeNumber(const QString& number);
+
+private:
+    enum Axis
+    {
+        AxisX,
+        AxisY,
+        AxisZ,
+        AxisCount
+    };
+
+    struct Word
+    {
+        QChar letter;
+        QString value;
+    };
+
+    void invalidatePosition();
+
+    QVector<Word> _words;
+
+    QString _feed;
+    QString _position[AxisCount];
+
+    int _options;
+    int _motion;
+    bool _absolute;
+    bool _modalMotion;
+
+    qint64 _inputSize;
+    qint64 _outputSize;
+};
+
+
+inline void GcodeCompressor::invalidatePosition()
+{
+    for (int i = 0; i < AxisCount; ++i)
+        _position[i].clear();
+}
+
+
+#endif // GCODECOMPRESSOR_H
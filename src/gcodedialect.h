@@ -0,0 +1,158 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef GCODEDIALECT_H
+#define GCODEDIALECT_H
+
+
+#include <QString>
+
+
+// The dialects are compile-time policies. The program generator is instantiated
+// for every policy, so the output rules are inlined without any virtual calls.
+//
+//  precision          - number of decimals of the coordinates and heights, the
+//                       coordinates are whole micrometers, so their decimals
+//                       beyond 3 are zeros;
+//  lineNumbers        - prepend N-words to the program lines;
+//  lineNumberStep     - increment of the line numbers;
+//  checksum           - append the '*' checksum to the numbered lines;
+//  semicolonComments  - write comments as '; text' instead of '( text )';
+//  modalMotion        - G0/G1/G2/G3 can be omitted in the following lines;
+//  cannedCycles       - G81/G83/G73 drilling cycles are supported;
+//  arcRadius          - G2/G3 arcs are given by R instead of the I/J center offsets.
+
+class GcodeDialect
+{
+public:
+    enum Type
+    {
+        DialectLinuxCnc = 0,
+        DialectGrbl,
+        DialectMach3,
+        DialectMarlin,
+        DialectCount
+    };
+
+    static QString name(int dialect);
+};
+
+
+class LinuxCncDialect
+{
+public:
+    static const int precision = 4;
+    static const bool lineNumbers = false;
+    static const int lineNumberStep = 1;
+    static const bool checksum = false;
+    static const bool semicolonComments = false;
+    static const bool modalMotion = true;
+    static const bool cannedCycles = true;
+    static const bool arcRadius = false;
+
+    static void toolChange(QString& output, const QString& tool)
+    {
+        output.append("M6 T").append(tool);
+    }
+};
+
+
+class GrblDialect
+{
+public:
+    static const int precision = 3;
+    static const bool lineNumbers = false;
+    static const int lineNumberStep = 1;
+    static const bool checksum = false;
+    static const bool semicolonComments = false;
+    static const bool modalMotion = true;
+    static const bool cannedCycles = false;
+    static const bool arcRadius = false;
+
+    // Grbl has no tool changer, so the program is paused for manual change. The
+    // T word is accepted and ignored by Grbl, it only names the tool to insert.
+    static void toolChange(QString& output, const QString& tool)
+    {
+        output.append('T').append(tool).append(" M0");
+    }
+};
+
+
+class Mach3Dialect
+{
+public:
+    static const int precision = 4;
+    static const bool lineNumbers = true;
+    static const int lineNumberStep = 10;
+    static const bool checksum = false;
+    static const bool semicolonComments = false;
+    static const bool modalMotion = true;
+    static const bool cannedCycles = true;
+
+    // The meaning of I/J depends on the "IJ mode" of the Mach3 configuration
+    static const bool arcRadius = true;
+
+    static void toolChange(QString& output, const QString& tool)
+    {
+        output.append('T').append(tool).append(" M6");
+    }
+};
+
+
+class MarlinDialect
+{
+public:
+    static const int precision = 3;
+    static const bool lineNumbers = true;
+    static const int lineNumberStep = 1;
+    static const bool checksum = true;
+    static const bool semicolonComments = true;
+    static const bool modalMotion = false;
+    static const bool cannedCycles = false;
+    static const bool arcRadius = false;
+
+    static void toolChange(QString& output, const QString& tool)
+    {
+        output.append("M0 Insert tool T").append(tool);
+    }
+};
+
+
+inline QString GcodeDialect::name(int dialect)
+{
+    switch (dialect)
+    {
+    case DialectLinuxCnc:
+        return "LinuxCNC";
+    case DialectGrbl:
+        return "Grbl";
+    case DialectMach3:
+        return "Mach3";
+    case DialectMarlin:
+        return "Marlin";
+    default:
+        break;
+    }
+
+    return QString();
+}
+
+
+#endif // GCODEDIALECT_H
@@ -0,0 +1,575 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "gcodereader.h"
+
+#include <QtMath>
+
+#include <cstring>
+
+
+namespace
+{
+
+const int MaximumCodes = 8;
+const int MaximumPecks = 10000;
+
+const double Powers[] =
+{
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18
+};
+
+// Reads a decimal number without the exponent, the fastest way for G-code words
+bool readNumber(const char*& pointer, const char* end, double& value)
+{
+    bool negative = false;
+
+    if (pointer < end && (*pointer == '-' || *pointer == '+'))
+    {
+        negative = (*pointer == '-');
+        ++pointer;
+    }
+
+    quint64 mantissa = 0;
+    int digits = 0;
+    int fraction = 0;
+    bool point = false;
+
+    for (; pointer < end; ++pointer)
+    {
+        char c = *pointer;
+
+        if (c >= '0' && c <= '9')
+        {
+            // The digits beyond the precision of a double are dropped
+            if (digits < 18)
+            {
+                mantissa = mantissa * 10 + static_cast<quint64>(c - '0');
+                ++digits;
+
+                if (point)
+                    ++fraction;
+            }
+            else if (!point)
+            {
+                return false;
+            }
+        }
+        else if (c == '.' && !point)
+        {
+            point = true;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if (digits == 0)
+        return false;
+
+    value = static_cast<double>(mantissa) / Powers[fraction];
+
+    if (negative)
+        value = -value;
+
+    return true;
+}
+
+// Returns the number of the first T word of a message or -1
+int readMessageTool(const char* pointer, const char* end)
+{
+    const char* checksum = static_cast<const char*>(
+        memchr(pointer, '*', static_cast<size_t>(end - pointer)));
+
+    if (checksum)
+        end = checksum;
+
+    for (bool separated = true; pointer < end; ++pointer)
+    {
+        if (separated && *pointer == 'T' && pointer + 1 < end &&
+            pointer[1] >= '0' && pointer[1] <= '9')
+        {
+            int tool = 0;
+
+            for (++pointer; pointer < end && *pointer >= '0' && *pointer <= '9'; ++pointer)
+                tool = tool * 10 + (*pointer - '0');
+
+            return tool;
+        }
+
+        separated = (*pointer == ' ' || *pointer == '\t');
+    }
+
+    return -1;
+}
+
+} // namespace
+
+
+GcodeReader::GcodeReader()
+{
+    reset();
+}
+
+void GcodeReader::reset()
+{
+    _motion = MotionRapid;
+    _cycle = 0;
+    _absolute = true;
+    _initialRetract = true;
+    _scale = 1.0;
+    _feed = 0.0;
+    _speed = 0.0;
+    _spindle = false;
+    _tool = 0;
+    _nextTool = 0;
+    _line = 0;
+
+    _x = 0.0;
+    _y = 0.0;
+    _z = 0.0;
+
+    _cycleDepth = 0.0;
+    _cycleRetract = 0.0;
+    _cyclePeck = 0.0;
+    _cycleInitial = 0.0;
+}
+
+int GcodeReader::read(const char* data, qint64 size, Toolpath& toolpath)
+{
+    int ignored = 0;
+
+    const char* pointer = data;
+    const char* end = data + size;
+
+    while (pointer < end)
+    {
+        const char* lineEnd = static_cast<const char*>(
+            memchr(pointer, '\n', static_cast<size_t>(end - pointer)));
+
+        if (!lineEnd)
+            lineEnd = end;
+
+        ++_line;
+
+        if (!readLine(pointer, lineEnd, toolpath))
+            ++ignored;
+
+        pointer = lineEnd + 1;
+    }
+
+    return ignored;
+}
+
+int GcodeReader::read(QFile& file, Toolpath& toolpath)
+{
+    qint64 size = file.size();
+
+    if (size <= 0)
+        return 0;
+
+    // Mapping avoids copying the file, which matters for large programs
+    uchar* data = file.map(0, size);
+
+    if (!data)
+        return read(file.readAll(), toolpath);
+
+    int ignored = read(reinterpret_cast<const char*>(data), size, toolpath);
+    file.unmap(data);
+
+    return ignored;
+}
+
+bool GcodeReader::readLine(const char* begin, const char* end, Toolpath& toolpath)
+{
+    bool known = true;
+
+    bool present[26] = {};
+    double words[26] = {};
+
+    int codes[MaximumCodes];
+    int codeCount = 0;
+
+    bool toolChange = false;
+    bool pause = false;
+    int messageTool = -1;
+
+    const char* pointer = begin;
+
+    while (pointer < end)
+    {
+        char c = *pointer;
+
+        if (c == ' ' || c == '\t' || c == '\r' || c == '%' || c == '/')
+        {
+            ++pointer;
+            continue;
+        }
+
+        // The checksum of the numbered lines ends the commands
+        if (c == ';' || c == '*')
+            break;
+
+        if (c == '(')
+        {
+            const char* close = static_cast<const char*>(
+                memchr(pointer, ')', static_cast<size_t>(end - pointer)));
+
+            pointer = close ? close + 1 : end;
+            continue;
+        }
+
+        if (c >= 'a' && c <= 'z')
+            c = static_cast<char>(c - 'a' + 'A');
+
+        if (c < 'A' || c > 'Z')
+        {
+            known = false;
+            ++pointer;
+            continue;
+        }
+
+        ++pointer;
+
+        while (pointer < end && (*pointer == ' ' || *pointer == '\t'))
+            ++pointer;
+
+        double value;
+
+        if (!readNumber(pointer, end, value))
+        {
+            known = false;
+            continue;
+        }
+
+        int letter = c - 'A';
+
+        if (c == 'G')
+        {
+            // G91.1 and the like are kept as 911
+            if (codeCount < MaximumCodes)
+                codes[codeCount++] = static_cast<int>(value * 10.0 + 0.5);
+            else
+                known = false;
+        }
+        else if (c == 'M')
+        {
+            switch (qRound(value))
+            {
+            case 3:
+            case 4:
+                _spindle = true;
+                break;
+            case 5:
+            case 2:
+            case 30:
+                _spindle = false;
+                break;
+            case 6:
+                toolChange = true;
+                break;
+            case 0:
+            case 1:
+                // The rest of the line is the message of the pause, a T word in
+                // it names the tool to insert
+                pause = true;
+                messageTool = readMessageTool(pointer, end);
+                pointer = end;
+                break;
+            default:
+                break;
+            }
+        }
+        else
+        {
+            present[letter] = true;
+            words[letter] = value;
+        }
+    }
+
+    bool motion = true;
+
+    for (int i = 0; i < codeCount; ++i)
+    {
+        switch (codes[i])
+        {
+        case 0:
+            _motion = MotionRapid;
+            break;
+        case 10:
+            _motion = MotionLinear;
+            break;
+        case 20:
+            _motion = MotionClockwise;
+            break;
+        case 30:
+            _motion = MotionCounterClockwise;
+            break;
+        case 40:
+        case 100:
+        case 280:
+        case 300:
+        case 530:
+        case 920:
+            // The axis words of these commands are not a move
+            motion = false;
+            break;
+        case 200:
+            _scale = 25.4;
+            break;
+        case 210:
+            _scale = 1.0;
+            break;
+        case 730:
+        case 810:
+        case 820:
+        case 830:
+            if (_motion != MotionCycle)
+                _cycleInitial = _z;
+
+            _motion = MotionCycle;
+            _cycle = codes[i];
+            break;
+        case 800:
+            _motion = MotionRapid;
+            break;
+        case 900:
+            _absolute = true;
+            break;
+        case 910:
+            _absolute = false;
+            break;
+        case 980:
+            _initialRetract = true;
+            break;
+        case 990:
+            _initialRetract = false;
+            break;
+        case 170:
+        case 400:
+        case 490:
+        case 540:
+        case 610:
+        case 640:
+        case 901:
+        case 911:
+        case 940:
+            break;
+        default:
+            known = false;
+            break;
+        }
+    }
+
+    const int X = 'X' - 'A';
+    const int Y = 'Y' - 'A';
+    const int Z = 'Z' - 'A';
+
+    if (present['F' - 'A'])
+        _feed = words['F' - 'A'] * _scale;
+
+    if (present['S' - 'A'])
+        _speed = qAbs(words['S' - 'A']);
+
+    if (present['T' - 'A'])
+        _nextTool = qRound(words['T' - 'A']);
+
+    if (messageTool >= 0)
+        _nextTool = messageTool;
+
+    // A pause is a manual tool change only when another tool is pending
+    if (toolChange || (pause && _nextTool != _tool))
+    {
+        _tool = _nextTool;
+        ++toolpath.toolChanges;
+    }
+
+    if (!motion || !(present[X] || present[Y] || present[Z]))
+        return known;
+
+    double x = _x;
+    double y = _y;
+    double z = _z;
+
+    if (present[X])
+        x = _absolute ? words[X] * _scale : _x + words[X] * _scale;
+
+    if (present[Y])
+        y = _absolute ? words[Y] * _scale : _y + words[Y] * _scale;
+
+    if (present[Z] && _motion != MotionCycle)
+        z = _absolute ? words[Z] * _scale : _z + words[Z] * _scale;
+
+    switch (_motion)
+    {
+    case MotionRapid:
+        addMove(toolpath, ToolpathMove::TypeRapid, x, y, z);
+        break;
+    case MotionLinear:
+        addMove(toolpath, ToolpathMove::TypeLinear, x, y, z);
+        break;
+    case MotionClockwise:
+    case MotionCounterClockwise:
+    {
+        int type = (_motion == MotionClockwise) ? ToolpathMove::TypeClockwise
+            : ToolpathMove::TypeCounterClockwise;
+
+        double centerX = _x + words['I' - 'A'] * _scale;
+        double centerY = _y + words['J' - 'A'] * _scale;
+
+        if (present['R' - 'A'])
+        {
+            // The center lies on the bisector of the chord, a negative radius
+            // selects the arc longer than a half circle
+            double radius = words['R' - 'A'] * _scale;
+            double dx = x - _x;
+            double dy = y - _y;
+            double chord = qSqrt(dx * dx + dy * dy);
+
+            if (chord <= 0.0)
+                return false;
+
+            double height = qSqrt(qMax(0.0, radius * radius - chord * chord / 4.0));
+            double side = (type == ToolpathMove::TypeCounterClockwise) ? 1.0 : -1.0;
+
+            if (radius < 0.0)
+                side = -side;
+
+            centerX = (_x + x) / 2.0 - side * height * dy / chord;
+            centerY = (_y + y) / 2.0 + side * height * dx / chord;
+        }
+        else if (!present['I' - 'A'] && !present['J' - 'A'])
+        {
+            return false;
+        }
+
+        addArc(toolpath, type, x, y, z, centerX, centerY);
+        break;
+    }
+    case MotionCycle:
+        if (present[Z])
+            _cycleDepth = _absolute ? words[Z] * _scale : _cycleInitial + words[Z] * _scale;
+
+        if (present['R' - 'A'])
+        {
+            _cycleRetract = _absolute ? words['R' - 'A'] * _scale
+                : _cycleInitial + words['R' - 'A'] * _scale;
+        }
+
+        if (present['Q' - 'A'])
+            _cyclePeck = qAbs(words['Q' - 'A'] * _scale);
+
+        addCycle(toolpath, x, y);
+        break;
+    default:
+        break;
+    }
+
+    return known;
+}
+
+void GcodeReader::addMove(Toolpath& toolpath, int type, double x, double y, double z)
+{
+    if (x == _x && y == _y && z == _z)
+        return;
+
+    ToolpathMove move;
+    move.type = type;
+    move.x = x;
+    move.y = y;
+    move.z = z;
+    move.feed = _feed;
+    move.spindle = _spindle ? _speed : 0.0;
+    move.tool = _tool;
+    move.line = _line;
+
+    toolpath.moves.append(move);
+
+    _x = x;
+    _y = y;
+    _z = z;
+}
+
+void GcodeReader::addArc(Toolpath& toolpath, int type, double x, double y, double z,
+    double centerX, double centerY)
+{
+    ToolpathMove move;
+    move.type = type;
+    move.x = x;
+    move.y = y;
+    move.z = z;
+    move.centerX = centerX;
+    move.centerY = centerY;
+    move.feed = _feed;
+    move.spindle = _spindle ? _speed : 0.0;
+    move.tool = _tool;
+    move.line = _line;
+
+    toolpath.moves.append(move);
+
+    _x = x;
+    _y = y;
+    _z = z;
+}
+
+void GcodeReader::addCycle(Toolpath& toolpath, double x, double y)
+{
+    double retract = _cycleRetract;
+    double depth = _cycleDepth;
+
+    if (_z < retract)
+        addMove(toolpath, ToolpathMove::TypeRapid, _x, _y, retract);
+
+    addMove(toolpath, ToolpathMove::TypeRapid, x, y, _z);
+    addMove(toolpath, ToolpathMove::TypeRapid, x, y, retract);
+
+    bool pecking = (_cycle == 730 || _cycle == 830) && _cyclePeck > 0.0 &&
+        (retract - depth) / _cyclePeck < MaximumPecks;
+
+    if (pecking)
+    {
+        // G83 leaves the hole after every peck, G73 only breaks the chip
+        double bottom = retract;
+
+        while (bottom > depth)
+        {
+            double next = qMax(depth, bottom - _cyclePeck);
+
+            if (_cycle == 830)
+                addMove(toolpath, ToolpathMove::TypeRapid, x, y, bottom);
+
+            addMove(toolpath, ToolpathMove::TypeLinear, x, y, next);
+
+            if (_cycle == 830 && next > depth)
+                addMove(toolpath, ToolpathMove::TypeRapid, x, y, retract);
+
+            bottom = next;
+        }
+    }
+    else
+    {
+        addMove(toolpath, ToolpathMove::TypeLinear, x, y, depth);
+    }
+
+    addMove(toolpath, ToolpathMove::TypeRapid, x, y,
+        _initialRetract ? qMax(_cycleInitial, retract) : retract);
+}
@@ -0,0 +1,103 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef GCODEREADER_H
+#define GCODEREADER_H
+
+
+#include <QByteArray>
+#include <QFile>
+
+#include "toolpath.h"
+
+
+// Interprets a G-code program into the machine moves. The reader keeps the modal
+// state (motion, units, distance mode, feed, tool) between the lines, supports
+// G0-G3 with I/J or R and expands the G73, G81-G83 drilling cycles. The spindle
+// speed is tracked with S and M3-M5. A tool is changed by M6, or by an M0/M1 pause
+// while another tool is pending, as in the Grbl and Marlin programs.
+class GcodeReader
+{
+public:
+    GcodeReader();
+
+    void reset();
+
+    // Appends the moves of the program to the toolpath and returns the number of
+    // the lines that contain commands which have been ignored
+    int read(const char* data, qint64 size, Toolpath& toolpath);
+    int read(const QByteArray& program, Toolpath& toolpath);
+
+    // Reads an open file, mapping it into the memory when possible
+    int read(QFile& file, Toolpath& toolpath);
+
+    int lines() const;
+
+private:
+    enum Motion
+    {
+        MotionRapid = 0,
+        MotionLinear,
+        MotionClockwise,
+        MotionCounterClockwise,
+        MotionCycle
+    };
+
+    bool readLine(const char* begin, const char* end, Toolpath& toolpath);
+    void addMove(Toolpath& toolpath, int type, double x, double y, double z);
+    void addArc(Toolpath& toolpath, int type, double x, double y, double z,
+        double centerX, double centerY);
+    void addCycle(Toolpath& toolpath, double x, double y);
+
+    int _motion;
+    int _cycle;
+    bool _absolute;
+    bool _initialRetract;
+    double _scale;
+    double _feed;
+    double _speed;
+    bool _spindle;
+    int _tool;
+    int _nextTool;
+    int _line;
+
+    double _x;
+    double _y;
+    double _z;
+
+    double _cycleDepth;
+    double _cycleRetract;
+    double _cyclePeck;
+    double _cycleInitial;
+};
+
+
+inline int GcodeReader::read(const QByteArray& program, Toolpath& toolpath)
+{
+    return read(program.constData(), program.size(), toolpath);
+}
+
+inline int GcodeReader::lines() const
+{
+    return _line;
+}
+
+
+#endif // GCODEREADER_H
@@ -0,0 +1,152 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "gcodetemplate.h"
+
+
+GcodeTemplate::GcodeTemplate()
+{
+}
+
+void GcodeTemplate::compile(const QString& text)
+{
+    _segments.clear();
+    _lines.clear();
+    _unknown.clear();
+
+    // An empty template writes nothing, not a blank line
+    if (text.trimmed().isEmpty())
+        return;
+
+    QStringList lines = text.split('\n');
+
+    for (int i = 0; i < lines.size(); ++i)
+    {
+        const QString& source = lines.at(i);
+
+        Line line;
+        line.first = _segments.size();
+        line.count = 0;
+        line.slotMask = 0;
+
+        QString literal;
+
+        int position = 0;
+        while (position < source.size())
+        {
+            int open = source.indexOf('{', position);
+            int close = (open < 0) ? -1 : source.indexOf('}', open + 1);
+
+            if (close < 0)
+            {
+                literal.append(source.mid(position));
+                break;
+            }
+
+            QString name = source.mid(open + 1, close - open - 1).trimmed().toLower();
+
+            int slot = SlotCount;
+            for (int j = 0; j < SlotCount; ++j)
+            {
+                if (name == slotName(j))
+                {
+                    slot = j;
+                    break;
+                }
+            }
+
+            literal.append(source.mid(position, open - position));
+
+            if (slot == SlotCount)
+            {
+                // Keep unknown placeholders in the output as is
+                literal.append(source.mid(open, close - open + 1));
+
+                if (!_unknown.contains(source.mid(open, close - open + 1)))
+                    _unknown.append(source.mid(open, close - open + 1));
+            }
+            else
+            {
+                if (!literal.isEmpty())
+                {
+                    Segment segment;
+                    segment.literal = literal;
+                    segment.slot = -1;
+                    _segments.append(segment);
+                    literal.clear();
+                }
+
+                Segment segment;
+                segment.slot = slot;
+                _segments.append(segment);
+
+                line.slotMask |= (1u << slot);
+            }
+
+            position = close + 1;
+        }
+
+        if (!literal.isEmpty())
+        {
+            Segment segment;
+            segment.literal = literal;
+            segment.slot = -1;
+            _segments.append(segment);
+        }
+
+        line.count = _segments.size() - line.first;
+        _lines.append(line);
+    }
+}
+
+QString GcodeTemplate::slotName(int slot)
+{
+    switch (slot)
+    {
+    case SlotX:
+        return "x";
+    case SlotY:
+        return "y";
+    case SlotTool:
+        return "tool";
+    case SlotDiameter:
+        return "diameter";
+    case SlotFeed:
+        return "feed";
+    case SlotPlunge:
+        return "plunge";
+    case SlotSpindle:
+        return "spindle";
+    case SlotSafeZ:
+        return "safe_z";
+    case SlotDepth:
+        return "depth";
+    case SlotStartHeight:
+        return "start_height";
+    case SlotTcHeight:
+        return "tc_height";
+    case SlotToolChange:
+        return "tool_change";
+    default:
+        break;
+    }
+
+    return QString();
+}
@@ -0,0 +1,141 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef GCODETEMPLATE_H
+#define GCODETEMPLATE_H
+
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+
+class GcodeTemplate
+{
+public:
+    enum Slot
+    {
+        SlotX,
+        SlotY,
+        SlotTool,
+        SlotDiameter,
+        SlotFeed,
+        SlotPlunge,
+        SlotSpindle,
+        SlotSafeZ,
+        SlotDepth,
+        SlotStartHeight,
+        SlotTcHeight,
+        SlotToolChange,
+        SlotCount
+    };
+
+    class Values
+    {
+    public:
+        Values()
+            : _emptyMask((1u << SlotCount) - 1)
+        {
+        }
+
+        void set(int slot, const QString& value);
+        const QString& at(int slot) const { return _values[slot]; }
+
+    private:
+        QString _values[SlotCount];
+        quint32 _emptyMask;
+
+        friend class GcodeTemplate;
+    };
+
+    GcodeTemplate();
+
+    void compile(const QString& text);
+
+    template <class Writer>
+    void render(Writer& writer, const Values& values) const;
+
+    bool isEmpty() const { return _lines.isEmpty(); }
+    const QStringList& unknownPlaceholders() const { return _unknown; }
+
+    static QString slotName(int slot);
+
+private:
+    struct Segment
+    {
+        QString literal;
+        int slot;
+    };
+
+    struct Line
+    {
+        int first;
+        int count;
+        quint32 slotMask;
+    };
+
+    QVector<Segment> _segments;
+    QVector<Line> _lines;
+    QStringList _unknown;
+};
+
+
+inline void GcodeTemplate::Values::set(int slot, const QString& value)
+{
+    _values[slot] = value;
+
+    if (value.isEmpty())
+        _emptyMask |= (1u << slot);
+    else
+        _emptyMask &= ~(1u << slot);
+}
+
+
+template <class Writer>
+inline void GcodeTemplate::render(Writer& writer, const Values& values) const
+{
+    const Segment* segments = _segments.constData();
+
+    for (int i = 0; i < _lines.size(); ++i)
+    {
+        const Line& line = _lines.at(i);
+
+        // Lines referring to an undefined value are omitted
+        if (line.slotMask & values._emptyMask)
+            continue;
+
+        writer.beginLine();
+
+        QString& output = writer.buffer();
+
+        for (int j = line.first; j < line.first + line.count; ++j)
+        {
+            if (segments[j].slot < 0)
+                output.append(segments[j].literal);
+            else
+                output.append(values._values[segments[j].slot]);
+        }
+
+        writer.endLine();
+    }
+}
+
+
+#endif // GCODETEMPLATE_H
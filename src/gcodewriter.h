@@ -0,0 +1,242 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef GCODEWRITER_H
+#define GCODEWRITER_H
+
+
+#include <QString>
+
+#include "utilities.h"
+#include "gcodecompressor.h"
+
+
+template <class Dialect>
+class GcodeWriter
+{
+public:
+    explicit GcodeWriter(QString& output)
+        : _output(output)
+        , _lineStart(output.size())
+        , _lineNumber(Dialect::lineNumberStep)
+        , _motion(-1)
+        , _compressor(nullptr)
+    {
+    }
+
+    QString& buffer() { return _output; }
+
+    void setCompressor(GcodeCompressor* compressor);
+
+    void beginLine() { _lineStart = _output.size(); }
+    void endLine();
+
+    void line(const QString& text);
+    void comment(const QString& text);
+
+    static QString coordinate(qint64 value);
+    static QString height(double value);
+    static QString toolChange(const QString& tool);
+
+private:
+    bool lineMotion(int* code) const;
+
+    QString& _output;
+
+    int _lineStart;
+    int _lineNumber;
+    int _motion;
+
+    GcodeCompressor* _compressor;
+};
+
+
+template <class Dialect>
+inline void GcodeWriter<Dialect>::endLine()
+{
+    int length = _output.size() - _lineStart;
+
+    if (length > 0)
+    {
+        QChar first = _output.at(_lineStart);
+
+        if (_compressor && first != '(' && first != ';')
+        {
+            // The line can be removed completely when all its words are redundant
+            if (!_compressor->compress(_output, _lineStart))
+                return;
+
+            first = _output.at(_lineStart);
+        }
+
+        if (first == '(' || first == ';')
+        {
+            if (Dialect::semicolonComments && first == '(' && _output.endsWith(')'))
+            {
+                _output[_lineStart] = ';';
+                _output.chop(1);
+
+                while (_output.endsWith(' '))
+                    _output.chop(1);
+            }
+        }
+        else
+        {
+            if (!Dialect::modalMotion)
+            {
+                // Track the motion mode and restore it for lines with bare axis words
+                int code;
+
+                if (lineMotion(&code))
+                {
+                    _motion = (code >= 0 && code <= 3) ? code : -1;
+                }
+                else if (_motion >= 0 && (first == 'X' || first == 'Y' || first == 'Z' ||
+                    first == 'x' || first == 'y' || first == 'z'))
+                {
+                    _output.insert(_lineStart, QString("G%1 ").arg(_motion));
+                }
+            }
+
+            if (Dialect::lineNumbers)
+            {
+                _output.insert(_lineStart, QString("N%1 ").arg(_lineNumber));
+                _lineNumber += Dialect::lineNumberStep;
+
+                if (Dialect::checksum)
+                {
+                    int checksum = 0;
+
+                    for (int i = _lineStart; i < _output.size(); ++i)
+                        checksum ^= _output.at(i).toLatin1();
+
+                    _output.append('*').append(QString::number(checksum & 0xFF));
+                }
+            }
+        }
+    }
+
+    _output.append('\n');
+    _lineStart = _output.size();
+}
+
+template <class Dialect>
+inline bool GcodeWriter<Dialect>::lineMotion(int* code) const
+{
+    // The last motion word of the current line wins: "G90 G00 X1" is a rapid.
+    // Canned cycles and probing are reported too, as they replace the motion mode.
+    bool found = false;
+
+    for (int i = _lineStart; i < _output.size(); ++i)
+    {
+        QChar c = _output.at(i);
+
+        if (c == '(')
+        {
+            while (i < _output.size() && _output.at(i) != ')')
+                ++i;
+
+            continue;
+        }
+
+        if (c == ';')
+            break;
+
+        if ((c != 'G' && c != 'g') || (i > _lineStart && _output.at(i - 1).isLetterOrNumber()))
+            continue;
+
+        int value = 0;
+        int digits = 0;
+
+        while (i + 1 < _output.size() && _output.at(i + 1).isDigit())
+        {
+            value = value * 10 + _output.at(++i).digitValue();
+            ++digits;
+        }
+
+        if (digits == 0)
+            continue;
+
+        // Of the codes with decimals only the probing moves G38.x are motions
+        if (i + 1 < _output.size() && _output.at(i + 1) == '.' && value != 38)
+            continue;
+
+        if ((value >= 0 && value <= 3) || value == 38 || value == 73 || (value >= 80 && value <= 89))
+        {
+            *code = value;
+            found = true;
+        }
+    }
+
+    return found;
+}
+
+template <class Dialect>
+inline void GcodeWriter<Dialect>::setCompressor(GcodeCompressor* compressor)
+{
+    _compressor = compressor;
+
+    if (_compressor)
+        _compressor->setModalMotion(Dialect::modalMotion);
+}
+
+template <class Dialect>
+inline void GcodeWriter<Dialect>::line(const QString& text)
+{
+    beginLine();
+    _output.append(text);
+    endLine();
+}
+
+template <class Dialect>
+inline void GcodeWriter<Dialect>::comment(const QString& text)
+{
+    beginLine();
+
+    if (Dialect::semicolonComments)
+        _output.append("; ").append(text);
+    else
+        _output.append("( ").append(text).append(" )");
+
+    endLine();
+}
+
+template <class Dialect>
+inline QString GcodeWriter<Dialect>::coordinate(qint64 value)
+{
+    return Utilities::coordinateToString(value, Dialect::precision);
+}
+
+template <class Dialect>
+inline QString GcodeWriter<Dialect>::height(double value)
+{
+    return Utilities::doubleToString(value, Dialect::precision);
+}
+
+template <class Dialect>
+inline QString GcodeWriter<Dialect>::toolChange(const QString& tool)
+{
+    QString result;
+    Dialect::toolChange(result, tool);
+    return result;
+}
+
+
+#endif // GCODEWRITER_H
@@ -0,0 +1,337 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "geometrytransform.h"
+
+#include <QtMath>
+
+#include <cmath>
+
+
+// The kernels walk the coordinate arrays of a curve without branches, so the
+// compiler can vectorize them.
+namespace
+{
+
+void negate(qint64* values, int count)
+{
+    for (int i = 0; i < count; ++i)
+        values[i] = -values[i];
+}
+
+void translate(qint64* values, int count, qint64 delta)
+{
+    for (int i = 0; i < count; ++i)
+        values[i] += delta;
+}
+
+// (x, y) becomes (-y, x)
+void quarterTurn(qint64* x, qint64* y, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        qint64 t = x[i];
+        x[i] = -y[i];
+        y[i] = t;
+    }
+}
+
+// (x, y) becomes (y, -x)
+void reverseQuarterTurn(qint64* x, qint64* y, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        qint64 t = x[i];
+        x[i] = y[i];
+        y[i] = -t;
+    }
+}
+
+// Extends the box by the points of the curve under the linear part of a matrix
+void includeTurned(const AbstractCurve& curve, double m11, double m12, double m21, double m22,
+    BoundingBox& box)
+{
+    if (curve.type() == AbstractCurve::CurveTypeNone)
+        return;
+
+    const qint64* x = curve.x();
+    const qint64* y = curve.y();
+
+    for (int i = 0; i < curve.count(); ++i)
+        box.include(qRound64(m11 * x[i] + m21 * y[i]), qRound64(m12 * x[i] + m22 * y[i]));
+}
+
+void rotate(qint64* x, qint64* y, int count, double cosine, double sine)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        double px = static_cast<double>(x[i]);
+        double py = static_cast<double>(y[i]);
+
+        x[i] = qRound64(px * cosine - py * sine);
+        y[i] = qRound64(px * sine + py * cosine);
+    }
+}
+
+} // namespace
+
+
+bool GeometryTransform::isIdentity() const
+{
+    return !mirrorX && !mirrorY && std::fmod(rotation, 360.0) == 0.0 && !normalize &&
+        offsetX == 0 && offsetY == 0;
+}
+
+void GeometryTransform::apply(QList<AbstractCurve>& curves) const
+{
+    if (isIdentity())
+        return;
+
+    double angle;
+    int quarters = quarterTurns(angle);
+
+    // A single mirror turns the clockwise arcs into the counterclockwise ones
+    bool reverse = (mirrorX != mirrorY);
+
+    for (int i = 0; i < curves.size(); ++i)
+    {
+        AbstractCurve& curve = curves[i];
+        int count = curve.count();
+
+        turn(curve._x.data(), curve._y.data(), count, quarters, angle);
+
+        if (curve._motion.isEmpty())
+            continue;
+
+        turn(curve._centerX.data(), curve._centerY.data(), count, quarters, angle);
+
+        if (reverse)
+        {
+            for (int j = 0; j < count; ++j)
+            {
+                if (curve._motion[j] == AbstractCurve::MotionClockwise)
+                    curve._motion[j] = AbstractCurve::MotionCounterClockwise;
+                else if (curve._motion[j] == AbstractCurve::MotionCounterClockwise)
+                    curve._motion[j] = AbstractCurve::MotionClockwise;
+            }
+        }
+    }
+
+    qint64 deltaX = offsetX;
+    qint64 deltaY = offsetY;
+
+    if (normalize)
+    {
+        BoundingBox box;
+
+        foreach (const AbstractCurve& curve, curves)
+        {
+            if (curve.type() != AbstractCurve::CurveTypeNone)
+                box.include(curve.x(), curve.y(), curve.count());
+        }
+
+        deltaX -= box.minX;
+        deltaY -= box.minY;
+    }
+
+    if (deltaX == 0 && deltaY == 0)
+        return;
+
+    for (int i = 0; i < curves.size(); ++i)
+    {
+        AbstractCurve& curve = curves[i];
+        int count = curve.count();
+
+        translate(curve._x.data(), count, deltaX);
+        translate(curve._y.data(), count, deltaY);
+
+        if (!curve._motion.isEmpty())
+        {
+            translate(curve._centerX.data(), count, deltaX);
+            translate(curve._centerY.data(), count, deltaY);
+        }
+    }
+}
+
+void GeometryTransform::apply(qint64* x, qint64* y, int count) const
+{
+    if (isIdentity() || count < 1)
+        return;
+
+    double angle;
+    int quarters = quarterTurns(angle);
+
+    turn(x, y, count, quarters, angle);
+
+    qint64 deltaX = offsetX;
+    qint64 deltaY = offsetY;
+
+    if (normalize)
+    {
+        BoundingBox box;
+        box.include(x, y, count);
+
+        deltaX -= box.minX;
+        deltaY -= box.minY;
+    }
+
+    translate(x, count, deltaX);
+    translate(y, count, deltaY);
+}
+
+QTransform GeometryTransform::matrix(const AbstractParser& parser, BoundingBox& bounds) const
+{
+    const QList<AbstractCurve>& curves = parser.curves();
+
+    double m11;
+    double m12;
+    double m21;
+    double m22;
+    linear(m11, m12, m21, m22);
+
+    BoundingBox turned;
+
+    foreach (const AbstractCurve& curve, curves)
+        includeTurned(curve, m11, m12, m21, m22, turned);
+
+    // The copies are linear in k, the first and the last copy give the extents
+    foreach (const CurveRepeat& repeat, parser.repeats())
+    {
+        BoundingBox range;
+
+        for (int i = qMax(repeat.first, 0); i < qMin(repeat.last, curves.size()); ++i)
+            includeTurned(curves[i], m11, m12, m21, m22, range);
+
+        if (range.isEmpty())
+            continue;
+
+        double stepX = m11 * repeat.x + m21 * repeat.y;
+        double stepY = m12 * repeat.x + m22 * repeat.y;
+
+        for (int k = 1; k <= repeat.count; k += qMax(repeat.count - 1, 1))
+        {
+            qint64 shiftX = qRound64(stepX * k);
+            qint64 shiftY = qRound64(stepY * k);
+
+            turned.include(range.minX + shiftX, range.minY + shiftY);
+            turned.include(range.maxX + shiftX, range.maxY + shiftY);
+        }
+    }
+
+    qint64 deltaX = offsetX;
+    qint64 deltaY = offsetY;
+
+    if (normalize)
+    {
+        deltaX -= turned.minX;
+        deltaY -= turned.minY;
+    }
+
+    bounds = BoundingBox();
+
+    if (!turned.isEmpty())
+    {
+        bounds.include(turned.minX + deltaX, turned.minY + deltaY);
+        bounds.include(turned.maxX + deltaX, turned.maxY + deltaY);
+    }
+
+    return QTransform(m11, m12, m21, m22, deltaX / 1000.0, deltaY / 1000.0);
+}
+
+QTransform GeometryTransform::matrix() const
+{
+    double m11;
+    double m12;
+    double m21;
+    double m22;
+    linear(m11, m12, m21, m22);
+
+    return QTransform(m11, m12, m21, m22, offsetX / 1000.0, offsetY / 1000.0);
+}
+
+void GeometryTransform::linear(double& m11, double& m12, double& m21, double& m22) const
+{
+    double angle;
+    int quarters = quarterTurns(angle);
+
+    double cosine = qCos(qDegreesToRadians(angle));
+    double sine = qSin(qDegreesToRadians(angle));
+
+    if (quarters >= 0)
+    {
+        static const double cosines[4] = { 1.0, 0.0, -1.0, 0.0 };
+        static const double sines[4] = { 0.0, 1.0, 0.0, -1.0 };
+
+        cosine = cosines[quarters];
+        sine = sines[quarters];
+    }
+
+    double scaleX = mirrorX ? -1.0 : 1.0;
+    double scaleY = mirrorY ? -1.0 : 1.0;
+
+    m11 = cosine * scaleX;
+    m12 = sine * scaleX;
+    m21 = -sine * scaleY;
+    m22 = cosine * scaleY;
+}
+
+int GeometryTransform::quarterTurns(double& angle) const
+{
+    angle = std::fmod(rotation, 360.0);
+
+    if (angle < 0.0)
+        angle += 360.0;
+
+    // The quarter turns keep the integer coordinates exact, -1 for the other angles
+    int quarters = qRound(angle / 90.0);
+
+    if (qAbs(angle - quarters * 90.0) > 1e-9)
+        return -1;
+
+    return quarters % 4;
+}
+
+void GeometryTransform::turn(qint64* x, qint64* y, int count, int quarters, double angle) const
+{
+    if (mirrorX)
+        negate(x, count);
+
+    if (mirrorY)
+        negate(y, count);
+
+    if (quarters < 0)
+    {
+        double radians = qDegreesToRadians(angle);
+        rotate(x, y, count, qCos(radians), qSin(radians));
+    }
+    else if (quarters == 2)
+    {
+        negate(x, count);
+        negate(y, count);
+    }
+    else if (quarters == 3)
+    {
+        reverseQuarterTurn(x, y, count);
+    }
+    else if (quarters == 1)
+    {
+        quarterTurn(x, y, count);
+    }
+}
@@ -0,0 +1,83 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef GEOMETRYTRANSFORM_H
+#define GEOMETRYTRANSFORM_H
+
+
+#include <QList>
+#include <QTransform>
+
+#include "abstractparser.h"
+#include "boundingbox.h"
+
+
+// Places the parsed geometry on the machine: mirrors it for the bottom side of
+// double-sided boards, turns it and moves it to the fixture. The steps are done
+// in the order of the fields.
+class GeometryTransform
+{
+public:
+    GeometryTransform()
+        : mirrorX(false)
+        , mirrorY(false)
+        , rotation(0.0)
+        , normalize(false)
+        , offsetX(0)
+        , offsetY(0)
+    {
+    }
+
+    bool isIdentity() const;
+
+    void apply(QList<AbstractCurve>& curves) const;
+
+    // The same for the points, the normalization takes the extents of these points
+    void apply(qint64* x, qint64* y, int count) const;
+
+    // The transform of the geometry of the parser in millimetres and its extents
+    // after it together with the repeated copies, the curves stay unchanged
+    QTransform matrix(const AbstractParser& parser, BoundingBox& bounds) const;
+
+    // The transform of the points in millimetres, without the normalization
+    QTransform matrix() const;
+
+    // Negate the X (across the Y axis) or the Y coordinates
+    bool mirrorX;
+    bool mirrorY;
+
+    // Counterclockwise in degrees, the multiples of 90 degrees are exact
+    double rotation;
+
+    // Moves the lower left corner of the geometry to the origin
+    bool normalize;
+
+    // Micrometres
+    qint64 offsetX;
+    qint64 offsetY;
+
+private:
+    void linear(double& m11, double& m12, double& m21, double& m22) const;
+    int quarterTurns(double& angle) const;
+    void turn(qint64* x, qint64* y, int count, int quarters, double angle) const;
+};
+
+
+#endif // GEOMETRYTRANSFORM_H
@@ -0,0 +1,146 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "holededuplication.h"
+
+#include <QHash>
+
+#include "tooltable.h"
+
+
+namespace
+{
+
+inline qint64 cellOf(qint64 coordinate, qint64 size)
+{
+    // Rounds towards negative infinity
+    qint64 cell = coordinate / size;
+
+    if (coordinate % size < 0)
+        --cell;
+
+    return cell;
+}
+
+inline quint64 cellKey(qint64 x, qint64 y)
+{
+    return (static_cast<quint64>(static_cast<quint32>(x)) << 32) | static_cast<quint32>(y);
+}
+
+} // namespace
+
+
+int HoleDeduplication::deduplicate(QVector<DrillHit>& hits, const ToolTable& tools,
+    qint64 tolerance, QVector<Merge>& merges)
+{
+    tolerance = qMax<qint64>(0, tolerance);
+
+    qint64 size = qMax<qint64>(1, tolerance);
+    qint64 limit = tolerance * tolerance;
+
+    // Exact duplicates always share a cell
+    int reach = tolerance > 0 ? 1 : 0;
+
+    // Every cell refers to its last kept hole, the others are chained through "next"
+    QHash<quint64, int> cells;
+    cells.reserve(hits.size());
+
+    QVector<int> next(hits.size(), -1);
+
+    int kept = 0;
+
+    for (int i = 0; i < hits.size(); ++i)
+    {
+        DrillHit hit = hits[i];
+
+        qint64 cellX = cellOf(hit.x, size);
+        qint64 cellY = cellOf(hit.y, size);
+
+        int found = -1;
+
+        for (int dx = -reach; dx <= reach && found < 0; ++dx)
+        {
+            for (int dy = -reach; dy <= reach && found < 0; ++dy)
+            {
+                QHash<quint64, int>::const_iterator cell =
+                    cells.constFind(cellKey(cellX + dx, cellY + dy));
+
+                if (cell == cells.constEnd())
+                    continue;
+
+                for (int j = cell.value(); j >= 0; j = next[j])
+                {
+                    qint64 distanceX = hits[j].x - hit.x;
+                    qint64 distanceY = hits[j].y - hit.y;
+
+                    if (qAbs(distanceX) > tolerance || qAbs(distanceY) > tolerance)
+                        continue;
+
+                    if (distanceX * distanceX + distanceY * distanceY <= limit)
+                    {
+                        found = j;
+                        break;
+                    }
+                }
+            }
+        }
+
+        if (found >= 0)
+        {
+            DrillHit& original = hits[found];
+
+            Merge merge;
+            merge.keptLine = original.line;
+            merge.keptTool = original.tool;
+            merge.removedLine = hit.line;
+            merge.removedTool = hit.tool;
+
+            merges.append(merge);
+
+            if (tools[hit.tool].diameter() > tools[original.tool].diameter())
+                original.tool = hit.tool;
+
+            continue;
+        }
+
+        // Kept holes are compacted in place, they never overtake an unvisited one
+        hits[kept] = hit;
+
+        quint64 key = cellKey(cellX, cellY);
+        QHash<quint64, int>::iterator cell = cells.find(key);
+
+        if (cell == cells.end())
+        {
+            cells.insert(key, kept);
+        }
+        else
+        {
+            next[kept] = cell.value();
+            cell.value() = kept;
+        }
+
+        ++kept;
+    }
+
+    int removed = hits.size() - kept;
+    hits.resize(kept);
+
+    return removed;
+}
@@ -0,0 +1,62 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef HOLEDEDUPLICATION_H
+#define HOLEDEDUPLICATION_H
+
+
+#include <QVector>
+
+#include "drillhit.h"
+
+
+class ToolTable;
+
+
+class HoleDeduplication
+{
+public:
+    class Merge
+    {
+    public:
+        Merge()
+            : keptLine(0)
+            , keptTool(0)
+            , removedLine(0)
+            , removedTool(0)
+        {
+        }
+
+        int keptLine;
+        int keptTool;
+        int removedLine;
+        int removedTool;
+    };
+
+    // Removes the holes lying within the tolerance (in micrometres) of an earlier
+    // hole. The earlier hole stays in place and takes the larger of both tools.
+    // Holes are bucketed in a spatial hash with the tolerance as the cell size, so
+    // only the neighbouring cells are searched and the expected time is O(n).
+    static int deduplicate(QVector<DrillHit>& hits, const ToolTable& tools, qint64 tolerance,
+        QVector<Merge>& merges);
+};
+
+
+#endif // HOLEDEDUPLICATION_H
@@ -22,10 +22,65 @@
 
 #include <QFile>
 #include <QRegExp>
+#include <QStringList>
+#include <QtMath>
 
 #include "utilities.h"
 
 
+namespace
+{
+
+// Reads a base-64 (8-bit mode) or base-32 (7-bit mode) number of the PE
+// instruction. The digits go from the least significant one, the last digit
+// comes from the terminator range, and the lowest bit of the result is the sign.
+bool decodeNumber(const uchar*& data, const uchar* end, bool sevenBit, qint64& value)
+{
+    quint64 result = 0;
+    int shift = 0;
+
+    while (data < end)
+    {
+        uint c = *data++;
+        uint digit;
+        bool terminal;
+
+        if (c >= 63 && c < (sevenBit ? 95u : 127u))
+        {
+            digit = c - 63;
+            terminal = false;
+        }
+        else if (sevenBit ? (c >= 95 && c <= 126) : (c >= 191 && c <= 254))
+        {
+            digit = c - (sevenBit ? 95 : 191);
+            terminal = true;
+        }
+        else
+        {
+            return false;
+        }
+
+        if (shift > 58)
+            return false;
+
+        result |= static_cast<quint64>(digit) << shift;
+        shift += sevenBit ? 5 : 6;
+
+        if (terminal)
+        {
+            value = (result & 1) ? -static_cast<qint64>(result >> 1) :
+                static_cast<qint64>(result >> 1);
+
+            return true;
+        }
+    }
+
+    return false;
+}
+
+} // namespace
+
+
 HpglParser::HpglParser(QObject* parent)
     : AbstractParser(parent)
 {
@@ -36,7 +91,7 @@ void HpglParser::clear()
 {
     _tools.clear();
     // Insert zero (default) tool
-    _tools[0] = AbstractTool();
+    _tools.insert(0);
 
     _curves.clear();
 
@@ -44,19 +99,15 @@ void HpglParser::clear()
     _interrupted = false;
 
     _toolIsUp = true;
+    _relative = false;
+
+    _limits = BoundingBox();
 }
 
 bool HpglParser::parse(QFile& file)
 {
     clear();
 
-    qint64 minX = 0;
-    qint64 maxX = 0;
-    qint64 minY = 0;
-    qint64 maxY = 0;
-
-    bool flagSetLimits = true;
-
     emit started(tr("Loading HPGL"));
 
     while (!file.atEnd())
@@ -69,6 +120,16 @@ bool HpglParser::parse(QFile& file)
 
         QString line = QString::fromLatin1(file.readLine()).trimmed();
 
+        // Exporters may wrap the encoded polylines over several lines
+        if (line.startsWith("PE", Qt::CaseInsensitive))
+        {
+            while (!line.endsWith(';') && !file.atEnd())
+            {
+                line.append(QString::fromLatin1(file.readLine()).remove('\r').remove('\n'));
+                _lineNumber++;
+            }
+        }
+
         if (line.isEmpty())
         {
             _lineNumber++;
@@ -94,11 +155,12 @@ bool HpglParser::parse(QFile& file)
         {
             // Do nothing
         }
-        else if (line.compare("PU", Qt::CaseInsensitive) == 0)
+        else if (line.startsWith("PU", Qt::CaseInsensitive))
         {
             _toolIsUp = true;
+            parsed = plot(line.mid(2));
         }
-        else if (line.compare("PD", Qt::CaseInsensitive) == 0)
+        else if (line.startsWith("PD", Qt::CaseInsensitive))
         {
             _toolIsUp = false;
 
@@ -109,72 +171,76 @@ bool HpglParser::parse(QFile& file)
                 if (curve._type == AbstractCurve::CurveTypeNone && curve.count() == 1)
                     curve._type = AbstractCurve::CurveTypePoint;
             }
+
+            parsed = plot(line.mid(2));
+        }
+        else if (line.startsWith("PA", Qt::CaseInsensitive) ||
+            line.startsWith("PR", Qt::CaseInsensitive))
+        {
+            // The mode holds for the coordinates of the following PU and PD too
+            _relative = (line.at(1).toUpper() == 'R');
+            parsed = plot(line.mid(2));
         }
-        else if (line.startsWith("PA", Qt::CaseInsensitive))
+        else if (line.startsWith("AA", Qt::CaseInsensitive) ||
+            line.startsWith("AR", Qt::CaseInsensitive))
         {
-            int separator = line.indexOf(',');
+            // AA x,y,sweep[,chord] and AR dx,dy,sweep[,chord]
+            QStringList parameters = line.mid(2).split(',');
 
-            if (separator < 0)
-            {
-                parsed = false;
-            }
-            else
+            bool ok = parameters.size() == 3 || parameters.size() == 4;
+
+            double x = 0.0;
+            double y = 0.0;
+            double sweep = 0.0;
+
+            if (ok)
+                x = parameters[0].toDouble(&ok);
+            if (ok)
+                y = parameters[1].toDouble(&ok);
+            if (ok)
+                sweep = parameters[2].toDouble(&ok);
+
+            parsed = ok;
+
+            if (parsed)
             {
-                bool ok;
-                qint64 x = line.midRef(2, separator - 2).toLongLong(&ok);
-                parsed = parsed && ok;
-                qint64 y = line.midRef(separator + 1).toLongLong(&ok);
-                parsed = parsed && ok;
+                qint64 centerX = qRound64(x * 25.0);
+                qint64 centerY = qRound64(y * 25.0);
 
-                if (parsed)
+                if (line.at(1).toUpper() == 'R')
                 {
-                    x *= 25;
-                    y *= 25;
-
-                    if (_curves.isEmpty())
-                        _curves.append(AbstractCurve());
-
-                    AbstractCurve* curve = &_curves.last();
-
-                    if (_toolIsUp)
-                    {
-                        if (curve->_type != AbstractCurve::CurveTypeNone)
-                        {
-                            _curves.append(AbstractCurve());
-                            curve = &_curves.last();
-                        }
-
-                        curve->_type = AbstractCurve::CurveTypeNone;
-                        curve->_x.resize(1);
-                        curve->_y.resize(1);
-                        curve->_x[0] = x;
-                        curve->_y[0] = y;
-                    }
-                    else
-                    {
-                        curve->_type = AbstractCurve::CurveTypeCurve;
-                        curve->_x.append(x);
-                        curve->_y.append(y);
-                    }
-
-                    if (flagSetLimits)
-                    {
-                        minX = x;
-                        maxX = x;
-                        minY = y;
-                        maxY = y;
-                        flagSetLimits = false;
-                    }
-                    else
-                    {
-                        minX = qMin(minX, x);
-                        maxX = qMax(maxX, x);
-                        minY = qMin(minY, y);
-                        maxY = qMax(maxY, y);
-                    }
+                    qint64 currentX;
+                    qint64 currentY;
+                    position(currentX, currentY);
+
+                    centerX += currentX;
+                    centerY += currentY;
                 }
+
+                arcTo(centerX, centerY, sweep);
             }
         }
+        else if (line.startsWith("CI", Qt::CaseInsensitive))
+        {
+            // CI radius[,chord]
+            QStringList parameters = line.mid(2).split(',');
+
+            bool ok = parameters.size() == 1 || parameters.size() == 2;
+
+            double radius = 0.0;
+
+            if (ok)
+                radius = parameters[0].toDouble(&ok);
+
+            parsed = ok;
+
+            if (parsed)
+                circle(qRound64(radius * 25.0));
+        }
+        else if (line.startsWith("PE", Qt::CaseInsensitive))
+        {
+            parsed = decodePolyline(line.mid(2).toLatin1());
+        }
 
         if (!parsed)
         {
@@ -187,13 +253,19 @@ bool HpglParser::parse(QFile& file)
 
     emit progress(100, 100);
 
-    QString sMinX = Utilities::coordinateToString(minX);
-    QString sMaxX = Utilities::coordinateToString(maxX);
-    QString sDltX = Utilities::coordinateToString(maxX - minX);
+    foreach (const AbstractCurve& curve, _curves)
+    {
+        if (curve._type != AbstractCurve::CurveTypeNone)
+            _limits.include(curve.x(), curve.y(), curve.count());
+    }
+
+    QString sMinX = Utilities::coordinateToString(_limits.minX);
+    QString sMaxX = Utilities::coordinateToString(_limits.maxX);
+    QString sDltX = Utilities::coordinateToString(_limits.maxX - _limits.minX);
 
-    QString sMinY = Utilities::coordinateToString(minY);
-    QString sMaxY = Utilities::coordinateToString(maxY);
-    QString sDltY = Utilities::coordinateToString(maxY - minY);
+    QString sMinY = Utilities::coordinateToString(_limits.minY);
+    QString sMaxY = Utilities::coordinateToString(_limits.maxY);
+    QString sDltY = Utilities::coordinateToString(_limits.maxY - _limits.minY);
 
     accept(tr("The file has been successfully loaded.\nBoundaries of coordinates:\n"
         "Xmin = %1 mm, Xmax = %2 mm, \xCE\x94X = %3 mm,\n"
@@ -209,3 +281,302 @@ void HpglParser::interrupt()
 {
     _interrupted = true;
 }
+
+bool HpglParser::decodePolyline(const QByteArray& data)
+{
+    const uchar* current = reinterpret_cast<const uchar*>(data.constData());
+    const uchar* end = current + data.size();
+
+    bool sevenBit = false;
+    bool absolute = false;
+    bool penUp = false;
+    int fractionalBits = 0;
+
+    // The exact position is kept during the instruction, so the relative
+    // fractional coordinates do not accumulate rounding errors
+    qint64 startX;
+    qint64 startY;
+    position(startX, startY);
+
+    double x = static_cast<double>(startX);
+    double y = static_cast<double>(startY);
+
+    bool toolIsUp = _toolIsUp;
+    bool result = true;
+
+    while (current < end && result)
+    {
+        qint64 value;
+
+        switch (*current)
+        {
+        case ':':
+            // Pen selection, the pens are not used
+            ++current;
+            result = decodeNumber(current, end, sevenBit, value);
+            break;
+        case '<':
+            ++current;
+            penUp = true;
+            break;
+        case '>':
+            ++current;
+            result = decodeNumber(current, end, sevenBit, value) && value >= 0 && value <= 26;
+            fractionalBits = static_cast<int>(value);
+            break;
+        case '=':
+            ++current;
+            absolute = true;
+            break;
+        case '7':
+            ++current;
+            sevenBit = true;
+            break;
+        default:
+            if (*current <= ' ')
+            {
+                ++current;
+                break;
+            }
+
+            qint64 valueX;
+            qint64 valueY;
+
+            result = decodeNumber(current, end, sevenBit, valueX) &&
+                decodeNumber(current, end, sevenBit, valueY);
+
+            if (result)
+            {
+                double scale = 25.0 / static_cast<double>(1 << fractionalBits);
+
+                if (absolute)
+                {
+                    x = static_cast<double>(valueX) * scale;
+                    y = static_cast<double>(valueY) * scale;
+                }
+                else
+                {
+                    x += static_cast<double>(valueX) * scale;
+                    y += static_cast<double>(valueY) * scale;
+                }
+
+                _toolIsUp = penUp;
+                moveTo(qRound64(x), qRound64(y));
+
+                absolute = false;
+                penUp = false;
+            }
+            break;
+        }
+    }
+
+    _toolIsUp = toolIsUp;
+
+    return result;
+}
+
+bool HpglParser::plot(const QString& parameters)
+{
+    if (parameters.trimmed().isEmpty())
+        return true;
+
+    QStringList values = parameters.split(',');
+
+    if (values.size() % 2 != 0)
+        return false;
+
+    QVector<qint64> points(values.size());
+
+    for (int i = 0; i < values.size(); ++i)
+    {
+        bool ok;
+        points[i] = qRound64(values[i].toDouble(&ok) * 25.0);
+
+        if (!ok)
+            return false;
+    }
+
+    for (int i = 0; i < points.size(); i += 2)
+    {
+        qint64 x = points[i];
+        qint64 y = points[i + 1];
+
+        if (_relative)
+        {
+            qint64 currentX;
+            qint64 currentY;
+            position(currentX, currentY);
+
+            x += currentX;
+            y += currentY;
+        }
+
+        moveTo(x, y);
+    }
+
+    return true;
+}
+
+void HpglParser::moveTo(qint64 x, qint64 y)
+{
+    if (_curves.isEmpty())
+        _curves.append(AbstractCurve());
+
+    AbstractCurve* curve = &_curves.last();
+
+    if (_toolIsUp)
+    {
+        if (curve->_type != AbstractCurve::CurveTypeNone)
+        {
+            _curves.append(AbstractCurve());
+            curve = &_curves.last();
+        }
+
+        curve->_type = AbstractCurve::CurveTypeNone;
+        curve->_line = _lineNumber;
+        curve->_x.resize(1);
+        curve->_y.resize(1);
+        curve->_x[0] = x;
+        curve->_y[0] = y;
+        curve->_motion.clear();
+        curve->_centerX.clear();
+        curve->_centerY.clear();
+    }
+    else
+    {
+        curve->_type = AbstractCurve::CurveTypeCurve;
+        curve->_x.append(x);
+        curve->_y.append(y);
+
+        if (!curve->_motion.isEmpty())
+        {
+            curve->_motion.append(AbstractCurve::MotionLinear);
+            curve->_centerX.append(0);
+            curve->_centerY.append(0);
+        }
+    }
+}
+
+void HpglParser::arcTo(qint64 centerX, qint64 centerY, double sweep)
+{
+    qint64 startX;
+    qint64 startY;
+    position(startX, startY);
+
+    double dx = static_cast<double>(startX - centerX);
+    double dy = static_cast<double>(startY - centerY);
+    double radius = qSqrt(dx * dx + dy * dy);
+
+    if (radius < 1.0 || qAbs(sweep) < 1e-9)
+        return;
+
+    sweep = qBound(-360.0, sweep, 360.0);
+
+    if (_curves.isEmpty())
+    {
+        bool toolIsUp = _toolIsUp;
+
+        _toolIsUp = true;
+        moveTo(startX, startY);
+        _toolIsUp = toolIsUp;
+    }
+
+    // Arcs are split into pieces of 120 degrees at most, so every dialect can
+    // express them and a full circle never has coincident end points
+    int pieces = qCeil(qAbs(sweep) / 120.0);
+
+    double start = qAtan2(dy, dx);
+    double step = qDegreesToRadians(sweep) / pieces;
+
+    bool full = qAbs(sweep) == 360.0;
+
+    for (int i = 1; i <= pieces; ++i)
+    {
+        qint64 x = startX;
+        qint64 y = startY;
+
+        if (i < pieces || !full)
+        {
+            x = centerX + qRound64(radius * qCos(start + step * i));
+            y = centerY + qRound64(radius * qSin(start + step * i));
+        }
+
+        if (_toolIsUp)
+        {
+            if (i == pieces)
+                moveTo(x, y);
+
+            continue;
+        }
+
+        AbstractCurve& curve = _curves.last();
+
+        // The motions are stored only for the curves that contain arcs
+        if (curve._motion.isEmpty())
+        {
+            curve._motion.fill(AbstractCurve::MotionLinear, curve._x.size());
+            curve._centerX.fill(0, curve._x.size());
+            curve._centerY.fill(0, curve._x.size());
+        }
+
+        curve._type = AbstractCurve::CurveTypeCurve;
+        curve._x.append(x);
+        curve._y.append(y);
+        curve._motion.append(sweep > 0.0 ? AbstractCurve::MotionCounterClockwise :
+            AbstractCurve::MotionClockwise);
+        curve._centerX.append(centerX);
+        curve._centerY.append(centerY);
+    }
+
+    if (_toolIsUp)
+        return;
+
+    // Include the extreme points of the circle passed by the arc
+    double from = qMin(start, start + qDegreesToRadians(sweep));
+    double to = qMax(start, start + qDegreesToRadians(sweep));
+
+    for (int quadrant = qCeil(from / M_PI_2); quadrant * M_PI_2 <= to; ++quadrant)
+    {
+        _limits.include(centerX + qRound64(radius * qCos(quadrant * M_PI_2)),
+            centerY + qRound64(radius * qSin(quadrant * M_PI_2)));
+    }
+}
+
+void HpglParser::circle(qint64 radius)
+{
+    if (radius == 0)
+        return;
+
+    qint64 centerX;
+    qint64 centerY;
+    position(centerX, centerY);
+
+    // The circle is drawn with the pen down regardless of its state and the
+    // pen returns to the center afterwards
+    bool toolIsUp = _toolIsUp;
+
+    _toolIsUp = true;
+    moveTo(centerX + radius, centerY);
+
+    _toolIsUp = false;
+    arcTo(centerX, centerY, 360.0);
+
+    _toolIsUp = true;
+    moveTo(centerX, centerY);
+
+    _toolIsUp = toolIsUp;
+}
+
+void HpglParser::position(qint64& x, qint64& y) const
+{
+    x = 0;
+    y = 0;
+
+    if (!_curves.isEmpty() && _curves.last().count() > 0)
+    {
+        const AbstractCurve& curve = _curves.last();
+
+        x = curve._x.last();
+        y = curve._y.last();
+    }
+}
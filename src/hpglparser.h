@@ -23,6 +23,7 @@
 
 
 #include "abstractparser.h"
+#include "boundingbox.h"
 
 
 class HpglParser : public AbstractParser
@@ -37,17 +38,35 @@ public:
     virtual void clear();
     virtual bool parse(QFile& file);
 
-    virtual const QMap<int, AbstractTool>& tools() const;
+    virtual const ToolTable& tools() const;
     virtual const QList<AbstractCurve>& curves() const;
+    virtual int settledCount() const;
 
 public slots:
     virtual void interrupt();
 
 private:
-    QMap<int, AbstractTool> _tools;
+    bool decodePolyline(const QByteArray& data);
+
+    // Moves through the x,y pairs of PU, PD, PA or PR in the current plotting mode
+    bool plot(const QString& parameters);
+
+    void moveTo(qint64 x, qint64 y);
+    void arcTo(qint64 centerX, qint64 centerY, double sweep);
+    void circle(qint64 radius);
+
+    void position(qint64& x, qint64& y) const;
+
+    ToolTable _tools;
     QList<AbstractCurve> _curves;
 
     bool _toolIsUp;
+
+    // PR was given after the last PA, the coordinates are relative
+    bool _relative;
+
+    // The extreme points of the arcs, the vertices are added after parsing
+    BoundingBox _limits;
 };
 
 
@@ -56,7 +75,7 @@ inline AbstractParser::ParserType HpglParser::type() const
     return ParserMillling;
 }
 
-inline const QMap<int, AbstractTool>& HpglParser::tools() const
+inline const ToolTable& HpglParser::tools() const
 {
     return _tools;
 }
@@ -66,5 +85,11 @@ inline const QList<AbstractCurve>& HpglParser::curves() const
     return _curves;
 }
 
+inline int HpglParser::settledCount() const
+{
+    // The last curve grows while the pen is down
+    return qMax(0, _curves.size() - 1);
+}
+
 
 #endif // HPGLPARSER_H
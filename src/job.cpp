@@ -0,0 +1,319 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "job.h"
+
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QFutureWatcher>
+#include <QtConcurrent>
+
+#include <algorithm>
+
+#include "excellonparser.h"
+#include "hpglparser.h"
+
+
+QString JobOperation::fileOf(int curve) const
+{
+    // The files follow each other in the curves of the parser
+    int index = static_cast<int>(std::upper_bound(firsts.constBegin(), firsts.constEnd(), curve) -
+        firsts.constBegin()) - 1;
+
+    return files.value(qMax(index, 0));
+}
+
+Job::Job(QObject* parent)
+    : QObject(parent)
+    , _interrupted(false)
+{
+}
+
+Job::~Job()
+{
+    clear();
+}
+
+void Job::clear()
+{
+    qDeleteAll(_parsers);
+    _parsers.clear();
+
+    _operations.clear();
+    _failures.clear();
+
+    _interrupted = false;
+}
+
+bool Job::load(const QStringList& fileNames)
+{
+    clear();
+
+    QVector<Input> inputs(fileNames.size());
+
+    for (int i = 0; i < fileNames.size(); ++i)
+    {
+        Input& input = inputs[i];
+        input.path = fileNames[i];
+        input.name = QFileInfo(fileNames[i]).fileName();
+        input.parser = createParser(fileNames[i]);
+
+        if (input.parser)
+            _parsers.append(input.parser);
+        else
+            _failures.append(input.path);
+    }
+
+    if (inputs.isEmpty() || !_failures.isEmpty())
+    {
+        qDeleteAll(_parsers);
+        _parsers.clear();
+        return false;
+    }
+
+    if (inputs.size() == 1)
+    {
+        Input& input = inputs.first();
+        QString name = input.name;
+
+        connect(input.parser, SIGNAL(started(const QString&)),
+            this, SIGNAL(started(const QString&)));
+        connect(input.parser, SIGNAL(progress(int, int)),
+            this, SIGNAL(progress(int, int)));
+        connect(input.parser, SIGNAL(finished()),
+            this, SIGNAL(finished()));
+
+        connect(input.parser, &AbstractParser::log, this,
+            [this, name](int severity, const QString& description, const QString& line)
+        {
+            emit log(severity, description, name, line);
+        });
+
+        // The operation is there while parsing, so the preview can follow it
+        addOperations(inputs);
+        parseInput(input);
+    }
+    else
+    {
+        // The parsers run on the pool threads, their log is kept until the end
+        for (int i = 0; i < inputs.size(); ++i)
+        {
+            Input* input = &inputs[i];
+
+            connect(input->parser, &AbstractParser::log,
+                [input](int severity, const QString& description, const QString& line)
+            {
+                LogItem item;
+                item.severity = severity;
+                item.description = description;
+                item.line = line;
+
+                input->log.append(item);
+            });
+        }
+
+        emit started(tr("Loading %1 Files").arg(inputs.size()));
+
+        QFutureWatcher<void> watcher;
+        QEventLoop loop;
+
+        connect(&watcher, &QFutureWatcher<void>::progressValueChanged, this,
+            [this, &inputs](int done)
+        {
+            emit progress(done, inputs.size());
+        });
+        connect(&watcher, SIGNAL(finished()), &loop, SLOT(quit()));
+
+        // The files not started yet are skipped after the interruption
+        watcher.setFuture(QtConcurrent::map(inputs, [this](Input& input)
+        {
+            if (!_interrupted)
+                parseInput(input);
+        }));
+
+        if (!watcher.isFinished())
+            loop.exec();
+
+        emit finished();
+    }
+
+    foreach (const Input& input, inputs)
+    {
+        foreach (const LogItem& item, input.log)
+            emit log(item.severity, item.description, input.name, item.line);
+
+        if (input.parser->isInterrupted())
+            _interrupted = true;
+
+        if (!input.loaded)
+            _failures.append(input.path);
+    }
+
+    if (_interrupted || !_failures.isEmpty())
+    {
+        _operations.clear();
+
+        qDeleteAll(_parsers);
+        _parsers.clear();
+
+        return false;
+    }
+
+    if (inputs.size() > 1)
+        addOperations(inputs);
+
+    return true;
+}
+
+const JobOperation* Job::drilling() const
+{
+    if (_operations.isEmpty() ||
+        _operations.first().parser->type() != AbstractParser::ParserDrilling)
+    {
+        return nullptr;
+    }
+
+    return &_operations.first();
+}
+
+GeometryTransform Job::placement(const GeometryTransform& transform) const
+{
+    GeometryTransform placed = transform;
+
+    if (!transform.normalize || _operations.size() < 2)
+        return placed;
+
+    placed.normalize = false;
+
+    BoundingBox extents;
+
+    foreach (const JobOperation& operation, _operations)
+    {
+        BoundingBox bounds;
+        placed.matrix(*operation.parser, bounds);
+
+        if (!bounds.isEmpty())
+            extents.include(bounds.minX, bounds.minY);
+    }
+
+    // Without the normalization the bounds are moved by the offset only
+    if (!extents.isEmpty())
+    {
+        placed.offsetX -= extents.minX - transform.offsetX;
+        placed.offsetY -= extents.minY - transform.offsetY;
+    }
+
+    return placed;
+}
+
+void Job::interrupt()
+{
+    _interrupted = true;
+
+    foreach (AbstractParser* parser, _parsers)
+        parser->interrupt();
+}
+
+AbstractParser* Job::createParser(const QString& fileName)
+{
+    QString extension = QFileInfo(fileName).suffix().toLower();
+
+    if (extension == "drl")
+        return new ExcellonParser();
+
+    if (extension == "plt")
+        return new HpglParser();
+
+    return nullptr;
+}
+
+void Job::parseInput(Input& input)
+{
+    QFile file(input.path);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        LogItem item;
+        item.severity = LogItem::SeverityError;
+        item.description = file.errorString();
+
+        input.log.append(item);
+        return;
+    }
+
+    input.loaded = input.parser->parse(file);
+}
+
+void Job::addOperations(QVector<Input>& inputs)
+{
+    JobOperation drilling;
+    QList<JobOperation> milling;
+    int shared = 0;
+
+    for (int i = 0; i < inputs.size(); ++i)
+    {
+        Input& input = inputs[i];
+
+        if (input.parser->type() == AbstractParser::ParserDrilling)
+        {
+            drilling.files.append(input.name);
+
+            if (!drilling.parser)
+            {
+                drilling.parser = input.parser;
+                drilling.firsts.append(0);
+                continue;
+            }
+
+            // Only the Excellon parser gives the drilling geometry
+            ExcellonParser* merged = static_cast<ExcellonParser*>(drilling.parser);
+
+            drilling.firsts.append(merged->curves().size());
+            shared += merged->merge(*static_cast<ExcellonParser*>(input.parser));
+
+            _parsers.removeOne(input.parser);
+            delete input.parser;
+            input.parser = nullptr;
+        }
+        else
+        {
+            JobOperation operation;
+            operation.parser = input.parser;
+            operation.files.append(input.name);
+            operation.firsts.append(0);
+
+            milling.append(operation);
+        }
+    }
+
+    if (drilling.parser)
+        _operations.append(drilling);
+
+    _operations.append(milling);
+
+    if (drilling.files.size() > 1)
+    {
+        emit log(LogItem::SeverityNotice, tr("%1 drill files have been merged into one "
+            "drilling operation with %2 tools, %3 tools of the same diameter are shared.")
+            .arg(drilling.files.size()).arg(drilling.parser->tools().count() - 1).arg(shared),
+            tr("[Job]"), QString());
+    }
+}
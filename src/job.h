@@ -0,0 +1,130 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef JOB_H
+#define JOB_H
+
+
+#include <QList>
+#include <QObject>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+
+#include "abstractparser.h"
+#include "geometrytransform.h"
+
+
+// The geometry of one or more input files of the same kind, it becomes one
+// program or one part of the program
+class JobOperation
+{
+public:
+    JobOperation()
+        : parser(nullptr)
+    {
+    }
+
+    // The input file of a curve of the parser
+    QString fileOf(int curve) const;
+
+    AbstractParser* parser;
+
+    // The names of the input files and the first curve of each of them
+    QStringList files;
+    QVector<int> firsts;
+};
+
+
+// The input files of a board: the drill files are merged by the tool diameter
+// into one drilling operation, every milling file is an operation of its own.
+// Several files are parsed at once on the global thread pool, so the job loads
+// in the time of its largest file.
+class Job : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit Job(QObject* parent = nullptr);
+    virtual ~Job();
+
+    void clear();
+
+    // A single file is parsed on the calling thread with its log and progress going
+    // out as they come. The log of several files is given out in the order of the
+    // files when all of them are done.
+    bool load(const QStringList& fileNames);
+
+    bool isEmpty() const { return _operations.isEmpty(); }
+    bool isInterrupted() const { return _interrupted; }
+
+    // The drilling operation comes first
+    const QList<JobOperation>& operations() const { return _operations; }
+    const JobOperation* drilling() const;
+
+    // The files that could not be loaded
+    const QStringList& failures() const { return _failures; }
+
+    // The normalization of the transform moves the files together, so the layers
+    // of the board stay in register
+    GeometryTransform placement(const GeometryTransform& transform) const;
+
+public slots:
+    void interrupt();
+
+signals:
+    void log(int severity, const QString& description, const QString& file,
+        const QString& line);
+    void started(const QString& operation);
+    void progress(int done, int total);
+    void finished();
+
+private:
+    class Input
+    {
+    public:
+        Input()
+            : parser(nullptr)
+            , loaded(false)
+        {
+        }
+
+        QString path;
+        QString name;
+        AbstractParser* parser;
+        bool loaded;
+        QList<LogItem> log;
+    };
+
+    static AbstractParser* createParser(const QString& fileName);
+    static void parseInput(Input& input);
+
+    void addOperations(QVector<Input>& inputs);
+
+    QList<JobOperation> _operations;
+    QList<AbstractParser*> _parsers;
+    QStringList _failures;
+
+    std::atomic<bool> _interrupted;
+};
+
+
+#endif // JOB_H
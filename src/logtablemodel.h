@@ -61,6 +61,8 @@ public:
 
     void remove(const QString& file);
 
+    const QList<LogItem>& items() const;
+
 signals:
     void updated(int errors, int warnings, int notices, int accepts);
 
@@ -108,4 +110,10 @@ inline void LogTableModel::accept(const QString& description, const QString& fil
 }
 
 
+inline const QList<LogItem>& LogTableModel::items() const
+{
+    return _items;
+}
+
+
 #endif // LOGTABLEMODEL_H
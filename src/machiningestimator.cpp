@@ -0,0 +1,339 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "machiningestimator.h"
+
+#include <QtConcurrent>
+#include <QtMath>
+
+
+namespace
+{
+
+const int MinimumBatch = 4096;
+const double Epsilon = 1e-9;
+
+class Segment
+{
+public:
+    double length;
+    double velocity;
+    double acceleration;
+    double junction;
+    double start[3];
+    double end[3];
+};
+
+class Batch
+{
+public:
+    int begin;
+    int end;
+    MachiningEstimate estimate;
+};
+
+bool isCutting(const ToolpathMove& move)
+{
+    return move.type != ToolpathMove::TypeRapid;
+}
+
+// Length, speed limits and the directions at both ends of the move
+void describe(const ToolpathMove& move, const ToolpathMove* previous,
+    const MachineSettings& machine, Segment& segment)
+{
+    double startX = previous ? previous->x : 0.0;
+    double startY = previous ? previous->y : 0.0;
+    double startZ = previous ? previous->z : 0.0;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        segment.start[i] = 0.0;
+        segment.end[i] = 0.0;
+    }
+
+    double dx = move.x - startX;
+    double dy = move.y - startY;
+    double dz = move.z - startZ;
+
+    if (isCutting(move))
+    {
+        double feed = (move.feed > 0.0) ? qMin(move.feed, machine.maximumFeed)
+            : machine.maximumFeed;
+
+        segment.velocity = feed / 60.0;
+    }
+    else
+    {
+        segment.velocity = machine.rapidRate / 60.0;
+    }
+
+    if (move.isArc())
+    {
+        double radius = qSqrt((startX - move.centerX) * (startX - move.centerX) +
+            (startY - move.centerY) * (startY - move.centerY));
+
+        double first = qAtan2(startY - move.centerY, startX - move.centerX);
+        double last = qAtan2(move.y - move.centerY, move.x - move.centerX);
+
+        bool clockwise = (move.type == ToolpathMove::TypeClockwise);
+        double sweep = clockwise ? first - last : last - first;
+
+        // The same start and end point make a full circle
+        while (sweep <= Epsilon)
+            sweep += 2.0 * M_PI;
+
+        double planar = radius * sweep;
+        segment.length = qSqrt(planar * planar + dz * dz);
+
+        if (segment.length <= 0.0)
+        {
+            segment.length = 0.0;
+            segment.velocity = 0.0;
+            segment.acceleration = 1.0;
+            return;
+        }
+
+        double side = clockwise ? -1.0 : 1.0;
+        double scale = planar / segment.length;
+
+        segment.start[0] = -side * qSin(first) * scale;
+        segment.start[1] = side * qCos(first) * scale;
+        segment.start[2] = dz / segment.length;
+        segment.end[0] = -side * qSin(last) * scale;
+        segment.end[1] = side * qCos(last) * scale;
+        segment.end[2] = segment.start[2];
+
+        // The centripetal acceleration limits the speed on small arcs
+        segment.velocity = qMin(segment.velocity, qSqrt(machine.accelerationXY * radius));
+    }
+    else
+    {
+        segment.length = qSqrt(dx * dx + dy * dy + dz * dz);
+
+        if (segment.length <= 0.0)
+        {
+            segment.length = 0.0;
+            segment.velocity = 0.0;
+            segment.acceleration = 1.0;
+            return;
+        }
+
+        segment.start[0] = dx / segment.length;
+        segment.start[1] = dy / segment.length;
+        segment.start[2] = dz / segment.length;
+        segment.end[0] = segment.start[0];
+        segment.end[1] = segment.start[1];
+        segment.end[2] = segment.start[2];
+    }
+
+    // Every axis limits the acceleration along the move by its share of the direction
+    double planar = qSqrt(segment.start[0] * segment.start[0] +
+        segment.start[1] * segment.start[1]);
+    double vertical = qAbs(segment.start[2]);
+
+    segment.acceleration = 1e12;
+
+    if (planar > Epsilon)
+        segment.acceleration = qMin(segment.acceleration, machine.accelerationXY / planar);
+
+    if (vertical > Epsilon)
+        segment.acceleration = qMin(segment.acceleration, machine.accelerationZ / vertical);
+}
+
+// Time of the move that enters and leaves with the given speeds
+double profileTime(const Segment& segment, double entry, double exit)
+{
+    if (segment.length <= 0.0 || segment.velocity <= 0.0)
+        return 0.0;
+
+    double velocity = segment.velocity;
+    double acceleration = segment.acceleration;
+
+    double accelerating = (velocity * velocity - entry * entry) / (2.0 * acceleration);
+    double decelerating = (velocity * velocity - exit * exit) / (2.0 * acceleration);
+
+    if (accelerating + decelerating <= segment.length)
+    {
+        return (velocity - entry) / acceleration + (velocity - exit) / acceleration +
+            (segment.length - accelerating - decelerating) / velocity;
+    }
+
+    // Triangular profile, the move never reaches the cruise speed
+    double peak = qSqrt((2.0 * acceleration * segment.length + entry * entry + exit * exit) / 2.0);
+
+    return (qMax(peak - entry, 0.0) + qMax(peak - exit, 0.0)) / acceleration;
+}
+
+// Plans the speeds backwards and forwards between the stops of the batch
+void plan(const Toolpath& toolpath, const QVector<Segment>& segments, Batch& batch)
+{
+    const int count = batch.end - batch.begin;
+
+    QVector<double> entries(count);
+    QVector<double> exits(count);
+
+    double next = 0.0;
+
+    for (int i = batch.end - 1; i >= batch.begin; --i)
+    {
+        const Segment& segment = segments[i];
+
+        double exit = qMin(segment.junction, next);
+        double entry = qSqrt(exit * exit + 2.0 * segment.acceleration * segment.length);
+
+        entry = qMin(entry, segment.velocity);
+
+        if (i > batch.begin)
+            entry = qMin(entry, segments[i - 1].junction);
+        else
+            entry = 0.0;
+
+        entries[i - batch.begin] = entry;
+        exits[i - batch.begin] = exit;
+        next = entry;
+    }
+
+    double entry = 0.0;
+
+    MachiningEstimate& estimate = batch.estimate;
+
+    for (int i = batch.begin; i < batch.end; ++i)
+    {
+        const Segment& segment = segments[i];
+        const ToolpathMove& move = toolpath.moves[i];
+
+        entry = qMin(entry, entries[i - batch.begin]);
+
+        double exit = qMin(exits[i - batch.begin],
+            qSqrt(entry * entry + 2.0 * segment.acceleration * segment.length));
+
+        double time = profileTime(segment, entry, exit);
+
+        if (isCutting(move))
+        {
+            estimate.cuttingTime += time;
+            estimate.cuttingDistance += segment.length;
+
+            // A straight move down is a plunge
+            if (move.type == ToolpathMove::TypeLinear && segment.start[2] < -1.0 + Epsilon)
+                ++estimate.plunges;
+        }
+        else
+        {
+            estimate.rapidTime += time;
+            estimate.rapidDistance += segment.length;
+        }
+
+        entry = exit;
+    }
+
+    estimate.moves = count;
+}
+
+} // namespace
+
+
+MachiningEstimate MachiningEstimator::estimate(const Toolpath& toolpath,
+    const MachineSettings& machine)
+{
+    const QVector<ToolpathMove>& moves = toolpath.moves;
+    const int count = moves.size();
+
+    QVector<Segment> segments(count);
+
+    // The geometry of every move depends on its own start point only
+    QVector<Batch> blocks;
+
+    for (int begin = 0; begin < count; begin += MinimumBatch)
+    {
+        Batch block;
+        block.begin = begin;
+        block.end = qMin(begin + MinimumBatch, count);
+        blocks.append(block);
+    }
+
+    QtConcurrent::blockingMap(blocks, [&moves, &machine, &segments](Batch& block)
+    {
+        for (int i = block.begin; i < block.end; ++i)
+            describe(moves[i], i > 0 ? &moves[i - 1] : nullptr, machine, segments[i]);
+    });
+
+    // The corner speeds, a zero speed is a stop where a new batch may start
+    QVector<Batch> batches;
+
+    Batch batch;
+    batch.begin = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        Segment& segment = segments[i];
+        segment.junction = 0.0;
+
+        if (i + 1 < count)
+        {
+            const Segment& following = segments[i + 1];
+
+            bool continuous = isCutting(moves[i]) == isCutting(moves[i + 1]) &&
+                moves[i].tool == moves[i + 1].tool &&
+                segment.length > 0.0 && following.length > 0.0;
+
+            if (continuous)
+            {
+                double cosine = segment.end[0] * following.start[0] +
+                    segment.end[1] * following.start[1] + segment.end[2] * following.start[2];
+
+                if (cosine > 0.0)
+                    segment.junction = qMin(segment.velocity, following.velocity) * cosine;
+            }
+        }
+
+        if (segment.junction <= 0.0 && (i + 1 - batch.begin >= MinimumBatch || i + 1 == count))
+        {
+            batch.end = i + 1;
+            batches.append(batch);
+            batch.begin = i + 1;
+        }
+    }
+
+    QtConcurrent::blockingMap(batches, [&toolpath, &segments](Batch& batch)
+    {
+        plan(toolpath, segments, batch);
+    });
+
+    MachiningEstimate result;
+
+    for (int i = 0; i < batches.size(); ++i)
+    {
+        const MachiningEstimate& estimate = batches[i].estimate;
+
+        result.rapidTime += estimate.rapidTime;
+        result.cuttingTime += estimate.cuttingTime;
+        result.rapidDistance += estimate.rapidDistance;
+        result.cuttingDistance += estimate.cuttingDistance;
+        result.moves += estimate.moves;
+        result.plunges += estimate.plunges;
+    }
+
+    result.toolChanges = toolpath.toolChanges;
+    result.toolChangeTime = toolpath.toolChanges * machine.toolChangeTime;
+    result.time = result.rapidTime + result.cuttingTime + result.toolChangeTime;
+
+    return result;
+}
@@ -0,0 +1,88 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef MACHININGESTIMATOR_H
+#define MACHININGESTIMATOR_H
+
+
+#include "toolpath.h"
+
+
+class MachineSettings
+{
+public:
+    MachineSettings()
+        : rapidRate(1500.0)
+        , maximumFeed(1500.0)
+        , accelerationXY(200.0)
+        , accelerationZ(100.0)
+        , toolChangeTime(20.0)
+    {
+    }
+
+    double rapidRate;       // mm/min
+    double maximumFeed;     // mm/min
+    double accelerationXY;  // mm/s^2
+    double accelerationZ;   // mm/s^2
+    double toolChangeTime;  // s
+};
+
+
+class MachiningEstimate
+{
+public:
+    MachiningEstimate()
+        : time(0.0)
+        , rapidTime(0.0)
+        , cuttingTime(0.0)
+        , toolChangeTime(0.0)
+        , rapidDistance(0.0)
+        , cuttingDistance(0.0)
+        , moves(0)
+        , plunges(0)
+        , toolChanges(0)
+    {
+    }
+
+    double time;
+    double rapidTime;
+    double cuttingTime;
+    double toolChangeTime;
+    double rapidDistance;
+    double cuttingDistance;
+    int moves;
+    int plunges;
+    int toolChanges;
+};
+
+
+// Estimates the run time of a toolpath with a trapezoidal velocity profile. Every
+// move accelerates and decelerates within the limits of the axes it moves, the
+// speed at a corner drops with the cosine of the angle, and the machine stops
+// between rapid and cutting moves and at tool changes. The parts between the stops
+// are independent and are computed in parallel.
+class MachiningEstimator
+{
+public:
+    static MachiningEstimate estimate(const Toolpath& toolpath, const MachineSettings& machine);
+};
+
+
+#endif // MACHININGESTIMATOR_H
@@ -34,13 +34,50 @@ int main(int argc, char *argv[])
 
     QCommandLineParser parser;
     parser.setApplicationDescription(application.applicationName());
-    parser.addPositionalArgument("file", "The file to open.");
+    parser.addPositionalArgument("file", "The file to open.", "[file...]");
+
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+        "Build the program for the files without showing the window and write it to <output>.",
+        "output");
+    parser.addOption(outputOption);
+
+    QCommandLineOption analyzeOption(QStringList() << "a" << "analyze",
+        "Print the statistics and the machining time of the G-code programs.");
+    parser.addOption(analyzeOption);
+
     parser.process(application);
 
+    if (parser.isSet(analyzeOption))
+    {
+        if (parser.positionalArguments().isEmpty())
+            parser.showHelp(1);
+
+        int result = 0;
+
+        foreach (const QString& fileName, parser.positionalArguments())
+        {
+            MainWindow analyzer;
+
+            if (analyzer.analyzeProgram(fileName) != 0)
+                result = 1;
+        }
+
+        return result;
+    }
+
     MainWindow mainWindow;
 
+    if (parser.isSet(outputOption))
+    {
+        if (parser.positionalArguments().isEmpty())
+            parser.showHelp(1);
+
+        return mainWindow.exportProgram(parser.positionalArguments(),
+            parser.value(outputOption));
+    }
+
     if (!parser.positionalArguments().isEmpty())
-        mainWindow.loadExternalFile(parser.positionalArguments().first());
+        mainWindow.loadExternalFiles(parser.positionalArguments());
 
     mainWindow.show();
 
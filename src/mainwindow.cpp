@@ -26,20 +26,40 @@
 #include <QMessageBox>
 #include <QSettings>
 #include <QDir>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QTextStream>
 
 #include "aboutdialog.h"
 #include "logfiltermodel.h"
 #include "utilities.h"
 #include "mousewheeleventfilter.h"
-#include "excellonparser.h"
-#include "hpglparser.h"
+#include "gcodecompressor.h"
+#include "gcodereader.h"
+#include "previewbuilder.h"
+#include "designrulecheck.h"
+
+
+namespace
+{
+
+// How often the preview takes the curves parsed so far, ms
+const qint64 PreviewInterval = 500;
+
+// The design rule violations listed in the log, the others are only counted
+const int DesignRuleLogLimit = 100;
+
+} // namespace
 
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent)
-    , _parser(nullptr)
     , _progress(nullptr)
-    , _operationCanceled(false)
+    , _headless(false)
+    , _busy(false)
+    , _parsing(false)
+    , _previewOperation(0)
+    , _previewCurves(0)
 {
     setupUi(this);
 
@@ -73,6 +93,9 @@ MainWindow::MainWindow(QWidget* parent)
 
     _tabs->removeTab(_tabs->indexOf(_tabSettings));
 
+    for (int i = 0; i < GcodeDialect::DialectCount; ++i)
+        _comboSettingsDialect->addItem(GcodeDialect::name(i));
+
     QVBoxLayout* logLayout = qobject_cast<QVBoxLayout*>(_tabLog->layout());
     if (logLayout)
     {
@@ -146,6 +169,18 @@ MainWindow::MainWindow(QWidget* parent)
     connect(_actionLogWarnings, SIGNAL(toggled(bool)), &_log, SLOT(refresh()));
     connect(_actionLogNotices, SIGNAL(toggled(bool)), &_log, SLOT(refresh()));
 
+    // Job
+    connect(_progress, SIGNAL(canceled()), &_job, SLOT(interrupt()));
+    connect(&_job, SIGNAL(started(const QString&)),
+        this, SLOT(operationStarted(const QString&)));
+    connect(&_job, SIGNAL(progress(int, int)),
+        this, SLOT(operationProgress(int, int)));
+    connect(&_job, SIGNAL(finished()),
+        this, SLOT(operationFinished()));
+
+    connect(&_job, SIGNAL(log(int, const QString&, const QString&, const QString&)), this,
+        SLOT(logParser(int, const QString&, const QString&, const QString&)));
+
     // File Operations
     connect(_actionClose, SIGNAL(triggered()), this, SLOT(fileCloseAction()));
     connect(_actionOpen, SIGNAL(triggered()), this, SLOT(fileOpenAction()));
@@ -170,6 +205,10 @@ MainWindow::MainWindow(QWidget* parent)
     // Settings
     connect(_buttonSettingsClose, SIGNAL(clicked()), this, SLOT(settingsClose()));
 
+    // Drilling
+    connect(_comboDrillingCycle, SIGNAL(currentIndexChanged(int)),
+        this, SLOT(drillingCycleChanged(int)));
+
     _defaultState = saveState();
 
     loadSettings();
@@ -179,6 +218,13 @@ MainWindow::MainWindow(QWidget* parent)
 
 void MainWindow::closeEvent(QCloseEvent* event)
 {
+    // The progress of the load or the build is to be canceled first
+    if (_busy)
+    {
+        event->ignore();
+        return;
+    }
+
     if (fileSave(true))
     {
         saveSettings();
@@ -207,12 +253,33 @@ void MainWindow::loadSettings()
     _lastFileDir = settings.value("LastDirectory").toString();
     settings.endGroup();
 
+    settings.beginGroup("Program");
+    _comboSettingsDialect->setCurrentIndex(
+        settings.value("Dialect", GcodeDialect::DialectLinuxCnc).toInt());
+    _checkSettingsModalWords->setChecked(settings.value("OmitModalWords", false).toBool());
+    _checkSettingsUnchangedAxes->setChecked(settings.value("OmitUnchangedAxes", false).toBool());
+    _checkSettingsTrimZeros->setChecked(settings.value("TrimZeros", false).toBool());
+    _checkSettingsSeparatePrograms->setChecked(
+        settings.value("SeparatePrograms", false).toBool());
+    settings.endGroup();
+
     settings.beginGroup("Milling");
     _editMillingSpindleSpeed->setValue(settings.value("SpindleSpeed", 10000).toInt());
     _editMillingFeedRate->setValue(settings.value("Feed", 1).toInt());
     _editMillingPlungeRate->setValue(settings.value("Plunge", 1).toInt());
     _editMillingSafeZ->setValue(settings.value("SafeZ", 1.0).toDouble());
+    _checkMillingTravelZ->setChecked(settings.value("ReducedTravel", false).toBool());
+    _editMillingTravelZ->setValue(settings.value("TravelZ", 0.5).toDouble());
+    _editMillingTravelDistance->setValue(settings.value("TravelDistance", 10.0).toDouble());
     _editMillingDepth->setValue(settings.value("Depth", 0.0).toDouble());
+    _checkMillingMultiPass->setChecked(settings.value("MultiPass", false).toBool());
+    _editMillingStepDown->setValue(settings.value("StepDown", 0.5).toDouble());
+    _checkMillingRamp->setChecked(settings.value("RampEntry", false).toBool());
+    _checkMillingJoin->setChecked(settings.value("JoinPaths", true).toBool());
+    _checkMillingArcs->setChecked(settings.value("Arcs", true).toBool());
+    _editMillingArcTolerance->setValue(settings.value("ArcTolerance", 0.02).toDouble());
+    _checkMillingSimplify->setChecked(settings.value("Simplify", true).toBool());
+    _editMillingSimplifyTolerance->setValue(settings.value("SimplifyTolerance", 0.01).toDouble());
 
     _editSettingsMillingPrologue->setPlainText(
         settings.value("Prologue", _editSettingsMillingPrologue->toPlainText()).toString());
@@ -220,17 +287,40 @@ void MainWindow::loadSettings()
     _editSettingsMillingEpilogue->setPlainText(
         settings.value("Epilogue", _editSettingsMillingEpilogue->toPlainText()).toString());
 
+    _editSettingsMillingCurveStart->setPlainText(
+        settings.value("CurveStart", _editSettingsMillingCurveStart->toPlainText()).toString());
+
+    _editSettingsMillingVertex->setPlainText(
+        settings.value("Vertex", _editSettingsMillingVertex->toPlainText()).toString());
+
+    _editSettingsMillingCurveEnd->setPlainText(
+        settings.value("CurveEnd", _editSettingsMillingCurveEnd->toPlainText()).toString());
+
     settings.endGroup();
 
     settings.beginGroup("Drilling");
     _editDrillingSpindleSpeed->setValue(settings.value("SpindleSpeed", 10000).toInt());
     _editDrillingFeedRate->setValue(settings.value("Feed", 1).toInt());
     _editDrillingSafeZ->setValue(settings.value("SafeZ", 1.0).toDouble());
+    _checkDrillingTravelZ->setChecked(settings.value("ReducedTravel", false).toBool());
+    _editDrillingTravelZ->setValue(settings.value("TravelZ", 0.5).toDouble());
+    _editDrillingTravelDistance->setValue(settings.value("TravelDistance", 10.0).toDouble());
     _editDrillingDepth->setValue(settings.value("Depth", 0.0).toDouble());
     _editDrillingStartHeight->setValue(settings.value("StartHeight", 0.5).toDouble());
     _checkDrillingTcHeight->setChecked(settings.value("TcHeightEnabled", false).toBool());
     _editDrillingTcHeight->setValue(settings.value("TcHeight", 0.0).toDouble());
     _checkDrillingSingleTool->setChecked(settings.value("SingleToolEnabled", false).toBool());
+    _comboDrillingToolOrder->setCurrentIndex(
+        settings.value("ToolOrder", DrillingSettings::ToolOrderNumber).toInt());
+    _checkDrillingDuplicates->setChecked(settings.value("RemoveDuplicates", true).toBool());
+    _editDrillingDuplicateTolerance->setValue(
+        settings.value("DuplicateTolerance", 0.01).toDouble());
+    _checkDrillingHelical->setChecked(settings.value("HelicalMilling", false).toBool());
+    _editDrillingEndMill->setValue(settings.value("EndMillDiameter", 1.0).toDouble());
+    _editDrillingHelixPitch->setValue(settings.value("HelixPitch", 0.5).toDouble());
+    _comboDrillingCycle->setCurrentIndex(
+        settings.value("Cycle", DrillingSettings::CycleNone).toInt());
+    _editDrillingPeckDepth->setValue(settings.value("PeckDepth", 0.5).toDouble());
 
     _editSettingsDrillingPrologue->setPlainText(
         settings.value("Prologue", _editSettingsDrillingPrologue->toPlainText()).toString());
@@ -238,6 +328,49 @@ void MainWindow::loadSettings()
     _editSettingsDrillingEpilogue->setPlainText(
         settings.value("Epilogue", _editSettingsDrillingEpilogue->toPlainText()).toString());
 
+    _editSettingsDrillingToolChange->setPlainText(
+        settings.value("ToolChange", _editSettingsDrillingToolChange->toPlainText()).toString());
+
+    _editSettingsDrillingHole->setPlainText(
+        settings.value("Hole", _editSettingsDrillingHole->toPlainText()).toString());
+
+    _editSettingsDrillBits->setText(settings.value("DrillBits").toString());
+    _editSettingsDrillBitTolerance->setValue(settings.value("DrillBitTolerance", 0.05).toDouble());
+    _comboSettingsDrillBitPolicy->setCurrentIndex(
+        settings.value("DrillBitPolicy", DrillLibrary::PolicyNearest).toInt());
+
+    settings.endGroup();
+
+    settings.beginGroup("Machine");
+    _editSettingsRapidRate->setValue(settings.value("RapidRate", 1500.0).toDouble());
+    _editSettingsMaximumFeed->setValue(settings.value("MaximumFeed", 1500.0).toDouble());
+    _editSettingsAccelerationXY->setValue(settings.value("AccelerationXY", 200.0).toDouble());
+    _editSettingsAccelerationZ->setValue(settings.value("AccelerationZ", 100.0).toDouble());
+    _editSettingsToolChangeTime->setValue(settings.value("ToolChangeTime", 20.0).toDouble());
+    settings.endGroup();
+
+    settings.beginGroup("Transform");
+    _checkSettingsMirrorX->setChecked(settings.value("MirrorX", false).toBool());
+    _checkSettingsMirrorY->setChecked(settings.value("MirrorY", false).toBool());
+    _editSettingsRotation->setValue(settings.value("Rotation", 0.0).toDouble());
+    _editSettingsOffsetX->setValue(settings.value("OffsetX", 0.0).toDouble());
+    _editSettingsOffsetY->setValue(settings.value("OffsetY", 0.0).toDouble());
+    _checkSettingsNormalize->setChecked(settings.value("Normalize", false).toBool());
+    settings.endGroup();
+
+    settings.beginGroup("Panel");
+    _editSettingsPanelColumns->setValue(settings.value("Columns", 1).toInt());
+    _editSettingsPanelRows->setValue(settings.value("Rows", 1).toInt());
+    _editSettingsPanelPitchX->setValue(settings.value("PitchX", 50.0).toDouble());
+    _editSettingsPanelPitchY->setValue(settings.value("PitchY", 50.0).toDouble());
+    _editSettingsPanelRotation->setValue(settings.value("Rotation", 0.0).toDouble());
+    _checkSettingsPanelAlternate->setChecked(settings.value("Alternate", false).toBool());
+    settings.endGroup();
+
+    settings.beginGroup("DesignRules");
+    _checkSettingsDesignRules->setChecked(settings.value("CheckDesignRules", true).toBool());
+    _editSettingsClearance->setValue(settings.value("Clearance", 0.2).toDouble());
+    _editSettingsCutterDiameter->setValue(settings.value("CutterDiameter", 0.2).toDouble());
     settings.endGroup();
 }
 
@@ -258,33 +391,109 @@ void MainWindow::saveSettings()
     settings.setValue("LastDirectory", _lastFileDir);
     settings.endGroup();
 
+    settings.beginGroup("Program");
+    settings.setValue("Dialect", _comboSettingsDialect->currentIndex());
+    settings.setValue("OmitModalWords", _checkSettingsModalWords->isChecked());
+    settings.setValue("OmitUnchangedAxes", _checkSettingsUnchangedAxes->isChecked());
+    settings.setValue("TrimZeros", _checkSettingsTrimZeros->isChecked());
+    settings.setValue("SeparatePrograms", _checkSettingsSeparatePrograms->isChecked());
+    settings.endGroup();
+
     settings.beginGroup("Milling");
     settings.setValue("SpindleSpeed", _editMillingSpindleSpeed->value());
     settings.setValue("Feed", _editMillingFeedRate->value());
     settings.setValue("Plunge", _editMillingPlungeRate->value());
     settings.setValue("SafeZ", _editMillingSafeZ->value());
+    settings.setValue("ReducedTravel", _checkMillingTravelZ->isChecked());
+    settings.setValue("TravelZ", _editMillingTravelZ->value());
+    settings.setValue("TravelDistance", _editMillingTravelDistance->value());
     settings.setValue("Depth", _editMillingDepth->value());
+    settings.setValue("MultiPass", _checkMillingMultiPass->isChecked());
+    settings.setValue("StepDown", _editMillingStepDown->value());
+    settings.setValue("RampEntry", _checkMillingRamp->isChecked());
+    settings.setValue("JoinPaths", _checkMillingJoin->isChecked());
+    settings.setValue("Arcs", _checkMillingArcs->isChecked());
+    settings.setValue("ArcTolerance", _editMillingArcTolerance->value());
+    settings.setValue("Simplify", _checkMillingSimplify->isChecked());
+    settings.setValue("SimplifyTolerance", _editMillingSimplifyTolerance->value());
     settings.setValue("Prologue", _editSettingsMillingPrologue->toPlainText());
     settings.setValue("Epilogue", _editSettingsMillingEpilogue->toPlainText());
+    settings.setValue("CurveStart", _editSettingsMillingCurveStart->toPlainText());
+    settings.setValue("Vertex", _editSettingsMillingVertex->toPlainText());
+    settings.setValue("CurveEnd", _editSettingsMillingCurveEnd->toPlainText());
     settings.endGroup();
 
     settings.beginGroup("Drilling");
     settings.setValue("SpindleSpeed", _editDrillingSpindleSpeed->value());
     settings.setValue("Feed", _editDrillingFeedRate->value());
     settings.setValue("SafeZ", _editDrillingSafeZ->value());
+    settings.setValue("ReducedTravel", _checkDrillingTravelZ->isChecked());
+    settings.setValue("TravelZ", _editDrillingTravelZ->value());
+    settings.setValue("TravelDistance", _editDrillingTravelDistance->value());
     settings.setValue("Depth", _editDrillingDepth->value());
     settings.setValue("StartHeight", _editDrillingStartHeight->value());
     settings.setValue("TcHeightEnabled", _checkDrillingTcHeight->isChecked());
     settings.setValue("TcHeight", _editDrillingTcHeight->value());
     settings.setValue("SingleToolEnabled", _checkDrillingSingleTool->isChecked());
+    settings.setValue("ToolOrder", _comboDrillingToolOrder->currentIndex());
+    settings.setValue("RemoveDuplicates", _checkDrillingDuplicates->isChecked());
+    settings.setValue("DuplicateTolerance", _editDrillingDuplicateTolerance->value());
+    settings.setValue("HelicalMilling", _checkDrillingHelical->isChecked());
+    settings.setValue("EndMillDiameter", _editDrillingEndMill->value());
+    settings.setValue("HelixPitch", _editDrillingHelixPitch->value());
+    settings.setValue("Cycle", _comboDrillingCycle->currentIndex());
+    settings.setValue("PeckDepth", _editDrillingPeckDepth->value());
     settings.setValue("Prologue", _editSettingsDrillingPrologue->toPlainText());
     settings.setValue("Epilogue", _editSettingsDrillingEpilogue->toPlainText());
+    settings.setValue("ToolChange", _editSettingsDrillingToolChange->toPlainText());
+    settings.setValue("Hole", _editSettingsDrillingHole->toPlainText());
+    settings.setValue("DrillBits", _editSettingsDrillBits->text());
+    settings.setValue("DrillBitTolerance", _editSettingsDrillBitTolerance->value());
+    settings.setValue("DrillBitPolicy", _comboSettingsDrillBitPolicy->currentIndex());
+    settings.endGroup();
+
+    settings.beginGroup("Machine");
+    settings.setValue("RapidRate", _editSettingsRapidRate->value());
+    settings.setValue("MaximumFeed", _editSettingsMaximumFeed->value());
+    settings.setValue("AccelerationXY", _editSettingsAccelerationXY->value());
+    settings.setValue("AccelerationZ", _editSettingsAccelerationZ->value());
+    settings.setValue("ToolChangeTime", _editSettingsToolChangeTime->value());
+    settings.endGroup();
+
+    settings.beginGroup("Transform");
+    settings.setValue("MirrorX", _checkSettingsMirrorX->isChecked());
+    settings.setValue("MirrorY", _checkSettingsMirrorY->isChecked());
+    settings.setValue("Rotation", _editSettingsRotation->value());
+    settings.setValue("OffsetX", _editSettingsOffsetX->value());
+    settings.setValue("OffsetY", _editSettingsOffsetY->value());
+    settings.setValue("Normalize", _checkSettingsNormalize->isChecked());
+    settings.endGroup();
+
+    settings.beginGroup("Panel");
+    settings.setValue("Columns", _editSettingsPanelColumns->value());
+    settings.setValue("Rows", _editSettingsPanelRows->value());
+    settings.setValue("PitchX", _editSettingsPanelPitchX->value());
+    settings.setValue("PitchY", _editSettingsPanelPitchY->value());
+    settings.setValue("Rotation", _editSettingsPanelRotation->value());
+    settings.setValue("Alternate", _checkSettingsPanelAlternate->isChecked());
+    settings.endGroup();
+
+    settings.beginGroup("DesignRules");
+    settings.setValue("CheckDesignRules", _checkSettingsDesignRules->isChecked());
+    settings.setValue("Clearance", _editSettingsClearance->value());
+    settings.setValue("CutterDiameter", _editSettingsCutterDiameter->value());
     settings.endGroup();
 }
 
-void MainWindow::logParser(int severity, const QString& description, const QString& line)
+void MainWindow::logParser(int severity, const QString& description, const QString& file,
+    const QString& line)
 {
-    _log.add(severity, description, _inputFileName, line);
+    _log.add(severity, description, file, line);
+}
+
+void MainWindow::logProgram(int severity, const QString& description, const QString& line)
+{
+    _log.add(severity, description, tr("[Program]"), line);
 }
 
 void MainWindow::logUpdated(int errors, int warnings, int notices, int accepts)
@@ -355,26 +564,28 @@ void MainWindow::fileCloseAction()
 
 void MainWindow::fileOpenAction()
 {
-    QString fileName = QFileDialog::getOpenFileName(this, tr("Open"), _lastFileDir, tr(
+    // Several files of a board are loaded together as one job
+    QStringList fileNames = QFileDialog::getOpenFileNames(this, tr("Open"), _lastFileDir, tr(
         "Sprint-Layout PCB Export (*.plt *.drl);;"
         "Sprint-Layout HP-GL (*.plt);;"
         "Sprint-Layout Excellon (*.drl);;"
+        "G-code Programs (*.ngc *.nc *.tap);;"
         "All Files (*.*)"));
 
-    if (fileName.isEmpty())
+    if (fileNames.isEmpty())
         return;
 
     if (fileSave(true))
-        fileOpen(fileName);
+        fileOpen(fileNames);
 }
 
 void MainWindow::fileReloadAction()
 {
-    // WARNING: It's important to make a copy of the string with current file name
-    QString fileName = _inputFilePath;
+    // WARNING: It's important to make a copy of the list with current file names
+    QStringList fileNames = _inputFilePaths;
 
     if (fileSave(true))
-        fileOpen(fileName);
+        fileOpen(fileNames);
 }
 
 void MainWindow::fileSaveAction()
@@ -392,37 +603,96 @@ void MainWindow::generate()
     _log.remove(tr("[Program]"));
 
     _editProgram->clear();
+    _programs.clear();
+    _programNames.clear();
 
-    if (!_parser)
+    if (_job.isEmpty())
         return;
 
-    _operationCanceled = false;
-    connect(_progress, SIGNAL(canceled()), this, SLOT(cancelOperation()));
+    ProgramGenerator generator;
+    generator.setDialect(_comboSettingsDialect->currentIndex());
+    generator.setCompression(compressionOptions());
+    generator.setTransform(_job.placement(geometryTransform()));
+    generator.setPanel(panel());
 
-    if (_parser->type() == AbstractParser::ParserDrilling)
-    {
-        operationStarted(tr("Creating Drilling Program"));
-        generateDrilling();
-        operationFinished();
-    }
-    else if (_parser->type() == AbstractParser::ParserMillling)
+    connect(_progress, SIGNAL(canceled()), &generator, SLOT(interrupt()));
+    connect(&generator, SIGNAL(started(const QString&)),
+        this, SLOT(operationStarted(const QString&)));
+    connect(&generator, SIGNAL(progress(int, int)),
+        this, SLOT(operationProgress(int, int)));
+    connect(&generator, SIGNAL(finished()),
+        this, SLOT(operationFinished()));
+
+    connect(&generator, SIGNAL(log(int, const QString&, const QString&)), this,
+        SLOT(logProgram(int, const QString&, const QString&)));
+
+    const QList<JobOperation>& operations = _job.operations();
+    bool separate = _checkSettingsSeparatePrograms->isChecked() && operations.size() > 1;
+
+    QStringList programs;
+    QStringList names;
+    int milling = operations.size() - (_job.drilling() ? 1 : 0);
+
+    lockFileActions(true);
+
+    for (int i = 0; i < operations.size() && !generator.isInterrupted(); ++i)
     {
-        operationStarted(tr("Creating Millling Program"));
-        generateMilling();
-        operationFinished();
+        const JobOperation& operation = operations[i];
+        QString program;
+
+        // A combined program starts with its first operation and ends with its last one
+        generator.setProgramStart(separate || i == 0);
+        generator.setProgramEnd(separate || i + 1 == operations.size());
+
+        if (operation.parser->type() == AbstractParser::ParserDrilling)
+        {
+            generator.generateDrilling(*operation.parser, drillingSettings(), program);
+            names.append("drilling");
+        }
+        else
+        {
+            generator.generateMilling(*operation.parser, millingSettings(), program);
+            names.append((milling > 1) ? QString("milling-%1")
+                .arg(QFileInfo(operation.files.first()).completeBaseName()) : "milling");
+        }
+
+        programs.append(program);
     }
-    else
+
+    lockFileActions(false);
+
+    if (separate)
     {
-        return;
+        _programs = programs;
+        _programNames = names;
     }
 
-    if (_operationCanceled)
+    _editProgram->setPlainText(programs.join(separate ? "\n\n" : "\n"));
+
+    if (generator.isInterrupted())
     {
         _log.warning(tr("Building the program has been canceled."), tr("[Program]"));
     }
     else
     {
-        _log.accept(tr("The program has been successfully built."), tr("[Program]"));
+        if (separate)
+        {
+            _log.accept(tr("The programs of %1 operations have been successfully built.")
+                .arg(programs.size()), tr("[Program]"));
+        }
+        else
+        {
+            _log.accept(tr("The program has been successfully built."), tr("[Program]"));
+        }
+
+        Toolpath toolpath;
+        GcodeReader reader;
+        reader.read(_editProgram->toPlainText().toLatin1(), toolpath);
+
+        logEstimate(toolpath, tr("[Program]"));
+
+        if (!_headless)
+            previewToolpath(toolpath);
     }
 
     _tabs->setCurrentWidget(_tabProgram);
@@ -431,6 +701,141 @@ void MainWindow::generate()
     setScriptIcon(ScriptGreen);
 }
 
+void MainWindow::updatePreview(bool final)
+{
+    const QList<JobOperation>& operations = _job.operations();
+
+    if (operations.isEmpty())
+        return;
+
+    QVector<PreviewItem> items = _preview->items();
+
+    if (!final)
+    {
+        // Only a single file is parsed here, its settled curves are shown as they come
+        const AbstractParser& parser = *operations.first().parser;
+        int count = parser.settledCount();
+
+        if (count <= _previewCurves)
+            return;
+
+        PreviewBuilder::appendCurves(parser, _previewCurves, count, items);
+        _previewCurves = count;
+
+        _preview->setItems(items);
+        return;
+    }
+
+    // The repeats are resolved only with the whole file
+    for (; _previewOperation < operations.size(); ++_previewOperation)
+    {
+        const AbstractParser& parser = *operations[_previewOperation].parser;
+
+        PreviewBuilder::appendCurves(parser, _previewCurves, parser.curves().size(), items);
+        PreviewBuilder::appendRepeats(parser, 0, parser.repeats().size(), items);
+
+        _previewCurves = 0;
+    }
+
+    // The loaded geometry is shown where the program will place it
+    _preview->setItems(items, previewInstances());
+}
+
+QVector<QTransform> MainWindow::previewInstances() const
+{
+    QVector<QTransform> instances;
+
+    GeometryTransform transform = _job.placement(geometryTransform());
+    Panel panel = this->panel();
+
+    if (_job.isEmpty() || (transform.isIdentity() && panel.isSingle()))
+        return instances;
+
+    // The placement of the job is the same matrix for all of its files
+    BoundingBox bounds;
+    QTransform matrix = transform.matrix(*_job.operations().first().parser, bounds);
+
+    foreach (const PanelInstance& instance, panel.instances())
+        instances.append(matrix * instance.matrix());
+
+    return instances;
+}
+
+void MainWindow::previewToolpath(const Toolpath& toolpath)
+{
+    QVector<PreviewItem> items;
+    PreviewBuilder::appendToolpath(toolpath, items);
+
+    _preview->setItems(items);
+}
+
+void MainWindow::logEstimate(const Toolpath& toolpath, const QString& file)
+{
+    MachiningEstimate estimate = MachiningEstimator::estimate(toolpath, machineSettings());
+
+    _log.notice(tr("Estimated machining time: %1 (rapid moves %2, cutting %3, tool changes %4).\n"
+        "Rapid distance: %5 mm, cutting distance: %6 mm, %7 plunges, %8 tool changes.")
+        .arg(Utilities::durationToString(estimate.time),
+            Utilities::durationToString(estimate.rapidTime),
+            Utilities::durationToString(estimate.cuttingTime),
+            Utilities::durationToString(estimate.toolChangeTime),
+            Utilities::doubleToString(estimate.rapidDistance, 1),
+            Utilities::doubleToString(estimate.cuttingDistance, 1))
+        .arg(estimate.plunges).arg(estimate.toolChanges), file);
+}
+
+int MainWindow::exportProgram(const QStringList& inputFiles, const QString& outputFile)
+{
+    _headless = true;
+
+    fileOpen(inputFiles);
+
+    if (!_job.isEmpty())
+        generate();
+
+    bool saved = false;
+
+    if (!_editProgram->document()->isEmpty())
+    {
+        QString errorString;
+        saved = fileWrite(outputFile, errorString);
+
+        if (!saved)
+        {
+            _log.error(tr("Unable to write the program to %1.\n%2")
+                .arg(outputFile, errorString), tr("[Program]"));
+        }
+    }
+
+    printLog();
+
+    return saved ? 0 : 1;
+}
+
+int MainWindow::analyzeProgram(const QString& fileName)
+{
+    _headless = true;
+
+    fileOpen(fileName);
+    printLog();
+
+    return _inputFilePaths.isEmpty() ? 1 : 0;
+}
+
+void MainWindow::printLog()
+{
+    // The log goes to the standard output, one entry per line
+    QTextStream output(stdout);
+
+    foreach (const LogItem& item, _log.items())
+    {
+        QString source = item.line.trimmed().isEmpty() ? item.file
+            : QString("%1:%2").arg(item.file, item.line);
+
+        output << source << ": " << QString(item.description).replace('\n', ' ') << '\n';
+    }
+}
+
 void MainWindow::settingsOpen()
 {
     if (_tabs->widget(0) != _tabSettings)
@@ -442,6 +847,16 @@ void MainWindow::settingsOpen()
 void MainWindow::settingsClose()
 {
     _tabs->removeTab(_tabs->indexOf(_tabSettings));
+
+    // The transform and the panel may have changed, the built program stays as it is
+    if (!_job.isEmpty() && _editProgram->document()->isEmpty())
+        updatePreview(true);
+}
+
+void MainWindow::drillingCycleChanged(int cycle)
+{
+    _editDrillingPeckDepth->setEnabled(cycle == DrillingSettings::CycleG83 ||
+        cycle == DrillingSettings::CycleG73);
 }
 
 void MainWindow::layoutReset()
@@ -471,6 +886,14 @@ void MainWindow::operationStarted(const QString& operation)
 void MainWindow::operationProgress(int done, int total)
 {
     _progress->setProgress(done, total);
+
+    // The preview shows the curves parsed so far
+    if (_parsing && _previewTimer.elapsed() >= PreviewInterval)
+    {
+        updatePreview(false);
+        _previewTimer.restart();
+    }
+
     QApplication::processEvents();
 }
 
@@ -480,15 +903,10 @@ void MainWindow::operationFinished()
     QApplication::processEvents();
 }
 
-void MainWindow::cancelOperation()
-{
-    _operationCanceled = true;
-}
-
 void MainWindow::fileClose()
 {
     // File State
-    _inputFilePath.clear();
+    _inputFilePaths.clear();
     _inputFileName.clear();
     _currentFileName.clear();
     _currentFilePath.clear();
@@ -496,17 +914,20 @@ void MainWindow::fileClose()
     updateProjectState(false);
     setScriptIcon(ScriptPlain);
 
-    if (_parser)
-    {
-        delete _parser;
-        _parser = nullptr;
-    }
+    _job.clear();
 
     // Clear Log
     _log.clear();
 
     // Clear Program
     _editProgram->clear();
+    _programs.clear();
+    _programNames.clear();
+
+    // Clear Preview
+    _preview->clear();
+    _previewOperation = 0;
+    _previewCurves = 0;
 
     // CNC Options
     _dockMilling->setDisabled(true);
@@ -522,39 +943,66 @@ void MainWindow::fileClose()
     _tabs->setCurrentWidget(_tabLog);
 }
 
-void MainWindow::fileOpen(const QString& fileName)
+void MainWindow::fileOpen(const QStringList& fileNames)
 {
     const QString errorHeader = tr("StepCAM cannot open the file");
     const QString errorReason = tr("The file format or file extension is not valid. "
         "Verify that the file has not been corrupted and that the file extension "
         "matches the format of the file.");
 
-    if (fileName.isEmpty())
+    if (fileNames.isEmpty())
         return;
 
     fileClose();
 
-    QFile file(fileName);
-    QFileInfo fileInfo(fileName);
+    QFileInfo fileInfo(fileNames.first());
 
     _inputFileName = fileInfo.fileName();
 
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    foreach (const QString& fileName, fileNames)
     {
-        // Cannot open the file
-        QMessageBox::critical(this, QApplication::applicationName(), QString("%1<br>%2.<br><br>%3")
-            .arg(errorHeader, fileName, file.errorString()), QMessageBox::Ok, QMessageBox::Ok);
+        QFile file(fileName);
 
-        _log.error(QString("%1.\n%2").arg(errorHeader, file.errorString()), _inputFileName);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            // Cannot open the file
+            if (!_headless)
+                QMessageBox::critical(this, QApplication::applicationName(), QString("%1<br>%2.<br><br>%3")
+                .arg(errorHeader, fileName, file.errorString()), QMessageBox::Ok, QMessageBox::Ok);
 
-        return;
+            _log.error(QString("%1.\n%2").arg(errorHeader, file.errorString()),
+                QFileInfo(fileName).fileName());
+
+            return;
+        }
     }
 
     QString extension = fileInfo.suffix().toLower();
 
-    if (fileParse(file, extension))
+    if (fileNames.size() == 1 && (extension == "ngc" || extension == "nc" || extension == "tap"))
     {
-        _inputFilePath = fileName;
+        QFile file(fileNames.first());
+        file.open(QIODevice::ReadOnly | QIODevice::Text);
+
+        if (fileAnalyze(file))
+        {
+            _inputFilePaths = fileNames;
+            _lastFileDir = fileInfo.path();
+
+            _actionReload->setEnabled(true);
+            _actionClose->setEnabled(true);
+        }
+        else
+        {
+            _log.error(tr("The file does not contain any machine moves."), _inputFileName);
+        }
+
+        return;
+    }
+
+    if (fileParse(fileNames))
+    {
+        _inputFilePaths = fileNames;
         _currentFileName = tr("Untitled");
         _currentFilePath.clear();
         _lastFileDir = fileInfo.path();
@@ -565,21 +1013,31 @@ void MainWindow::fileOpen(const QString& fileName)
         _actionReload->setEnabled(true);
         _actionClose->setEnabled(true);
         _actionGenerate->setEnabled(true);
+
+        checkDesignRules();
     }
     else
     {
-        if (_parser && _parser->isInterrupted())
+        if (_job.isInterrupted())
         {
-            _log.warning(tr("The file parsing was interrupted."), fileInfo.fileName());
-            delete _parser;
-            _parser = nullptr;
+            _log.warning(tr("The file parsing was interrupted."),
+                (fileNames.size() == 1) ? _inputFileName : tr("[Job]"));
+            _job.clear();
             return;
         }
 
-        QMessageBox::critical(this, QApplication::applicationName(), QString("%1<br>%2.<br><br>%3")
-            .arg(errorHeader, fileName, errorReason), QMessageBox::Ok, QMessageBox::Ok);
+        if (!_headless)
+        {
+            QMessageBox::critical(this, QApplication::applicationName(),
+                QString("%1<br>%2.<br><br>%3").arg(errorHeader, _job.failures().join("<br>"),
+                errorReason), QMessageBox::Ok, QMessageBox::Ok);
+        }
 
-        _log.error(QString("%1.\n%2").arg(errorHeader, errorReason), fileInfo.fileName());
+        foreach (const QString& fileName, _job.failures())
+        {
+            _log.error(QString("%1.\n%2").arg(errorHeader, errorReason),
+                QFileInfo(fileName).fileName());
+        }
     }
 }
 
@@ -619,13 +1077,10 @@ bool MainWindow::fileSave(bool final, bool relocate)
         if (fileName.isEmpty())
             break;
 
-        QFile file(fileName);
+        QString errorString;
 
-        if (file.open(QIODevice::WriteOnly | QIODevice::Text))
+        if (fileWrite(fileName, errorString))
         {
-            file.write(_editProgram->toPlainText().toUtf8());
-            file.close();
-
             _currentFilePath = fileName;
             _currentFileName = QFileInfo(_currentFilePath).completeBaseName();
             updateProjectState(false);
@@ -641,173 +1096,381 @@ bool MainWindow::fileSave(bool final, bool relocate)
     return false;
 }
 
-bool MainWindow::fileParse(QFile& file, const QString& extension)
+bool MainWindow::fileWrite(const QString& fileName, QString& errorString)
 {
-    QDockWidget* dockWidget = nullptr;
+    QStringList fileNames;
+    QStringList programs;
 
-    if (extension == "drl")
+    if (_programs.isEmpty())
     {
-        _parser = new ExcellonParser(this);
-        dockWidget = _dockDrilling;
+        fileNames.append(fileName);
+        programs.append(_editProgram->toPlainText());
     }
-    else if (extension == "plt")
+    else
     {
-        _parser = new HpglParser(this);
-        dockWidget = _dockMilling;
+        // Every operation gets the file name with its own suffix
+        QFileInfo fileInfo(fileName);
+        QString suffix = fileInfo.suffix().isEmpty() ? QString("ngc") : fileInfo.suffix();
+
+        for (int i = 0; i < _programs.size(); ++i)
+        {
+            fileNames.append(fileInfo.dir().filePath(QString("%1-%2.%3")
+                .arg(fileInfo.completeBaseName(), _programNames.value(i), suffix)));
+            programs.append(_programs[i]);
+        }
     }
-    else
+
+    for (int i = 0; i < fileNames.size(); ++i)
     {
-        return false;
+        QFile file(fileNames[i]);
+
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text) ||
+            file.write(programs[i].toUtf8()) < 0)
+        {
+            errorString = file.errorString();
+            return false;
+        }
+
+        file.close();
     }
 
-    if (!_parser)
+    return true;
+}
+
+bool MainWindow::fileAnalyze(QFile& file)
+{
+    Toolpath toolpath;
+    GcodeReader reader;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    int ignored = reader.read(file, toolpath);
+    qint64 elapsed = qMax(timer.elapsed(), Q_INT64_C(1));
+
+    if (toolpath.moves.isEmpty())
         return false;
 
-    connect(_progress, SIGNAL(canceled()), _parser, SLOT(interrupt()));
-    connect(_parser, SIGNAL(started(const QString&)),
-        this, SLOT(operationStarted(const QString&)));
-    connect(_parser, SIGNAL(progress(int, int)),
-        this, SLOT(operationProgress(int, int)));
-    connect(_parser, SIGNAL(finished()),
-        this, SLOT(operationFinished()));
+    int rapids = 0;
+    int arcs = 0;
+    double minimumSpeed = 0.0;
+    double maximumSpeed = 0.0;
+    double maximumFeed = 0.0;
+    QSet<int> tools;
 
-    connect(_parser, SIGNAL(log(int, const QString&, const QString&)), this,
-        SLOT(logParser(int, const QString&, const QString&)));
+    const ToolpathMove& first = toolpath.moves.first();
 
-    bool result = _parser->parse(file);
-    if (result && dockWidget)
-        dockWidget->setEnabled(true);
+    double minimumX = first.x;
+    double minimumY = first.y;
+    double minimumZ = first.z;
+    double maximumX = first.x;
+    double maximumY = first.y;
+    double maximumZ = first.z;
 
-    _progress->hide();
-    return result;
+    foreach (const ToolpathMove& move, toolpath.moves)
+    {
+        minimumX = qMin(minimumX, move.x);
+        minimumY = qMin(minimumY, move.y);
+        minimumZ = qMin(minimumZ, move.z);
+        maximumX = qMax(maximumX, move.x);
+        maximumY = qMax(maximumY, move.y);
+        maximumZ = qMax(maximumZ, move.z);
+
+        if (move.type == ToolpathMove::TypeRapid)
+        {
+            ++rapids;
+            continue;
+        }
+
+        if (move.isArc())
+            ++arcs;
+
+        if (move.spindle > 0.0)
+        {
+            minimumSpeed = (minimumSpeed > 0.0) ? qMin(minimumSpeed, move.spindle) : move.spindle;
+            maximumSpeed = qMax(maximumSpeed, move.spindle);
+        }
+
+        maximumFeed = qMax(maximumFeed, move.feed);
+        tools.insert(move.tool);
+    }
+
+    _log.notice(tr("%1 lines have been read in %2 ms (%3 MB/s), %4 of them contain "
+        "unsupported commands.").arg(reader.lines()).arg(elapsed)
+        .arg(Utilities::doubleToString(file.size() / 1000.0 / elapsed, 1)).arg(ignored),
+        _inputFileName);
+
+    _log.notice(tr("Moves: %1 rapid, %2 linear, %3 arc; %4 cutting tools, %5 tool changes.\n"
+        "Spindle speed: %6 - %7, maximum feed: %8 mm/min.\n"
+        "Extents: X %9 .. %10, Y %11 .. %12, Z %13 .. %14 mm.")
+        .arg(rapids).arg(toolpath.moves.size() - rapids - arcs).arg(arcs)
+        .arg(tools.size()).arg(toolpath.toolChanges)
+        .arg(Utilities::doubleToString(minimumSpeed, 0),
+            Utilities::doubleToString(maximumSpeed, 0),
+            Utilities::doubleToString(maximumFeed, 0),
+            Utilities::doubleToString(minimumX, 3),
+            Utilities::doubleToString(maximumX, 3),
+            Utilities::doubleToString(minimumY, 3),
+            Utilities::doubleToString(maximumY, 3),
+            Utilities::doubleToString(minimumZ, 3))
+        .arg(Utilities::doubleToString(maximumZ, 3)), _inputFileName);
+
+    logEstimate(toolpath, _inputFileName);
+
+    if (!_headless)
+        previewToolpath(toolpath);
+
+    return true;
 }
 
-void MainWindow::generateDrilling()
+bool MainWindow::fileParse(const QStringList& fileNames)
 {
-    _editProgram->append(_editSettingsDrillingPrologue->toPlainText());
+    _parsing = !_headless;
+    _previewTimer.start();
+
+    lockFileActions(true);
+    bool result = _job.load(fileNames);
+    lockFileActions(false);
 
-    if (!_checkDrillingSingleTool->isChecked())
+    _parsing = false;
+
+    if (result)
     {
-        foreach (AbstractTool tool, _parser->tools())
+        foreach (const JobOperation& operation, _job.operations())
         {
-            if (tool.id() > 0)
-            {
-                _editProgram->append(QString("( Drill Bit #%1 / %2 mm )")
-                    .arg(tool.id()).arg(Utilities::coordinateToString(tool.diameter())));
-            }
+            if (operation.parser->type() == AbstractParser::ParserDrilling)
+                _dockDrilling->setEnabled(true);
+            else
+                _dockMilling->setEnabled(true);
         }
+
+        if (!_headless)
+            updatePreview(true);
     }
 
-    QString feedRate = QString::number(_editDrillingFeedRate->value());
-    QString spindleSpeed = QString::number(_editDrillingSpindleSpeed->value());
+    _progress->hide();
+    return result;
+}
 
-    QString safeZ = Utilities::doubleToString(_editDrillingSafeZ->value(), 3);
-    QString depth = Utilities::doubleToString(_editDrillingDepth->value(), 3);
-    QString startHeight = Utilities::doubleToString(_editDrillingStartHeight->value(), 3);
-    QString toolHeight = Utilities::doubleToString(_editDrillingTcHeight->value(), 3);
+void MainWindow::checkDesignRules()
+{
+    if (_job.isEmpty() || !_checkSettingsDesignRules->isChecked())
+        return;
 
-    int toolNumber = 0;
+    const JobOperation* holes = _job.drilling();
 
-    _editProgram->append(QString("G0 Z").append(safeZ));
-    _editProgram->append(QString("G1 F").append(feedRate));
+    if (!holes)
+        return;
 
-    if (_checkDrillingSingleTool->isChecked())
-        _editProgram->append(QString("M3 S").append(spindleSpeed));
+    // The milling files one after another, the operation tells their curves apart
+    JobOperation paths;
+    QList<AbstractCurve> pathCurves;
 
-    int total = _parser->curves().count();
-    for (int i = 0; i < total; ++i)
+    foreach (const JobOperation& operation, _job.operations())
     {
-        const AbstractCurve& point = _parser->curves()[i];
-        operationProgress(i, total);
+        if (operation.parser->type() != AbstractParser::ParserMillling)
+            continue;
 
-        if (_operationCanceled)
-            return;
+        paths.files.append(operation.files.first());
+        paths.firsts.append(pathCurves.size());
+        pathCurves.append(operation.parser->curves());
+    }
 
-        if (!_checkDrillingSingleTool->isChecked() && point.tool() != toolNumber)
-        {
-            QString tool = QString::number(point.tool());
-            QString diameter =
-                Utilities::coordinateToString(_parser->tools()[point.tool()].diameter());
-
-            // Tool Change
-            _editProgram->append("M5");
-
-            _editProgram->append(QString("( Tool Change T%1 / %2 mm )").arg(tool, diameter));
-            if (_checkDrillingTcHeight->isChecked())
-            {
-                _editProgram->append(QString("G0 Z").append(toolHeight));
-            }
-            _editProgram->append(QString("M6 T").append(tool));
-            _editProgram->append(QString("G1 F").append(feedRate));
-            _editProgram->append(QString("M3 S").append(spindleSpeed));
-            toolNumber = point.tool();
-        }
+    QString holeFile = (holes->files.size() == 1) ? holes->files.first() : tr("[Job]");
+    QString pathFile = paths.files.join(", ");
 
-        QString x;
-        QString y;
+    QVector<DesignRuleViolation> violations = DesignRuleCheck::check(holes->parser->curves(),
+        holes->parser->repeats(), holes->parser->tools(), pathCurves,
+        qRound64(_editSettingsCutterDiameter->value() * 1000.0),
+        qRound64(_editSettingsClearance->value() * 1000.0));
 
-        if (point.count() > 0)
+    for (int i = 0; i < violations.size() && i < DesignRuleLogLimit; ++i)
+    {
+        const DesignRuleViolation& violation = violations[i];
+
+        QString position = QString("X%1 Y%2").arg(Utilities::coordinateToString(violation.x),
+            Utilities::coordinateToString(violation.y));
+        QString distance = Utilities::coordinateToString(qAbs(violation.clearance));
+        QString file = holes->fileOf(violation.curve);
+        QString otherFile = holes->fileOf(violation.otherCurve);
+        QString description;
+
+        switch (violation.type)
         {
-            x = Utilities::coordinateToString(point.x()[0]);
-            y = Utilities::coordinateToString(point.y()[0]);
+        case DesignRuleViolation::TypeHoleOverlap:
+            description = (otherFile == file)
+                ? tr("The hole at %1 overlaps the hole at line %2 by %3 mm.")
+                .arg(position).arg(violation.otherLine).arg(distance)
+                : tr("The hole at %1 overlaps the hole at line %2 of %3 by %4 mm.")
+                .arg(position).arg(violation.otherLine).arg(otherFile, distance);
+            break;
+
+        case DesignRuleViolation::TypeHoleClearance:
+            description = (otherFile == file)
+                ? tr("The hole at %1 is %3 mm away from the hole at line %2.")
+                .arg(position).arg(violation.otherLine).arg(distance)
+                : tr("The hole at %1 is %4 mm away from the hole at line %2 of %3.")
+                .arg(position).arg(violation.otherLine).arg(otherFile, distance);
+            break;
+
+        case DesignRuleViolation::TypePathOverlap:
+            description = tr("The hole at %1 overlaps the milling path at line %2 of %3 by %4 mm.")
+                .arg(position).arg(violation.otherLine)
+                .arg(paths.fileOf(violation.otherCurve), distance);
+            break;
+
+        default:
+            description = tr("The hole at %1 is %4 mm away from the milling path at line %2 of %3.")
+                .arg(position).arg(violation.otherLine)
+                .arg(paths.fileOf(violation.otherCurve), distance);
+            break;
         }
 
-        _editProgram->append(QString("G0 X%1 Y%2").arg(x, y));
-        _editProgram->append(QString("G0 Z").append(startHeight));
-        _editProgram->append(QString("G1 Z").append(depth));
-        _editProgram->append(QString("G0 Z").append(safeZ));
+        _log.warning(description, file, QString::number(violation.line));
     }
 
-    _editProgram->append(_editSettingsDrillingEpilogue->toPlainText());
+    if (violations.size() > DesignRuleLogLimit)
+    {
+        _log.warning(tr("%1 more holes violate the minimum clearance of %2 mm.")
+            .arg(violations.size() - DesignRuleLogLimit)
+            .arg(_editSettingsClearance->value()), holeFile);
+    }
+    else if (violations.isEmpty())
+    {
+        _log.accept(!paths.files.isEmpty() ? tr("The holes keep the minimum clearance of %1 mm "
+            "to each other and to the milling paths of %2.").arg(_editSettingsClearance->value())
+            .arg(pathFile) : tr("The holes keep the minimum clearance of %1 mm to each other.")
+            .arg(_editSettingsClearance->value()), holeFile);
+    }
 }
 
-void MainWindow::generateMilling()
+DrillingSettings MainWindow::drillingSettings() const
 {
-    _editProgram->append(_editSettingsMillingPrologue->toPlainText());
+    DrillingSettings settings;
+
+    settings.spindleSpeed = _editDrillingSpindleSpeed->value();
+    settings.feedRate = _editDrillingFeedRate->value();
+    settings.safeZ = _editDrillingSafeZ->value();
+    settings.reducedTravel = _checkDrillingTravelZ->isChecked();
+    settings.travelZ = _editDrillingTravelZ->value();
+    settings.travelDistance = _editDrillingTravelDistance->value();
+    settings.depth = _editDrillingDepth->value();
+    settings.startHeight = _editDrillingStartHeight->value();
+    settings.tcHeightEnabled = _checkDrillingTcHeight->isChecked();
+    settings.tcHeight = _editDrillingTcHeight->value();
+    settings.singleTool = _checkDrillingSingleTool->isChecked();
+    settings.toolOrder = _comboDrillingToolOrder->currentIndex();
+    settings.removeDuplicates = _checkDrillingDuplicates->isChecked();
+    settings.duplicateTolerance = _editDrillingDuplicateTolerance->value();
+    settings.helicalMilling = _checkDrillingHelical->isChecked();
+    settings.endMillDiameter = _editDrillingEndMill->value();
+    settings.helixPitch = _editDrillingHelixPitch->value();
+    settings.cycle = _comboDrillingCycle->currentIndex();
+    settings.peckDepth = _editDrillingPeckDepth->value();
+
+    settings.prologue = _editSettingsDrillingPrologue->toPlainText();
+    settings.epilogue = _editSettingsDrillingEpilogue->toPlainText();
+    settings.toolChange = _editSettingsDrillingToolChange->toPlainText();
+    settings.hole = _editSettingsDrillingHole->toPlainText();
+
+    settings.drillLibrary.setTolerance(qRound(_editSettingsDrillBitTolerance->value() * 1000.0));
+    settings.drillLibrary.setPolicy(_comboSettingsDrillBitPolicy->currentIndex());
+    settings.drillLibrary.parse(_editSettingsDrillBits->text());
+
+    return settings;
+}
 
-    QString feedRate = QString::number(_editMillingFeedRate->value());
-    QString plungeRate = QString::number(_editMillingPlungeRate->value());
-    QString spindleSpeed = QString::number(_editMillingSpindleSpeed->value());
+MachineSettings MainWindow::machineSettings() const
+{
+    MachineSettings settings;
 
-    QString safeZ = Utilities::doubleToString(_editMillingSafeZ->value(), 3);
-    QString depth = Utilities::doubleToString(_editMillingDepth->value(), 3);
+    settings.rapidRate = _editSettingsRapidRate->value();
+    settings.maximumFeed = _editSettingsMaximumFeed->value();
+    settings.accelerationXY = _editSettingsAccelerationXY->value();
+    settings.accelerationZ = _editSettingsAccelerationZ->value();
+    settings.toolChangeTime = _editSettingsToolChangeTime->value();
 
-    _editProgram->append(QString("G0 Z").append(safeZ));
-    _editProgram->append(QString("M3 S").append(spindleSpeed));
+    return settings;
+}
 
-    int total = _parser->curves().count();
-    for (int i = 0; i < total; ++i)
-    {
-        const AbstractCurve& curve = _parser->curves()[i];
-        operationProgress(i, total);
+GeometryTransform MainWindow::geometryTransform() const
+{
+    GeometryTransform transform;
 
-        if (_operationCanceled)
-            return;
+    transform.mirrorX = _checkSettingsMirrorX->isChecked();
+    transform.mirrorY = _checkSettingsMirrorY->isChecked();
+    transform.rotation = _editSettingsRotation->value();
+    transform.normalize = _checkSettingsNormalize->isChecked();
+    transform.offsetX = qRound64(_editSettingsOffsetX->value() * 1000.0);
+    transform.offsetY = qRound64(_editSettingsOffsetY->value() * 1000.0);
 
-        if (curve.type() == AbstractCurve::CurveTypeNone)
-            continue;
+    return transform;
+}
 
-        for (int i = 0; i < curve.count(); ++i)
-        {
-            QString x = Utilities::coordinateToString(curve.x()[i]);
-            QString y = Utilities::coordinateToString(curve.y()[i]);
-
-            if (i == 0)
-            {
-                _editProgram->append(QString("G0 X%1 Y%2").arg(x, y));
-                _editProgram->append(QString("G1 Z%1 F%2").arg(depth, plungeRate));
-                _editProgram->append(QString("G1 F").append(feedRate));
-            }
-            else
-            {
-                _editProgram->append(QString("G1 X%1 Y%2").arg(x, y));
-            }
-        }
+Panel MainWindow::panel() const
+{
+    Panel panel;
 
-        _editProgram->append(QString("G0 Z").append(safeZ));
-    }
+    panel.columns = _editSettingsPanelColumns->value();
+    panel.rows = _editSettingsPanelRows->value();
+    panel.pitchX = qRound64(_editSettingsPanelPitchX->value() * 1000.0);
+    panel.pitchY = qRound64(_editSettingsPanelPitchY->value() * 1000.0);
+    panel.rotation = _editSettingsPanelRotation->value();
+    panel.alternate = _checkSettingsPanelAlternate->isChecked();
+
+    return panel;
+}
+
+int MainWindow::compressionOptions() const
+{
+    int options = GcodeCompressor::OptionNone;
+
+    if (_checkSettingsModalWords->isChecked())
+        options |= GcodeCompressor::OptionModalWords;
+
+    if (_checkSettingsUnchangedAxes->isChecked())
+        options |= GcodeCompressor::OptionUnchangedAxes;
+
+    if (_checkSettingsTrimZeros->isChecked())
+        options |= GcodeCompressor::OptionTrimZeros;
 
-    _editProgram->append(_editSettingsMillingEpilogue->toPlainText());
+    return options;
+}
+
+MillingSettings MainWindow::millingSettings() const
+{
+    MillingSettings settings;
+
+    settings.spindleSpeed = _editMillingSpindleSpeed->value();
+    settings.feedRate = _editMillingFeedRate->value();
+    settings.plungeRate = _editMillingPlungeRate->value();
+    settings.safeZ = _editMillingSafeZ->value();
+    settings.reducedTravel = _checkMillingTravelZ->isChecked();
+    settings.travelZ = _editMillingTravelZ->value();
+    settings.travelDistance = _editMillingTravelDistance->value();
+    settings.depth = _editMillingDepth->value();
+    settings.multiPass = _checkMillingMultiPass->isChecked();
+    settings.stepDown = _editMillingStepDown->value();
+    settings.rampEntry = _checkMillingRamp->isChecked();
+    settings.joinPaths = _checkMillingJoin->isChecked();
+    settings.arcs = _checkMillingArcs->isChecked();
+    settings.arcTolerance = _editMillingArcTolerance->value();
+    settings.simplify = _checkMillingSimplify->isChecked();
+    settings.simplifyTolerance = _editMillingSimplifyTolerance->value();
+
+    // The machine has one tool change procedure, the drilling one
+    settings.cutterDiameter = _editSettingsCutterDiameter->value();
+    settings.tcHeightEnabled = _checkDrillingTcHeight->isChecked();
+    settings.tcHeight = _editDrillingTcHeight->value();
+
+    settings.prologue = _editSettingsMillingPrologue->toPlainText();
+    settings.epilogue = _editSettingsMillingEpilogue->toPlainText();
+    settings.toolChange = _editSettingsDrillingToolChange->toPlainText();
+    settings.curveStart = _editSettingsMillingCurveStart->toPlainText();
+    settings.vertex = _editSettingsMillingVertex->toPlainText();
+    settings.curveEnd = _editSettingsMillingCurveEnd->toPlainText();
+
+    return settings;
 }
 
 void MainWindow::setScriptIcon(int icon)
@@ -831,3 +1494,29 @@ void MainWindow::setScriptIcon(int icon)
         break;
     }
 }
+
+void MainWindow::lockFileActions(bool lock)
+{
+    _busy = lock;
+
+    if (!lock)
+    {
+        foreach (QAction* action, _lockedActions)
+            action->setEnabled(true);
+
+        _lockedActions.clear();
+        return;
+    }
+
+    QList<QAction*> actions;
+    actions << _actionOpen << _actionReload << _actionClose << _actionGenerate;
+
+    foreach (QAction* action, actions)
+    {
+        if (action->isEnabled())
+        {
+            action->setEnabled(false);
+            _lockedActions.append(action);
+        }
+    }
+}
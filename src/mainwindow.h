@@ -24,9 +24,14 @@
 
 #include "ui_mainwindow.h"
 
+#include <QElapsedTimer>
+
 #include "logtablemodel.h"
 #include "abstractparser.h"
+#include "job.h"
 #include "progressstatuswidget.h"
+#include "programgenerator.h"
+#include "machiningestimator.h"
 
 
 class MainWindow : public QMainWindow, private Ui::MainWindow
@@ -36,7 +41,9 @@ class MainWindow : public QMainWindow, private Ui::MainWindow
 public:
     explicit MainWindow(QWidget* parent = nullptr);
 
-    void loadExternalFile(const QString& fileName);
+    void loadExternalFiles(const QStringList& fileNames);
+    int exportProgram(const QStringList& inputFiles, const QString& outputFile);
+    int analyzeProgram(const QString& fileName);
 
 protected:
     virtual void closeEvent(QCloseEvent* event);
@@ -44,7 +51,9 @@ protected:
 private slots:
     void loadSettings();
     void saveSettings();
-    void logParser(int severity, const QString& description, const QString& line);
+    void logParser(int severity, const QString& description, const QString& file,
+        const QString& line);
+    void logProgram(int severity, const QString& description, const QString& line);
     void logUpdated(int errors, int warnings, int notices, int accepts);
     void updateProjectState(bool modified);
     void handleEditActions();
@@ -56,21 +65,34 @@ private slots:
     void generate();
     void settingsOpen();
     void settingsClose();
+    void drillingCycleChanged(int cycle);
     void layoutReset();
     void showAboutDialog();
     void operationStarted(const QString& operation);
     void operationProgress(int done, int total);
     void operationFinished();
-    void cancelOperation();
 
 private:
     void fileClose();
-    void fileOpen(const QString& fileName);
+    void fileOpen(const QStringList& fileNames);
     bool fileSave(bool final, bool relocate = false);
-    bool fileParse(QFile& file, const QString& extension);
-    void generateDrilling();
-    void generateMilling();
+    bool fileWrite(const QString& fileName, QString& errorString);
+    bool fileParse(const QStringList& fileNames);
+    bool fileAnalyze(QFile& file);
+    void checkDesignRules();
+    DrillingSettings drillingSettings() const;
+    MillingSettings millingSettings() const;
+    MachineSettings machineSettings() const;
+    GeometryTransform geometryTransform() const;
+    Panel panel() const;
+    void updatePreview(bool final);
+    void previewToolpath(const Toolpath& toolpath);
+    QVector<QTransform> previewInstances() const;
+    void logEstimate(const Toolpath& toolpath, const QString& file);
+    void printLog();
+    int compressionOptions() const;
     void setScriptIcon(int icon);
+    void lockFileActions(bool lock);
 
 private:
     enum Script
@@ -95,7 +117,7 @@ private:
 
     QByteArray _defaultState;
 
-    QString _inputFilePath;
+    QStringList _inputFilePaths;
     QString _inputFileName;
     QString _currentFileName;
     QString _currentFilePath;
@@ -103,16 +125,33 @@ private:
 
     LogTableModel _log;
 
-    AbstractParser* _parser;
+    Job _job;
+
+    // One program per operation of the job, empty for a single program
+    QStringList _programs;
+    QStringList _programNames;
 
     ProgressStatusWidget* _progress;
-    bool _operationCanceled;
+
+    bool _headless;
+
+    // The event loop runs while the job is loaded or its program is built, the
+    // actions that replace the job are locked meanwhile
+    QList<QAction*> _lockedActions;
+    bool _busy;
+
+    // The operations and the curves of the next one shown in the preview, it's
+    // updated while parsing
+    bool _parsing;
+    int _previewOperation;
+    int _previewCurves;
+    QElapsedTimer _previewTimer;
 };
 
 
-inline void MainWindow::loadExternalFile(const QString& fileName)
+inline void MainWindow::loadExternalFiles(const QStringList& fileNames)
 {
-    fileOpen(fileName);
+    fileOpen(fileNames);
 }
 
 
@@ -0,0 +1,83 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef MILLPATH_H
+#define MILLPATH_H
+
+
+#include <QVector>
+
+
+// The motion describes the move that arrives at the node, the values match
+// AbstractCurve::Motion. Arcs keep their center.
+class PathNode
+{
+public:
+    enum Motion
+    {
+        MotionLinear = 0,
+        MotionClockwise,
+        MotionCounterClockwise
+    };
+
+    PathNode()
+        : x(0)
+        , y(0)
+        , motion(MotionLinear)
+        , centerX(0)
+        , centerY(0)
+    {
+    }
+
+    PathNode(qint64 nodeX, qint64 nodeY)
+        : x(nodeX)
+        , y(nodeY)
+        , motion(MotionLinear)
+        , centerX(0)
+        , centerY(0)
+    {
+    }
+
+    bool isArc() const { return motion != MotionLinear; }
+
+    qint64 x;
+    qint64 y;
+    int motion;
+    qint64 centerX;
+    qint64 centerY;
+};
+
+
+// A single curve of the milling program. The generator copies the parsed curves
+// into paths, and the milling stages rewrite the nodes before the output.
+class MillPath
+{
+public:
+    MillPath()
+        : line(0)
+    {
+    }
+
+    QVector<PathNode> nodes;
+    int line;
+};
+
+
+#endif // MILLPATH_H
@@ -0,0 +1,81 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "panel.h"
+
+
+void PanelInstance::setRotation(double angle, qint64 centerX, qint64 centerY)
+{
+    _turn = GeometryTransform();
+    _turn.rotation = angle;
+
+    // The offset brings the turned center back to its place
+    qint64 turnedX = centerX;
+    qint64 turnedY = centerY;
+    _turn.apply(&turnedX, &turnedY, 1);
+
+    _turn.offsetX = centerX - turnedX;
+    _turn.offsetY = centerY - turnedY;
+
+    _turned = !_turn.isIdentity();
+}
+
+void PanelInstance::map(qint64& pointX, qint64& pointY) const
+{
+    if (_turned)
+        _turn.apply(&pointX, &pointY, 1);
+
+    pointX += x;
+    pointY += y;
+}
+
+QTransform PanelInstance::matrix() const
+{
+    QTransform move = QTransform::fromTranslate(x / 1000.0, y / 1000.0);
+
+    return _turned ? _turn.matrix() * move : move;
+}
+
+QVector<PanelInstance> Panel::instances() const
+{
+    QVector<PanelInstance> result;
+
+    int columnCount = qMax(1, columns);
+    int rowCount = qMax(1, rows);
+
+    result.reserve(columnCount * rowCount);
+
+    for (int row = 0; row < rowCount; ++row)
+    {
+        for (int i = 0; i < columnCount; ++i)
+        {
+            int column = (row % 2 == 0) ? i : columnCount - 1 - i;
+
+            PanelInstance instance(column * pitchX, row * pitchY);
+
+            if (!alternate || (row + column) % 2 != 0)
+                instance.setRotation(rotation, pitchX / 2, pitchY / 2);
+
+            result.append(instance);
+        }
+    }
+
+    return result;
+}
@@ -0,0 +1,108 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef PANEL_H
+#define PANEL_H
+
+
+#include <QTransform>
+#include <QVector>
+
+#include "geometrytransform.h"
+
+
+// A copy of the board in a panel. The copies only refer to the geometry of the
+// board, the program and the preview place the points one by one as they go.
+class PanelInstance
+{
+public:
+    PanelInstance()
+        : x(0)
+        , y(0)
+        , _turned(false)
+    {
+    }
+
+    PanelInstance(qint64 offsetX, qint64 offsetY)
+        : x(offsetX)
+        , y(offsetY)
+        , _turned(false)
+    {
+    }
+
+    // Turns the copy counterclockwise by the angle in degrees about the point of
+    // the board, before it is moved
+    void setRotation(double angle, qint64 centerX, qint64 centerY);
+
+    // Turns the point of the board and moves it to the copy
+    void map(qint64& pointX, qint64& pointY) const;
+
+    // The same in millimetres
+    QTransform matrix() const;
+
+    // Micrometres
+    qint64 x;
+    qint64 y;
+
+private:
+    // The rotation about the center, exact for the quarter turns
+    GeometryTransform _turn;
+    bool _turned;
+};
+
+
+class Panel
+{
+public:
+    Panel()
+        : columns(1)
+        , rows(1)
+        , pitchX(0)
+        , pitchY(0)
+        , rotation(0.0)
+        , alternate(false)
+    {
+    }
+
+    bool isSingle() const { return columns * rows <= 1; }
+
+    // Places the copies of the board from the lower left corner row by row, every
+    // other row from the right to the left, so the consecutive copies are neighbours
+    QVector<PanelInstance> instances() const;
+
+    int columns;
+    int rows;
+
+    // The distances between the origins of the neighbouring boards, micrometres.
+    // The drilling and the milling files of a board share them, so their panels match.
+    qint64 pitchX;
+    qint64 pitchY;
+
+    // Counterclockwise in degrees. The copies turn about the center of their cell,
+    // the step from the origin of the board, so the turned drilling and milling
+    // files of a board still match.
+    double rotation;
+
+    // Only every other copy is turned, as on a checkerboard
+    bool alternate;
+};
+
+
+#endif // PANEL_H
@@ -0,0 +1,303 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "pathchainer.h"
+
+#include <QHash>
+#include <QPair>
+
+#include <algorithm>
+
+
+namespace
+{
+
+// An edge seen from one of its vertices
+class Link
+{
+public:
+    int edge;
+    int vertex;
+    bool forward;
+};
+
+// A step of the walk: the vertex and the edge that leads to it
+class Step
+{
+public:
+    int vertex;
+    int edge;
+    bool forward;
+};
+
+class Chain
+{
+public:
+    int first;
+    QVector<Step> steps;
+};
+
+bool chainLess(const Chain& a, const Chain& b)
+{
+    return a.first < b.first;
+}
+
+// Hierholzer's algorithm: walks until it gets stuck and splices the detours in
+// on the way back. The steps are collected backwards and reversed at the end.
+void walk(int start, const QVector<int>& offsets, const QVector<Link>& links,
+    QVector<int>& cursors, QVector<bool>& used, QVector<Step>& circuit)
+{
+    QVector<Step> stack;
+
+    Step step;
+    step.vertex = start;
+    step.edge = -1;
+    step.forward = true;
+    stack.append(step);
+
+    while (!stack.isEmpty())
+    {
+        const Step top = stack.last();
+
+        int& cursor = cursors[top.vertex];
+
+        while (cursor < offsets[top.vertex + 1] && used[links[cursor].edge])
+            ++cursor;
+
+        if (cursor < offsets[top.vertex + 1])
+        {
+            const Link& link = links[cursor];
+            used[link.edge] = true;
+
+            step.vertex = link.vertex;
+            step.edge = link.edge;
+            step.forward = link.forward;
+            stack.append(step);
+        }
+        else
+        {
+            stack.removeLast();
+
+            if (top.edge >= 0)
+                circuit.append(top);
+        }
+    }
+
+    std::reverse(circuit.begin(), circuit.end());
+}
+
+} // namespace
+
+
+int PathChainer::chain(QVector<MillPath>& paths)
+{
+    const int edges = paths.size();
+
+    QHash<QPair<qint64, qint64>, int> vertices;
+    QVector<int> from(edges, -1);
+    QVector<int> to(edges, -1);
+
+    for (int i = 0; i < edges; ++i)
+    {
+        const QVector<PathNode>& nodes = paths[i].nodes;
+
+        if (nodes.isEmpty())
+            continue;
+
+        QPair<qint64, qint64> first(nodes.first().x, nodes.first().y);
+        QPair<qint64, qint64> last(nodes.last().x, nodes.last().y);
+
+        from[i] = vertices.value(first, vertices.size());
+        vertices.insert(first, from[i]);
+
+        to[i] = vertices.value(last, vertices.size());
+        vertices.insert(last, to[i]);
+    }
+
+    // The hub is an extra vertex joined to every odd vertex by a virtual edge
+    const int hub = vertices.size();
+
+    QVector<int> degrees(hub + 1, 0);
+
+    for (int i = 0; i < edges; ++i)
+    {
+        if (from[i] < 0)
+            continue;
+
+        ++degrees[from[i]];
+        ++degrees[to[i]];
+    }
+
+    for (int i = 0; i < hub; ++i)
+    {
+        if (degrees[i] % 2 == 0)
+            continue;
+
+        from.append(hub);
+        to.append(i);
+        ++degrees[hub];
+        ++degrees[i];
+    }
+
+    // Adjacency lists of all vertices in a single array
+    QVector<int> offsets(hub + 2, 0);
+
+    for (int i = 0; i <= hub; ++i)
+        offsets[i + 1] = offsets[i] + degrees[i];
+
+    QVector<int> cursors = offsets;
+    QVector<Link> links(offsets[hub + 1]);
+
+    for (int i = 0; i < from.size(); ++i)
+    {
+        if (from[i] < 0)
+            continue;
+
+        Link& out = links[cursors[from[i]]++];
+        out.edge = i;
+        out.vertex = to[i];
+        out.forward = true;
+
+        Link& in = links[cursors[to[i]]++];
+        in.edge = i;
+        in.vertex = from[i];
+        in.forward = (from[i] == to[i]);
+    }
+
+    cursors = offsets;
+
+    QVector<bool> used(from.size(), false);
+    QVector<Chain> chains;
+    QVector<Step> circuit;
+
+    for (int i = -1; i < edges; ++i)
+    {
+        // The components with odd vertices are walked through the hub first
+        if (i < 0 ? degrees[hub] == 0 : (from[i] < 0 || used[i]))
+            continue;
+
+        circuit.clear();
+        walk(i < 0 ? hub : from[i], offsets, links, cursors, used, circuit);
+
+        Chain chain;
+        chain.first = edges;
+
+        for (int j = 0; j <= circuit.size(); ++j)
+        {
+            if (j == circuit.size() || circuit[j].edge >= edges)
+            {
+                if (!chain.steps.isEmpty())
+                {
+                    chains.append(chain);
+                    chain.steps.clear();
+                    chain.first = edges;
+                }
+                continue;
+            }
+
+            chain.steps.append(circuit[j]);
+            chain.first = qMin(chain.first, circuit[j].edge);
+        }
+    }
+
+    std::stable_sort(chains.begin(), chains.end(), chainLess);
+
+    QVector<MillPath> result;
+    result.reserve(chains.size());
+
+    // The empty and the single node paths are dropped, so only the chained ones count
+    int joins = 0;
+
+    for (int i = 0; i < chains.size(); ++i)
+    {
+        QVector<Step>& steps = chains[i].steps;
+        joins += steps.size() - 1;
+
+        // Keep the direction of the earliest path of the chain
+        for (int j = 0; j < steps.size(); ++j)
+        {
+            if (steps[j].edge != chains[i].first)
+                continue;
+
+            if (!steps[j].forward)
+            {
+                std::reverse(steps.begin(), steps.end());
+
+                for (int k = 0; k < steps.size(); ++k)
+                    steps[k].forward = !steps[k].forward;
+            }
+            break;
+        }
+
+        MillPath chain;
+        chain.line = paths[chains[i].first].line;
+
+        for (int j = 0; j < steps.size(); ++j)
+        {
+            MillPath& path = paths[steps[j].edge];
+
+            if (!steps[j].forward)
+                reverse(path);
+
+            if (j == 0)
+                chain.nodes = path.nodes;
+            else
+                chain.nodes += path.nodes.mid(1);
+        }
+
+        result.append(chain);
+    }
+
+    paths.swap(result);
+
+    return joins;
+}
+
+void PathChainer::reverse(MillPath& path)
+{
+    const QVector<PathNode>& nodes = path.nodes;
+    const int count = nodes.size();
+
+    QVector<PathNode> reversed(count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        PathNode& node = reversed[i];
+
+        node.x = nodes[count - 1 - i].x;
+        node.y = nodes[count - 1 - i].y;
+
+        if (i == 0)
+            continue;
+
+        // The move into this node is the original move out of it, run backwards
+        const PathNode& move = nodes[count - i];
+
+        node.centerX = move.centerX;
+        node.centerY = move.centerY;
+
+        if (move.motion == PathNode::MotionClockwise)
+            node.motion = PathNode::MotionCounterClockwise;
+        else if (move.motion == PathNode::MotionCounterClockwise)
+            node.motion = PathNode::MotionClockwise;
+    }
+
+    path.nodes.swap(reversed);
+}
@@ -0,0 +1,45 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef PATHCHAINER_H
+#define PATHCHAINER_H
+
+
+#include <QVector>
+
+#include "millpath.h"
+
+
+class PathChainer
+{
+public:
+    // Joins the paths whose ends meet exactly into continuous chains, reversing them
+    // where necessary, so that every chain is milled with a single plunge. The paths
+    // are the edges of a graph between their end points; pairing the odd vertices
+    // makes every component Eulerian, and cutting the circuits at the added edges
+    // gives the least possible number of chains. Returns the number of joins.
+    static int chain(QVector<MillPath>& paths);
+
+private:
+    static void reverse(MillPath& path);
+};
+
+
+#endif // PATHCHAINER_H
@@ -0,0 +1,318 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "pathsimplifier.h"
+
+#include <QPair>
+#include <QtConcurrent>
+#include <QtMath>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+
+
+namespace
+{
+
+// Squared distance from the point to the segment [a, b]
+double distanceSquared(const PathNode& point, const PathNode& a, const PathNode& b)
+{
+    double dx = static_cast<double>(b.x - a.x);
+    double dy = static_cast<double>(b.y - a.y);
+    double px = static_cast<double>(point.x - a.x);
+    double py = static_cast<double>(point.y - a.y);
+
+    double length = dx * dx + dy * dy;
+
+    if (length > 0.0)
+    {
+        double t = (px * dx + py * dy) / length;
+
+        if (t >= 1.0)
+        {
+            px -= dx;
+            py -= dy;
+        }
+        else if (t > 0.0)
+        {
+            px -= t * dx;
+            py -= t * dy;
+        }
+    }
+
+    return px * px + py * py;
+}
+
+// A node of the bottom-up reduction waiting for removal, the cheapest one first
+class Removal
+{
+public:
+    double cost;
+    int node;
+    int version;
+
+    bool operator>(const Removal& other) const
+    {
+        return cost > other.cost || (cost == other.cost && node > other.node);
+    }
+};
+
+} // namespace
+
+
+void PathSimplifier::simplify(MillPath& path, qint64 tolerance)
+{
+    removeCollinear(path.nodes);
+
+    if (tolerance > 0)
+        reduce(path.nodes, tolerance);
+}
+
+int PathSimplifier::simplify(QVector<MillPath>& paths, qint64 tolerance)
+{
+    int before = 0;
+
+    for (int i = 0; i < paths.size(); ++i)
+        before += paths[i].nodes.size();
+
+    QtConcurrent::blockingMap(paths, [tolerance](MillPath& path)
+    {
+        simplify(path, tolerance);
+    });
+
+    int after = 0;
+
+    for (int i = 0; i < paths.size(); ++i)
+        after += paths[i].nodes.size();
+
+    return before - after;
+}
+
+void PathSimplifier::removeCollinear(QVector<PathNode>& nodes)
+{
+    int count = 0;
+
+    for (int i = 0; i < nodes.size(); ++i)
+    {
+        const PathNode& node = nodes[i];
+
+        // Zero-length segment
+        if (count > 0 && !node.isArc() && node.x == nodes[count - 1].x &&
+            node.y == nodes[count - 1].y)
+        {
+            continue;
+        }
+
+        // The previous node lies on the segment from its predecessor to this node.
+        // Integer arithmetic keeps the test exact. Arcs are never merged.
+        if (count > 1 && !node.isArc() && !nodes[count - 1].isArc())
+        {
+            const PathNode& a = nodes[count - 2];
+            const PathNode& b = nodes[count - 1];
+
+            qint64 abX = b.x - a.x;
+            qint64 abY = b.y - a.y;
+            qint64 bcX = node.x - b.x;
+            qint64 bcY = node.y - b.y;
+
+            if (abX * bcY == abY * bcX && abX * bcX + abY * bcY > 0)
+                --count;
+        }
+
+        nodes[count++] = node;
+    }
+
+    nodes.resize(count);
+}
+
+void PathSimplifier::reduce(QVector<PathNode>& nodes, qint64 tolerance)
+{
+    if (nodes.size() < 3)
+        return;
+
+    double limit = static_cast<double>(tolerance) * static_cast<double>(tolerance);
+
+    QVector<bool> keep(nodes.size(), false);
+    keep[0] = true;
+    keep[nodes.size() - 1] = true;
+
+    // Explicit stack of the ranges still to be split
+    QVector<QPair<int, int> > ranges;
+
+    // Arcs and their start nodes are fixed, only the linear runs between them are reduced
+    int first = 0;
+
+    for (int i = 1; i < nodes.size(); ++i)
+    {
+        if (nodes[i].isArc())
+        {
+            keep[i - 1] = true;
+            keep[i] = true;
+
+            if (i - 1 - first > 1)
+                ranges.append(qMakePair(first, i - 1));
+
+            first = i;
+        }
+    }
+
+    if (nodes.size() - 1 - first > 1)
+        ranges.append(qMakePair(first, nodes.size() - 1));
+
+    // Every split scans its whole range, which is O(n^2) when the splits peel single
+    // nodes off. As in introsort, the splitting stops once the scans reach O(n log n)
+    // and the ranges left are reduced bottom-up in O(n log n).
+    qint64 budget = 4 * static_cast<qint64>(nodes.size()) *
+        (qCeil(std::log2(static_cast<double>(nodes.size()))) + 1);
+
+    while (!ranges.isEmpty())
+    {
+        QPair<int, int> range = ranges.last();
+        ranges.removeLast();
+
+        if (budget < 0)
+        {
+            reduceBottomUp(nodes, range.first, range.second, tolerance, keep);
+            continue;
+        }
+
+        budget -= range.second - range.first;
+
+        double farthest = limit;
+        int split = -1;
+
+        for (int i = range.first + 1; i < range.second; ++i)
+        {
+            double distance = distanceSquared(nodes[i], nodes[range.first], nodes[range.second]);
+
+            if (distance > farthest)
+            {
+                farthest = distance;
+                split = i;
+            }
+        }
+
+        if (split < 0)
+            continue;
+
+        keep[split] = true;
+
+        if (split - range.first > 1)
+            ranges.append(qMakePair(range.first, split));
+
+        if (range.second - split > 1)
+            ranges.append(qMakePair(split, range.second));
+    }
+
+    int count = 0;
+
+    for (int i = 0; i < nodes.size(); ++i)
+    {
+        if (keep[i])
+            nodes[count++] = nodes[i];
+    }
+
+    nodes.resize(count);
+}
+
+void PathSimplifier::reduceBottomUp(const QVector<PathNode>& nodes, int first, int last,
+    qint64 tolerance, QVector<bool>& keep)
+{
+    const int count = last - first + 1;
+
+    QVector<int> previous(count);
+    QVector<int> next(count);
+    QVector<int> versions(count, 0);
+
+    // The removed nodes between a node and the next one lie within this distance
+    // of the segment between them
+    QVector<double> deviations(count, 0.0);
+
+    for (int i = 0; i < count; ++i)
+    {
+        previous[i] = i - 1;
+        next[i] = i + 1;
+    }
+
+    // A removal moves the nodes replaced before by both segments at most by the
+    // distance of the removed node from the new segment
+    auto cost = [&](int i) -> double
+    {
+        return qMax(deviations[previous[i]], deviations[i]) + qSqrt(distanceSquared(
+            nodes[first + i], nodes[first + previous[i]], nodes[first + next[i]]));
+    };
+
+    QVector<Removal> heap;
+    heap.reserve(count);
+
+    for (int i = 1; i < count - 1; ++i)
+    {
+        Removal removal = { cost(i), i, 0 };
+        heap.append(removal);
+    }
+
+    std::greater<Removal> later;
+    std::make_heap(heap.begin(), heap.end(), later);
+
+    QVector<bool> removed(count, false);
+
+    while (!heap.isEmpty())
+    {
+        std::pop_heap(heap.begin(), heap.end(), later);
+        Removal removal = heap.last();
+        heap.removeLast();
+
+        int i = removal.node;
+
+        // Stale entries of the nodes whose neighbours have changed
+        if (removed[i] || removal.version != versions[i])
+            continue;
+
+        if (removal.cost > static_cast<double>(tolerance))
+            break;
+
+        removed[i] = true;
+
+        int before = previous[i];
+        int after = next[i];
+
+        next[before] = after;
+        previous[after] = before;
+        deviations[before] = removal.cost;
+
+        if (before > 0)
+        {
+            Removal update = { cost(before), before, ++versions[before] };
+            heap.append(update);
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+
+        if (after < count - 1)
+        {
+            Removal update = { cost(after), after, ++versions[after] };
+            heap.append(update);
+            std::push_heap(heap.begin(), heap.end(), later);
+        }
+    }
+
+    for (int i = 1; i < count - 1; ++i)
+        keep[first + i] = !removed[i];
+}
@@ -0,0 +1,55 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef PATHSIMPLIFIER_H
+#define PATHSIMPLIFIER_H
+
+
+#include <QVector>
+
+#include "millpath.h"
+
+
+class PathSimplifier
+{
+public:
+    // Removes zero-length segments and collinear nodes, then runs Douglas-Peucker
+    // with the tolerance (in micrometres). Every removed node stays within the
+    // tolerance of the segment that replaces it, so the path never deviates more.
+    // Arc nodes and the nodes where the arcs start are kept.
+    // The splitting stops after O(n log n) work and the rest is reduced bottom-up,
+    // so the worst case stays O(n log n).
+    static void simplify(MillPath& path, qint64 tolerance);
+
+    // Simplifies the paths in parallel and returns the number of removed nodes
+    static int simplify(QVector<MillPath>& paths, qint64 tolerance);
+
+private:
+    static void removeCollinear(QVector<PathNode>& nodes);
+    static void reduce(QVector<PathNode>& nodes, qint64 tolerance);
+
+    // Removes the cheapest inner nodes of the range first while the bound of the
+    // deviation allows, marking the nodes left in keep
+    static void reduceBottomUp(const QVector<PathNode>& nodes, int first, int last,
+        qint64 tolerance, QVector<bool>& keep);
+};
+
+
+#endif // PATHSIMPLIFIER_H
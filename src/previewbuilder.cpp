@@ -0,0 +1,187 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "previewbuilder.h"
+
+#include <QtMath>
+
+#include "abstractparser.h"
+#include "toolpath.h"
+
+
+namespace
+{
+
+// Enough for a smooth circle at any zoom level that matters for a check
+const int SegmentsPerTurn = 72;
+
+const double Micrometre = 0.001;
+
+} // namespace
+
+
+void PreviewBuilder::appendCurves(const AbstractParser& parser, int first, int last,
+    QVector<PreviewItem>& items)
+{
+    const QList<AbstractCurve>& curves = parser.curves();
+
+    last = qMin(last, curves.size());
+
+    for (int i = qMax(first, 0); i < last; ++i)
+        appendCurve(curves[i], parser.tools(), 0, 0, items);
+}
+
+void PreviewBuilder::appendRepeats(const AbstractParser& parser, int first, int last,
+    QVector<PreviewItem>& items)
+{
+    const QList<AbstractCurve>& curves = parser.curves();
+    const QVector<CurveRepeat>& repeats = parser.repeats();
+
+    last = qMin(last, repeats.size());
+
+    for (int i = qMax(first, 0); i < last; ++i)
+    {
+        const CurveRepeat& repeat = repeats[i];
+
+        for (int k = 1; k <= repeat.count; ++k)
+        {
+            for (int j = qMax(repeat.first, 0); j < qMin(repeat.last, curves.size()); ++j)
+                appendCurve(curves[j], parser.tools(), repeat.x * k, repeat.y * k, items);
+        }
+    }
+}
+
+void PreviewBuilder::appendToolpath(const Toolpath& toolpath, QVector<PreviewItem>& items)
+{
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+
+    foreach (const ToolpathMove& move, toolpath.moves)
+    {
+        bool lateral = (move.x != x || move.y != y);
+
+        if (move.type == ToolpathMove::TypeRapid)
+        {
+            if (lateral)
+                items.append(PreviewItem(PreviewItem::KindRapid, move.tool, x, y, move.x, move.y));
+        }
+        else if (move.isArc())
+        {
+            appendArc(PreviewItem::KindCut, move.tool, x, y, move.x, move.y,
+                move.centerX, move.centerY, move.type == ToolpathMove::TypeClockwise, items);
+        }
+        else if (lateral)
+        {
+            items.append(PreviewItem(PreviewItem::KindCut, move.tool, x, y, move.x, move.y));
+        }
+        else if (move.z < z)
+        {
+            // The pecks of one hole give a single mark
+            bool repeated = !items.isEmpty() && items.last().kind == PreviewItem::KindHole &&
+                items.last().x1 == static_cast<float>(x) && items.last().y1 == static_cast<float>(y);
+
+            if (!repeated)
+                items.append(PreviewItem::hole(move.tool, x, y, 0.0f));
+        }
+
+        x = move.x;
+        y = move.y;
+        z = move.z;
+    }
+}
+
+void PreviewBuilder::appendCurve(const AbstractCurve& curve, const ToolTable& tools,
+    qint64 shiftX, qint64 shiftY, QVector<PreviewItem>& items)
+{
+    if (curve.count() < 1)
+        return;
+
+    const qint64* x = curve.x();
+    const qint64* y = curve.y();
+
+    if (curve.type() == AbstractCurve::CurveTypePoint)
+    {
+        items.append(PreviewItem::hole(curve.tool(), (x[0] + shiftX) * Micrometre,
+            (y[0] + shiftY) * Micrometre, tools[curve.tool()].diameter() * Micrometre));
+    }
+    else if (curve.type() == AbstractCurve::CurveTypeCurve)
+    {
+        for (int j = 1; j < curve.count(); ++j)
+        {
+            int motion = curve.motion(j);
+
+            if (motion == AbstractCurve::MotionLinear)
+            {
+                items.append(PreviewItem(PreviewItem::KindCut, curve.tool(),
+                    (x[j - 1] + shiftX) * Micrometre, (y[j - 1] + shiftY) * Micrometre,
+                    (x[j] + shiftX) * Micrometre, (y[j] + shiftY) * Micrometre));
+            }
+            else
+            {
+                appendArc(PreviewItem::KindCut, curve.tool(),
+                    (x[j - 1] + shiftX) * Micrometre, (y[j - 1] + shiftY) * Micrometre,
+                    (x[j] + shiftX) * Micrometre, (y[j] + shiftY) * Micrometre,
+                    (curve.centerX(j) + shiftX) * Micrometre,
+                    (curve.centerY(j) + shiftY) * Micrometre,
+                    motion == AbstractCurve::MotionClockwise, items);
+            }
+        }
+    }
+}
+
+void PreviewBuilder::appendArc(int kind, int tool, double fromX, double fromY, double toX,
+    double toY, double centerX, double centerY, bool clockwise, QVector<PreviewItem>& items)
+{
+    double radius = qSqrt((fromX - centerX) * (fromX - centerX) +
+        (fromY - centerY) * (fromY - centerY));
+
+    double start = qAtan2(fromY - centerY, fromX - centerX);
+    double sweep = qAtan2(toY - centerY, toX - centerX) - start;
+
+    if (clockwise && sweep >= 0.0)
+        sweep -= 2.0 * M_PI;
+    else if (!clockwise && sweep <= 0.0)
+        sweep += 2.0 * M_PI;
+
+    int count = qMax(1, qCeil(qAbs(sweep) * SegmentsPerTurn / (2.0 * M_PI)));
+
+    double lastX = fromX;
+    double lastY = fromY;
+
+    for (int i = 1; i <= count; ++i)
+    {
+        double nextX = toX;
+        double nextY = toY;
+
+        if (i < count)
+        {
+            double angle = start + sweep * i / count;
+
+            nextX = centerX + radius * qCos(angle);
+            nextY = centerY + radius * qSin(angle);
+        }
+
+        items.append(PreviewItem(kind, tool, lastX, lastY, nextX, nextY));
+
+        lastX = nextX;
+        lastY = nextY;
+    }
+}
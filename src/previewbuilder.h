@@ -0,0 +1,61 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef PREVIEWBUILDER_H
+#define PREVIEWBUILDER_H
+
+
+#include <QVector>
+
+#include "previewscene.h"
+
+
+class AbstractCurve;
+class AbstractParser;
+class ToolTable;
+class Toolpath;
+
+
+// Turns the parsed geometry and the toolpaths into the preview items, the arcs
+// become chains of lines
+class PreviewBuilder
+{
+public:
+    // Appends the curves [first, last) of the parser
+    static void appendCurves(const AbstractParser& parser, int first, int last,
+        QVector<PreviewItem>& items);
+
+    // Appends the copies of the repeats [first, last) of the parser
+    static void appendRepeats(const AbstractParser& parser, int first, int last,
+        QVector<PreviewItem>& items);
+
+    // Appends the moves in the XY plane, a vertical feed move down becomes a hole
+    static void appendToolpath(const Toolpath& toolpath, QVector<PreviewItem>& items);
+
+private:
+    static void appendCurve(const AbstractCurve& curve, const ToolTable& tools, qint64 shiftX,
+        qint64 shiftY, QVector<PreviewItem>& items);
+    static void appendArc(int kind, int tool, double fromX, double fromY, double toX,
+        double toY, double centerX, double centerY, bool clockwise,
+        QVector<PreviewItem>& items);
+};
+
+
+#endif // PREVIEWBUILDER_H
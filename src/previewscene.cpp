@@ -0,0 +1,466 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "previewscene.h"
+
+#include <QPainter>
+
+
+namespace
+{
+
+// A node with fewer items is not split
+const int LeafItems = 32;
+const int MaximumDepth = 24;
+
+// A subtree smaller than that is drawn as one block, pixels
+const double DetailPixels = 2.0;
+
+// The smallest radius of a hole on the screen, pixels
+const double HoleRadius = 1.5;
+
+const int PaletteSize = 8;
+
+const QRgb Palette[PaletteSize] =
+{
+    0xd62728, 0x2ca02c, 0x9467bd, 0xff7f0e, 0x17becf, 0x8c564b, 0xe377c2, 0xbcbd22
+};
+
+const QRgb RapidColor = 0xb4b4b4;
+const QRgb CutColor = 0x1f5fbf;
+
+
+class Task
+{
+public:
+    Task()
+        : node(0)
+        , left(0.0f)
+        , bottom(0.0f)
+        , size(0.0f)
+        , begin(0)
+        , end(0)
+        , depth(0)
+    {
+    }
+
+    int node;
+    float left;
+    float bottom;
+    float size;
+    int begin;
+    int end;
+    int depth;
+};
+
+// Returns the quadrant (0 - south west, 1 - south east, 2 - north west,
+// 3 - north east) of the item centre, or -1 for the items larger than a quarter
+// of the node. The quadrants are loose: an item sticks out of its quadrant by a
+// half of the quadrant at most, the bounds of the nodes take that into account.
+inline int quadrantOf(const PreviewItem& item, float middleX, float middleY, float half)
+{
+    float width = item.right() - item.left();
+    float height = item.top() - item.bottom();
+
+    if (width > half / 2.0f || height > half / 2.0f)
+        return -1;
+
+    int quadrant = 0;
+
+    if ((item.left() + item.right()) / 2.0f >= middleX)
+        quadrant |= 1;
+
+    if ((item.bottom() + item.top()) / 2.0f >= middleY)
+        quadrant |= 2;
+
+    return quadrant;
+}
+
+// Tells whether the line misses the rectangle that its bounding box overlaps
+inline bool missesArea(const PreviewItem& item, double left, double bottom, double right,
+    double top)
+{
+    double dx = item.x2 - item.x1;
+    double dy = item.y2 - item.y1;
+
+    // All the corners of the rectangle lie on the same side of the line
+    double a = dx * (bottom - item.y1) - dy * (left - item.x1);
+    double b = dx * (bottom - item.y1) - dy * (right - item.x1);
+    double c = dx * (top - item.y1) - dy * (left - item.x1);
+    double d = dx * (top - item.y1) - dy * (right - item.x1);
+
+    return (a > 0.0 && b > 0.0 && c > 0.0 && d > 0.0) ||
+        (a < 0.0 && b < 0.0 && c < 0.0 && d < 0.0);
+}
+
+inline QRgb colorOf(int kind, int tool)
+{
+    switch (kind)
+    {
+    case PreviewItem::KindHole:
+        return PreviewScene::toolColor(tool).rgb();
+    case PreviewItem::KindCut:
+        return CutColor;
+    default:
+        return RapidColor;
+    }
+}
+
+} // namespace
+
+
+PreviewScene::PreviewScene(const QVector<PreviewItem>& items,
+    const QVector<QTransform>& instances)
+    : _items(items)
+    , _instances(instances)
+{
+    build();
+
+    if (_items.isEmpty() || _instances.isEmpty())
+        return;
+
+    QRectF bounds = _instances[0].mapRect(_bounds);
+
+    for (int i = 1; i < _instances.size(); ++i)
+        bounds = bounds.united(_instances[i].mapRect(_bounds));
+
+    _bounds = bounds;
+}
+
+QColor PreviewScene::toolColor(int tool)
+{
+    return QColor(Palette[qAbs(tool) % PaletteSize]);
+}
+
+void PreviewScene::build()
+{
+    if (_items.isEmpty())
+        return;
+
+    float left = _items[0].left();
+    float bottom = _items[0].bottom();
+    float right = _items[0].right();
+    float top = _items[0].top();
+
+    foreach (const PreviewItem& item, _items)
+    {
+        left = qMin(left, item.left());
+        bottom = qMin(bottom, item.bottom());
+        right = qMax(right, item.right());
+        top = qMax(top, item.top());
+    }
+
+    _bounds = QRectF(left, bottom, right - left, top - bottom);
+
+    QVector<int> order(_items.size());
+    QVector<int> buffer(_items.size());
+    QVector<signed char> quadrants(_items.size());
+
+    for (int i = 0; i < order.size(); ++i)
+        order[i] = i;
+
+    Task root;
+    root.left = left;
+    root.bottom = bottom;
+    root.size = qMax(qMax(right - left, top - bottom), 0.001f);
+    root.end = _items.size();
+
+    _nodes.append(Node());
+
+    QVector<Task> tasks;
+    tasks.append(root);
+
+    while (!tasks.isEmpty())
+    {
+        Task task = tasks.last();
+        tasks.removeLast();
+
+        _nodes[task.node].begin = task.begin;
+        _nodes[task.node].end = task.end;
+
+        if (task.end - task.begin <= LeafItems || task.depth >= MaximumDepth)
+            continue;
+
+        float half = task.size / 2.0f;
+        float middleX = task.left + half;
+        float middleY = task.bottom + half;
+
+        // The large items stay in the node, the rest are distributed into the
+        // quadrants keeping their order
+        int counts[5] = {};
+
+        for (int i = task.begin; i < task.end; ++i)
+        {
+            quadrants[i] = static_cast<signed char>(
+                quadrantOf(_items[order[i]], middleX, middleY, half) + 1);
+
+            ++counts[quadrants[i]];
+        }
+
+        if (counts[0] == task.end - task.begin)
+            continue;
+
+        int offsets[5];
+        offsets[0] = task.begin;
+
+        for (int i = 1; i < 5; ++i)
+            offsets[i] = offsets[i - 1] + counts[i - 1];
+
+        int position[5];
+
+        for (int i = 0; i < 5; ++i)
+            position[i] = offsets[i];
+
+        for (int i = task.begin; i < task.end; ++i)
+            buffer[position[quadrants[i]]++] = order[i];
+
+        for (int i = task.begin; i < task.end; ++i)
+            order[i] = buffer[i];
+
+        _nodes[task.node].end = task.begin + counts[0];
+
+        int firstChild = _nodes.size();
+        _nodes[task.node].firstChild = firstChild;
+        _nodes.resize(firstChild + 4);
+
+        for (int i = 0; i < 4; ++i)
+        {
+            Task child;
+            child.node = firstChild + i;
+            child.left = task.left + ((i & 1) ? half : 0.0f);
+            child.bottom = task.bottom + ((i & 2) ? half : 0.0f);
+            child.size = half;
+            child.begin = offsets[i + 1];
+            child.end = offsets[i + 1] + counts[i + 1];
+            child.depth = task.depth + 1;
+
+            tasks.append(child);
+        }
+    }
+
+    QVector<PreviewItem> items(_items.size());
+
+    for (int i = 0; i < order.size(); ++i)
+        items[i] = _items[order[i]];
+
+    _items = items;
+
+    // The children always follow their parent, so a backward pass sees every child
+    // before its parent
+    for (int i = _nodes.size() - 1; i >= 0; --i)
+    {
+        Node& node = _nodes[i];
+
+        for (int j = node.begin; j < node.end; ++j)
+        {
+            const PreviewItem& item = _items[j];
+
+            if (node.count == 0)
+            {
+                node.left = item.left();
+                node.bottom = item.bottom();
+                node.right = item.right();
+                node.top = item.top();
+            }
+            else
+            {
+                node.left = qMin(node.left, item.left());
+                node.bottom = qMin(node.bottom, item.bottom());
+                node.right = qMax(node.right, item.right());
+                node.top = qMax(node.top, item.top());
+            }
+
+            if (node.count == 0 || item.kind > node.kind)
+            {
+                node.kind = item.kind;
+                node.tool = item.tool;
+            }
+
+            ++node.count;
+        }
+
+        if (node.firstChild < 0)
+            continue;
+
+        for (int j = node.firstChild; j < node.firstChild + 4; ++j)
+        {
+            const Node& child = _nodes[j];
+
+            if (child.count == 0)
+                continue;
+
+            if (node.count == 0)
+            {
+                node.left = child.left;
+                node.bottom = child.bottom;
+                node.right = child.right;
+                node.top = child.top;
+            }
+            else
+            {
+                node.left = qMin(node.left, child.left);
+                node.bottom = qMin(node.bottom, child.bottom);
+                node.right = qMax(node.right, child.right);
+                node.top = qMax(node.top, child.top);
+            }
+
+            if (node.count == 0 || child.kind > node.kind)
+            {
+                node.kind = child.kind;
+                node.tool = child.tool;
+            }
+
+            node.count += child.count;
+        }
+    }
+}
+
+void PreviewScene::render(QPainter& painter, const QRectF& area, double scale) const
+{
+    if (_items.isEmpty() || scale <= 0.0)
+        return;
+
+    if (_instances.isEmpty())
+    {
+        renderItems(painter, area, scale);
+        return;
+    }
+
+    // An instance draws the items with the painter turned and moved to its place,
+    // the area mapped back selects the items, the invisible instances stop at the root
+    QTransform pixels(scale, 0.0, 0.0, -scale, 0.0, 0.0);
+    QTransform millimetres = pixels.inverted();
+
+    foreach (const QTransform& instance, _instances)
+    {
+        QTransform placement = millimetres * instance * pixels;
+        QRectF itemArea = placement.inverted().mapRect(area);
+
+        painter.save();
+        painter.setTransform(QTransform::fromTranslate(itemArea.left(), itemArea.top()) *
+            placement * QTransform::fromTranslate(-area.left(), -area.top()), true);
+
+        renderItems(painter, itemArea, scale);
+
+        painter.restore();
+    }
+}
+
+void PreviewScene::renderItems(QPainter& painter, const QRectF& area, double scale) const
+{
+
+    // The visible part of the scene in millimetres, a few pixels wider for the holes
+    // and the line widths
+    double margin = HoleRadius + 1.0;
+    double left = (area.left() - margin) / scale;
+    double right = (area.right() + margin) / scale;
+    double bottom = -(area.bottom() + margin) / scale;
+    double top = -(area.top() - margin) / scale;
+
+    double offsetX = area.left();
+    double offsetY = area.top();
+
+    QVector<QLineF> rapids;
+    QVector<QLineF> cuts;
+    QVector<QRectF> holes[PaletteSize];
+
+    QVector<int> stack;
+    stack.append(0);
+
+    painter.setPen(Qt::NoPen);
+
+    while (!stack.isEmpty())
+    {
+        const Node& node = _nodes[stack.last()];
+        stack.removeLast();
+
+        if (node.count == 0 || node.right < left || node.left > right ||
+            node.top < bottom || node.bottom > top)
+        {
+            continue;
+        }
+
+        double width = (node.right - node.left) * scale;
+        double height = (node.top - node.bottom) * scale;
+
+        if (node.count > 1 && width < DetailPixels && height < DetailPixels)
+        {
+            QRectF block(node.left * scale - offsetX, -node.top * scale - offsetY,
+                qMax(width, 1.0), qMax(height, 1.0));
+
+            painter.fillRect(block, QColor(colorOf(node.kind, node.tool)));
+            continue;
+        }
+
+        for (int i = node.begin; i < node.end; ++i)
+        {
+            const PreviewItem& item = _items[i];
+
+            if (item.right() < left || item.left() > right ||
+                item.top() < bottom || item.bottom() > top)
+            {
+                continue;
+            }
+
+            if (item.kind == PreviewItem::KindHole)
+            {
+                double radius = qMax(item.x2 * scale / 2.0, HoleRadius);
+
+                holes[qAbs(item.tool) % PaletteSize].append(QRectF(
+                    item.x1 * scale - offsetX - radius, -item.y1 * scale - offsetY - radius,
+                    radius * 2.0, radius * 2.0));
+            }
+            else if (!missesArea(item, left, bottom, right, top))
+            {
+                QLineF line(item.x1 * scale - offsetX, -item.y1 * scale - offsetY,
+                    item.x2 * scale - offsetX, -item.y2 * scale - offsetY);
+
+                if (item.kind == PreviewItem::KindCut)
+                    cuts.append(line);
+                else
+                    rapids.append(line);
+            }
+        }
+
+        if (node.firstChild >= 0)
+        {
+            for (int i = node.firstChild; i < node.firstChild + 4; ++i)
+                stack.append(i);
+        }
+    }
+
+    painter.setBrush(Qt::NoBrush);
+
+    painter.setPen(QPen(QColor(RapidColor), 0.0));
+    painter.drawLines(rapids);
+
+    painter.setPen(QPen(QColor(CutColor), 1.5));
+    painter.drawLines(cuts);
+
+    painter.setPen(Qt::NoPen);
+
+    for (int i = 0; i < PaletteSize; ++i)
+    {
+        painter.setBrush(QColor(Palette[i]));
+
+        foreach (const QRectF& hole, holes[i])
+            painter.drawEllipse(hole);
+    }
+}
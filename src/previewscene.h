@@ -0,0 +1,160 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef PREVIEWSCENE_H
+#define PREVIEWSCENE_H
+
+
+#include <QColor>
+#include <QRectF>
+#include <QTransform>
+#include <QVector>
+
+
+class QPainter;
+
+
+// A primitive of the preview in millimetres. Rapid moves and cuts are lines from
+// (x1, y1) to (x2, y2), a hole is a circle around (x1, y1) with the diameter x2.
+class PreviewItem
+{
+public:
+    enum Kind
+    {
+        KindRapid = 0,
+        KindCut,
+        KindHole
+    };
+
+    PreviewItem()
+        : kind(KindRapid)
+        , tool(0)
+        , x1(0.0f)
+        , y1(0.0f)
+        , x2(0.0f)
+        , y2(0.0f)
+    {
+    }
+
+    PreviewItem(int itemKind, int itemTool, float fromX, float fromY, float toX, float toY)
+        : kind(itemKind)
+        , tool(itemTool)
+        , x1(fromX)
+        , y1(fromY)
+        , x2(toX)
+        , y2(toY)
+    {
+    }
+
+    static PreviewItem hole(int tool, float x, float y, float diameter)
+    {
+        return PreviewItem(KindHole, tool, x, y, diameter, 0.0f);
+    }
+
+    float left() const { return (kind == KindHole) ? x1 - x2 / 2.0f : qMin(x1, x2); }
+    float right() const { return (kind == KindHole) ? x1 + x2 / 2.0f : qMax(x1, x2); }
+    float bottom() const { return (kind == KindHole) ? y1 - x2 / 2.0f : qMin(y1, y2); }
+    float top() const { return (kind == KindHole) ? y1 + x2 / 2.0f : qMax(y1, y2); }
+
+    int kind;
+    int tool;
+    float x1;
+    float y1;
+    float x2;
+    float y2;
+};
+
+
+// An immutable set of the preview items indexed by a loose quadtree. An item goes
+// down to the quadrant of its centre while it's small for the quadrant, every node
+// knows the bounds of its subtree. Drawing skips the quadrants out of
+// the area and draws a quadrant smaller than a couple of pixels as one block of the
+// colour of its most important item, so the cost depends on the number of pixels
+// rather than on the number of items. The scene may be drawn from many threads.
+// The instances repeat the items in the other places (in millimetres), a panel of
+// boards is drawn from the tree of one board.
+class PreviewScene
+{
+public:
+    explicit PreviewScene(const QVector<PreviewItem>& items,
+        const QVector<QTransform>& instances = QVector<QTransform>());
+
+    bool isEmpty() const { return _items.isEmpty(); }
+    int size() const { return _items.size(); }
+    int instances() const { return _instances.size(); }
+
+    // In millimetres, the Y axis points up
+    QRectF bounds() const { return _bounds; }
+
+    // Draws the scene with the scale in pixels per millimetre. The area is given in
+    // the pixels of the whole scene: the pixel (x * scale, -y * scale) shows the
+    // point (x, y), and the top left corner of the area is at the painter origin.
+    void render(QPainter& painter, const QRectF& area, double scale) const;
+
+    static QColor toolColor(int tool);
+
+private:
+    class Node
+    {
+    public:
+        Node()
+            : left(0.0f)
+            , bottom(0.0f)
+            , right(0.0f)
+            , top(0.0f)
+            , firstChild(-1)
+            , begin(0)
+            , end(0)
+            , count(0)
+            , kind(PreviewItem::KindRapid)
+            , tool(0)
+        {
+        }
+
+        // The bounds of all the items of the subtree
+        float left;
+        float bottom;
+        float right;
+        float top;
+
+        // The four children are stored together
+        int firstChild;
+
+        // The items of the node itself
+        int begin;
+        int end;
+
+        // The items of the subtree, the most important kind and its tool
+        int count;
+        int kind;
+        int tool;
+    };
+
+    void build();
+    void renderItems(QPainter& painter, const QRectF& area, double scale) const;
+
+    QVector<PreviewItem> _items;
+    QVector<QTransform> _instances;
+    QVector<Node> _nodes;
+    QRectF _bounds;
+};
+
+
+#endif // PREVIEWSCENE_H
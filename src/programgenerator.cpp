@@ -0,0 +1,1239 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "programgenerator.h"
+
+#include <QtMath>
+
+#include "abstractparser.h"
+#include "arcfitter.h"
+#include "gcodetemplate.h"
+#include "gcodecompressor.h"
+#include "gcodewriter.h"
+#include "holededuplication.h"
+#include "pathchainer.h"
+#include "pathsimplifier.h"
+#include "toolgrouping.h"
+#include "utilities.h"
+
+#include <algorithm>
+#include <cmath>
+
+
+namespace
+{
+
+// Drills the holes of a panel without copying them: every run of the hits of the
+// same tool goes through all the boards before the next run, so the panel needs no
+// more tool changes than one board. Every other board takes the run backwards and
+// the next run starts on the board where the previous one ended, so the moves
+// between the boards are short.
+class PanelWalk
+{
+public:
+    PanelWalk(const QVector<DrillHit>& hits, const QVector<PanelInstance>& instances)
+        : _hits(hits)
+        , _instances(instances)
+    {
+        int steps = 0;
+
+        for (int i = 0; i < hits.size(); ++i)
+        {
+            if (i == 0 || hits[i].tool != hits[i - 1].tool)
+            {
+                _runs.append(i);
+                _steps.append(steps);
+            }
+
+            steps += instances.size();
+        }
+
+        _runs.append(hits.size());
+        _steps.append(steps);
+    }
+
+    int size() const { return _steps.last(); }
+
+    DrillHit at(int step) const
+    {
+        int run = static_cast<int>(std::upper_bound(_steps.constBegin(), _steps.constEnd(),
+            step) - _steps.constBegin()) - 1;
+
+        int length = _runs[run + 1] - _runs[run];
+        int visit = (step - _steps[run]) / length;
+        int index = (step - _steps[run]) % length;
+
+        int board = (run % 2 == 0) ? visit : _instances.size() - 1 - visit;
+
+        if (visit % 2 != 0)
+            index = length - 1 - index;
+
+        DrillHit hit = _hits[_runs[run] + index];
+        _instances[board].map(hit.x, hit.y);
+
+        return hit;
+    }
+
+private:
+    const QVector<DrillHit>& _hits;
+    const QVector<PanelInstance>& _instances;
+
+    // The first hit and the first step of every run, and the ends
+    QVector<int> _runs;
+    QVector<int> _steps;
+};
+
+// The boards of a panel are milled one after another, every other one in the
+// reverse order of the paths
+inline int panelPath(int step, int paths, int& board)
+{
+    board = step / paths;
+
+    int path = step % paths;
+    return (board % 2 == 0) ? path : paths - 1 - path;
+}
+
+void placePath(const QVector<PathNode>& nodes, const PanelInstance& instance,
+    QVector<PathNode>& placed)
+{
+    placed = nodes;
+
+    for (int i = 0; i < placed.size(); ++i)
+    {
+        instance.map(placed[i].x, placed[i].y);
+
+        if (placed[i].isArc())
+            instance.map(placed[i].centerX, placed[i].centerY);
+    }
+}
+
+// Expands a repeat of the holes, the copies take the line of the repeat command
+void appendCopies(const CurveRepeat& repeat, const QList<AbstractCurve>& points,
+    QVector<DrillHit>& hits)
+{
+    for (int k = 1; k <= repeat.count; ++k)
+    {
+        for (int i = qMax(repeat.first, 0); i < qMin(repeat.last, points.size()); ++i)
+        {
+            const AbstractCurve& point = points[i];
+
+            if (point.count() < 1)
+                continue;
+
+            DrillHit hit;
+            hit.x = point.x()[0] + repeat.x * k;
+            hit.y = point.y()[0] + repeat.y * k;
+            hit.tool = point.tool();
+            hit.line = repeat.line;
+
+            hits.append(hit);
+        }
+    }
+}
+
+} // namespace
+
+
+ProgramGenerator::ProgramGenerator(QObject* parent)
+    : QObject(parent)
+    , _dialect(GcodeDialect::DialectLinuxCnc)
+    , _compression(GcodeCompressor::OptionNone)
+    , _interrupted(false)
+    , _programEnd(true)
+    , _programStart(true)
+    , _tool(0)
+    , _toolCount(0)
+    , _millingTool(0)
+{
+}
+
+void ProgramGenerator::setDialect(int dialect)
+{
+    if (dialect < 0 || dialect >= GcodeDialect::DialectCount)
+        dialect = GcodeDialect::DialectLinuxCnc;
+
+    _dialect = dialect;
+}
+
+bool ProgramGenerator::generateDrilling(const AbstractParser& parser,
+    const DrillingSettings& settings, QString& program)
+{
+    _interrupted = false;
+
+    if (_programStart)
+    {
+        _tool = 0;
+        _toolCount = 0;
+        _millingTool = 0;
+    }
+
+    emit started(tr("Creating Drilling Program"));
+
+    bool result;
+
+    switch (_dialect)
+    {
+    case GcodeDialect::DialectGrbl:
+        result = drilling<GrblDialect>(parser, settings, program);
+        break;
+    case GcodeDialect::DialectMach3:
+        result = drilling<Mach3Dialect>(parser, settings, program);
+        break;
+    case GcodeDialect::DialectMarlin:
+        result = drilling<MarlinDialect>(parser, settings, program);
+        break;
+    default:
+        result = drilling<LinuxCncDialect>(parser, settings, program);
+        break;
+    }
+
+    emit finished();
+
+    return result;
+}
+
+bool ProgramGenerator::generateMilling(const AbstractParser& parser,
+    const MillingSettings& settings, QString& program)
+{
+    _interrupted = false;
+
+    if (_programStart)
+    {
+        _tool = 0;
+        _toolCount = 0;
+        _millingTool = 0;
+    }
+
+    emit started(tr("Creating Millling Program"));
+
+    bool result;
+
+    switch (_dialect)
+    {
+    case GcodeDialect::DialectGrbl:
+        result = milling<GrblDialect>(parser, settings, program);
+        break;
+    case GcodeDialect::DialectMach3:
+        result = milling<Mach3Dialect>(parser, settings, program);
+        break;
+    case GcodeDialect::DialectMarlin:
+        result = milling<MarlinDialect>(parser, settings, program);
+        break;
+    default:
+        result = milling<LinuxCncDialect>(parser, settings, program);
+        break;
+    }
+
+    emit finished();
+
+    return result;
+}
+
+void ProgramGenerator::interrupt()
+{
+    _interrupted = true;
+}
+
+template <class Dialect>
+bool ProgramGenerator::drilling(const AbstractParser& parser, const DrillingSettings& settings,
+    QString& program)
+{
+    typedef GcodeWriter<Dialect> Writer;
+
+    GcodeTemplate prologue;
+    GcodeTemplate epilogue;
+    GcodeTemplate toolChange;
+    GcodeTemplate hole;
+
+    compileTemplate(prologue, settings.prologue, tr("prologue"));
+    compileTemplate(epilogue, epilogueText(settings.epilogue), tr("epilogue"));
+    compileTemplate(toolChange, settings.toolChange, tr("tool change"));
+    compileTemplate(hole, settings.hole, tr("hole"));
+
+    QString feedRate = QString::number(settings.feedRate);
+    QString spindleSpeed = QString::number(settings.spindleSpeed);
+    QString safeZ = Writer::height(settings.safeZ);
+
+    GcodeTemplate::Values values;
+    values.set(GcodeTemplate::SlotFeed, feedRate);
+    values.set(GcodeTemplate::SlotSpindle, spindleSpeed);
+    values.set(GcodeTemplate::SlotSafeZ, safeZ);
+    values.set(GcodeTemplate::SlotDepth, Writer::height(settings.depth));
+    values.set(GcodeTemplate::SlotStartHeight, Writer::height(settings.startHeight));
+
+    if (settings.tcHeightEnabled)
+        values.set(GcodeTemplate::SlotTcHeight, Writer::height(settings.tcHeight));
+
+    int cycle = settings.cycle;
+
+    if (cycle != DrillingSettings::CycleNone && !Dialect::cannedCycles)
+    {
+        warning(tr("The %1 controller does not support canned drilling cycles.\n"
+            "The holes will be drilled with plain moves.").arg(GcodeDialect::name(_dialect)));
+
+        cycle = DrillingSettings::CycleNone;
+    }
+
+    // The first hole of every tool defines the cycle, the others are bare coordinates
+    QString cycleCommand;
+    QString cycleWords = QString(" Z%1 R%2").arg(Writer::height(settings.depth),
+        Writer::height(settings.startHeight));
+
+    switch (cycle)
+    {
+    case DrillingSettings::CycleG81:
+        cycleCommand = "G98 G81";
+        break;
+    case DrillingSettings::CycleG83:
+        cycleCommand = "G98 G83";
+        cycleWords.append(QString(" Q%1").arg(Writer::height(settings.peckDepth)));
+        break;
+    case DrillingSettings::CycleG73:
+        cycleCommand = "G98 G73";
+        cycleWords.append(QString(" Q%1").arg(Writer::height(settings.peckDepth)));
+        break;
+    default:
+        break;
+    }
+
+    cycleWords.append(QString(" F%1").arg(feedRate));
+
+    ToolTable tools = parser.tools();
+    const QList<AbstractCurve>& points = parser.curves();
+    const QVector<CurveRepeat>& repeats = parser.repeats();
+
+    int copies = 0;
+
+    foreach (const CurveRepeat& repeat, repeats)
+        copies += repeat.copies();
+
+    QVector<DrillHit> hits;
+    hits.reserve(points.count() + copies);
+
+    // The step-and-repeat copies exist only from here on, they come in the order of
+    // the file with the line of their repeat command
+    int repeat = 0;
+
+    for (int i = 0; i <= points.size(); ++i)
+    {
+        while (repeat < repeats.size() &&
+            (i == points.size() || repeats[repeat].line < points[i].line()))
+        {
+            appendCopies(repeats[repeat++], points, hits);
+        }
+
+        if (i < points.size() && points[i].count() > 0)
+        {
+            DrillHit hit;
+            hit.x = points[i].x()[0];
+            hit.y = points[i].y()[0];
+            hit.tool = points[i].tool();
+            hit.line = points[i].line();
+
+            hits.append(hit);
+        }
+    }
+
+    if (copies > 0)
+        notice(tr("The step-and-repeat commands have been expanded to %1 holes.").arg(copies));
+
+    if (!_transform.isIdentity() && !hits.isEmpty())
+    {
+        QVector<qint64> x(hits.size());
+        QVector<qint64> y(hits.size());
+
+        for (int i = 0; i < hits.size(); ++i)
+        {
+            x[i] = hits[i].x;
+            y[i] = hits[i].y;
+        }
+
+        _transform.apply(x.data(), y.data(), hits.size());
+
+        for (int i = 0; i < hits.size(); ++i)
+        {
+            hits[i].x = x[i];
+            hits[i].y = y[i];
+        }
+
+        notice(tr("The holes have been moved according to the transform settings."));
+    }
+
+    if (settings.removeDuplicates)
+    {
+        QVector<HoleDeduplication::Merge> merges;
+
+        int removed = HoleDeduplication::deduplicate(hits, tools,
+            qRound64(settings.duplicateTolerance * 1000.0), merges);
+
+        foreach (const HoleDeduplication::Merge& merge, merges)
+        {
+            notice(tr("The hole of tool #%1 at line %2 coincides with the hole of tool #%3 "
+                "at line %4 and has been removed.").arg(merge.removedTool).arg(merge.removedLine)
+                .arg(merge.keptTool).arg(merge.keptLine), QString::number(merge.removedLine));
+        }
+
+        if (removed > 0)
+            notice(tr("%1 duplicate holes have been removed.").arg(removed));
+    }
+
+    // The end mill gets a new tool number after all the tools of the file
+    qint64 endMill = qRound64(settings.endMillDiameter * 1000.0);
+    int endMillTool = tools.upperBound();
+    int milled = 0;
+
+    if (settings.helicalMilling)
+    {
+        if (settings.singleTool)
+        {
+            warning(tr("The helical milling of holes requires tool changes and is not used "
+                "with a single tool."));
+        }
+        else if (endMill <= 0 || settings.helixPitch <= 0.0)
+        {
+            warning(tr("The end mill diameter and the helix pitch must be positive. "
+                "The holes will be drilled."));
+        }
+        else
+        {
+            milled = assignEndMill(endMill, endMillTool, tools, hits);
+        }
+    }
+
+    if (!settings.drillLibrary.rejected().isEmpty())
+    {
+        warning(tr("The drill bit library entries \"%1\" are invalid and have been ignored.")
+            .arg(settings.drillLibrary.rejected().join(' ')));
+    }
+
+    if (!settings.singleTool && !settings.drillLibrary.isEmpty())
+        mapDrillBits(settings.drillLibrary, tools, hits);
+
+    // The end mill is added after the mapping, it is never merged with a drill bit
+    if (milled > 0)
+        tools.insert(endMillTool, static_cast<int>(endMill));
+
+    if (!settings.singleTool && settings.toolOrder != DrillingSettings::ToolOrderFile)
+    {
+        int avoided = ToolGrouping::group(hits, tools,
+            settings.toolOrder == DrillingSettings::ToolOrderDiameter);
+
+        if (avoided > 0)
+            notice(tr("The holes have been grouped by tool, %1 tool changes avoided.").arg(avoided));
+    }
+
+    bool cycleActive = false;
+
+    bool travel = settings.reducedTravel;
+    QString travelZ = Writer::height(settings.travelZ);
+    qint64 travelDistance = qRound64(settings.travelDistance * 1000.0);
+    int shortMoves = 0;
+
+    if (travel && cycle != DrillingSettings::CycleNone && milled < hits.size())
+    {
+        notice(tr("The canned cycles retract to the safe height, "
+            "the travel height is not used."));
+
+        travel = false;
+    }
+
+    GcodeCompressor compressor(_compression);
+
+    Writer writer(program);
+
+    if (_compression != GcodeCompressor::OptionNone)
+        writer.setCompressor(&compressor);
+
+    prologue.render(writer, values);
+
+    if (!settings.singleTool)
+    {
+        for (int id = 1; id < tools.upperBound(); ++id)
+        {
+            if (tools.contains(id))
+            {
+                writer.comment(QString("%1 #%2 / %3 mm")
+                    .arg(milled > 0 && id == endMillTool ? "End Mill" : "Drill Bit")
+                    .arg(id).arg(Utilities::coordinateToString(tools[id].diameter())));
+            }
+        }
+    }
+
+    int toolNumber = 0;
+
+    writer.line(QString("G0 Z%1").arg(safeZ));
+    writer.line(QString("G1 F%1").arg(feedRate));
+
+    if (settings.singleTool)
+        writer.line(QString("M3 S%1").arg(spindleSpeed));
+
+    BoundingBox extents;
+
+    foreach (const DrillHit& hit, hits)
+        extents.include(hit.x, hit.y);
+
+    QVector<PanelInstance> instances = panelInstances(extents);
+    PanelWalk walk(hits, instances);
+
+    int total = walk.size();
+    int step = qMax(1, total / 100);
+
+    for (int i = 0; i < total; ++i)
+    {
+        const DrillHit hit = walk.at(i);
+
+        if (i % step == 0)
+            emit progress(i, total);
+
+        if (_interrupted)
+            break;
+
+        if (!settings.singleTool && hit.tool != toolNumber)
+        {
+            if (cycleActive)
+            {
+                writer.line("G80");
+                cycleActive = false;
+            }
+
+            QString tool = QString::number(hit.tool);
+
+            values.set(GcodeTemplate::SlotTool, tool);
+            values.set(GcodeTemplate::SlotToolChange, Writer::toolChange(tool));
+            values.set(GcodeTemplate::SlotDiameter,
+                Utilities::coordinateToString(tools[hit.tool].diameter()));
+
+            toolChange.render(writer, values);
+            toolNumber = hit.tool;
+        }
+
+        values.set(GcodeTemplate::SlotX, Writer::coordinate(hit.x));
+        values.set(GcodeTemplate::SlotY, Writer::coordinate(hit.y));
+
+        if (cycle == DrillingSettings::CycleNone || hit.diameter > 0)
+        {
+            if (cycleActive)
+            {
+                writer.line("G80");
+                cycleActive = false;
+            }
+
+            // The retract of the hole depends on the move to the next one
+            bool shortMove = false;
+
+            if (travel && i + 1 < total)
+            {
+                const DrillHit next = walk.at(i + 1);
+
+                shortMove = (settings.singleTool || next.tool == hit.tool) &&
+                    isShortMove(hit.x, hit.y, next.x, next.y, travelDistance);
+            }
+
+            if (shortMove)
+                ++shortMoves;
+
+            values.set(GcodeTemplate::SlotSafeZ, shortMove ? travelZ : safeZ);
+
+            if (hit.diameter > 0)
+            {
+                helicalHole(writer, hit, endMill, settings);
+                writer.line(QString("G0 Z%1").arg(values.at(GcodeTemplate::SlotSafeZ)));
+            }
+            else
+            {
+                hole.render(writer, values);
+            }
+        }
+        else if (!cycleActive)
+        {
+            // The initial level of the G98 cycle is the safe height
+            writer.line(QString("G0 Z%1").arg(safeZ));
+
+            writer.beginLine();
+            writer.buffer().append(cycleCommand).append(" X").append(values.at(GcodeTemplate::SlotX))
+                .append(" Y").append(values.at(GcodeTemplate::SlotY)).append(cycleWords);
+            writer.endLine();
+
+            cycleActive = true;
+        }
+        else
+        {
+            writer.beginLine();
+            writer.buffer().append('X').append(values.at(GcodeTemplate::SlotX))
+                .append(" Y").append(values.at(GcodeTemplate::SlotY));
+            writer.endLine();
+        }
+    }
+
+    if (cycleActive)
+        writer.line("G80");
+
+    // An operation that continues the program knows the tool left in the spindle
+    _tool = settings.singleTool ? 0 : toolNumber;
+    _toolCount = qMax(_toolCount, tools.upperBound() - 1);
+
+    if (shortMoves > 0)
+    {
+        notice(tr("%1 of %2 moves between the holes use the travel height.")
+            .arg(shortMoves).arg(qMax(0, total - 1)));
+    }
+
+    if (!_interrupted)
+        epilogue.render(writer, values);
+
+    if (_compression != GcodeCompressor::OptionNone)
+        reportCompression(compressor);
+
+    // Remove the line break after the last line
+    program.chop(1);
+
+    return !_interrupted;
+}
+
+template <class Dialect>
+bool ProgramGenerator::milling(const AbstractParser& parser, const MillingSettings& settings,
+    QString& program)
+{
+    typedef GcodeWriter<Dialect> Writer;
+
+    GcodeTemplate prologue;
+    GcodeTemplate epilogue;
+    GcodeTemplate curveStart;
+    GcodeTemplate vertex;
+    GcodeTemplate curveEnd;
+
+    compileTemplate(prologue, settings.prologue, tr("prologue"));
+    compileTemplate(epilogue, epilogueText(settings.epilogue), tr("epilogue"));
+    compileTemplate(curveStart, settings.curveStart, tr("curve start"));
+    compileTemplate(vertex, settings.vertex, tr("vertex"));
+    compileTemplate(curveEnd, settings.curveEnd, tr("curve end"));
+
+    QString spindleSpeed = QString::number(settings.spindleSpeed);
+    QString safeZ = Writer::height(settings.safeZ);
+
+    GcodeTemplate::Values values;
+    values.set(GcodeTemplate::SlotFeed, QString::number(settings.feedRate));
+    values.set(GcodeTemplate::SlotPlunge, QString::number(settings.plungeRate));
+    values.set(GcodeTemplate::SlotSpindle, spindleSpeed);
+    values.set(GcodeTemplate::SlotSafeZ, safeZ);
+    values.set(GcodeTemplate::SlotDepth, Writer::height(settings.depth));
+
+    QList<AbstractCurve> curves = parser.curves();
+
+    if (!_transform.isIdentity())
+    {
+        _transform.apply(curves);
+        notice(tr("The curves have been moved according to the transform settings."));
+    }
+
+    QVector<MillPath> paths;
+    paths.reserve(curves.count());
+
+    int vertices = 0;
+
+    foreach (const AbstractCurve& curve, curves)
+    {
+        if (curve.type() == AbstractCurve::CurveTypeNone)
+            continue;
+
+        MillPath path;
+        path.line = curve.line();
+        path.nodes.resize(curve.count());
+
+        for (int j = 0; j < curve.count(); ++j)
+        {
+            PathNode& node = path.nodes[j];
+
+            node.x = curve.x()[j];
+            node.y = curve.y()[j];
+            node.motion = curve.motion(j);
+            node.centerX = curve.centerX(j);
+            node.centerY = curve.centerY(j);
+        }
+
+        vertices += curve.count();
+        paths.append(path);
+    }
+
+    if (settings.joinPaths)
+    {
+        int joins = PathChainer::chain(paths);
+
+        if (joins > 0)
+        {
+            notice(tr("%1 milling paths have been joined into %2 chains.")
+                .arg(joins + paths.size()).arg(paths.size()));
+        }
+    }
+
+    if (settings.arcs)
+    {
+        int arcs = ArcFitter::fit(paths, qRound64(settings.arcTolerance * 1000.0));
+
+        if (arcs > 0)
+            notice(tr("%1 arcs have been fitted into the milling paths.").arg(arcs));
+    }
+    else
+    {
+        // Native arcs of the input are flattened when the arc output is disabled
+        for (int i = 0; i < paths.size(); ++i)
+            ArcFitter::tessellate(paths[i], 5.0);
+    }
+
+    if (settings.simplify)
+    {
+        int removed = PathSimplifier::simplify(paths,
+            qRound64(settings.simplifyTolerance * 1000.0));
+
+        if (removed > 0)
+        {
+            notice(tr("%1 of %2 vertices have been removed by the path simplification.")
+                .arg(removed).arg(vertices));
+        }
+    }
+
+    GcodeCompressor compressor(_compression);
+
+    Writer writer(program);
+
+    if (_compression != GcodeCompressor::OptionNone)
+        writer.setCompressor(&compressor);
+
+    prologue.render(writer, values);
+
+    if (!_programStart)
+    {
+        if (_millingTool == 0)
+            _millingTool = ++_toolCount;
+
+        if (_tool != _millingTool)
+        {
+            GcodeTemplate toolChange;
+            compileTemplate(toolChange, settings.toolChange, tr("tool change"));
+
+            if (toolChange.isEmpty())
+            {
+                warning(tr("The tool change template is empty, the program does not stop "
+                    "to load the milling cutter after the drill bits."));
+            }
+
+            QString tool = QString::number(_millingTool);
+
+            // The slots of the tool are not defined for the milling templates
+            GcodeTemplate::Values change = values;
+            change.set(GcodeTemplate::SlotTool, tool);
+            change.set(GcodeTemplate::SlotToolChange, Writer::toolChange(tool));
+
+            if (settings.cutterDiameter > 0.0)
+            {
+                change.set(GcodeTemplate::SlotDiameter, Utilities::coordinateToString(
+                    qRound64(settings.cutterDiameter * 1000.0)));
+            }
+
+            if (settings.tcHeightEnabled)
+                change.set(GcodeTemplate::SlotTcHeight, Writer::height(settings.tcHeight));
+
+            toolChange.render(writer, change);
+            _tool = _millingTool;
+        }
+    }
+
+    writer.line(QString("G0 Z%1").arg(safeZ));
+    writer.line(QString("M3 S%1").arg(spindleSpeed));
+
+    bool travel = settings.reducedTravel;
+    QString travelZ = Writer::height(settings.travelZ);
+    qint64 travelDistance = qRound64(settings.travelDistance * 1000.0);
+    int shortMoves = 0;
+
+    // The passes divide the depth below the surface (zero) into equal steps
+    int passes = 1;
+
+    if (settings.multiPass && settings.stepDown > 0.0 && settings.depth < 0.0)
+        passes = qMax(1, qCeil(-settings.depth / settings.stepDown - 1e-9));
+
+    if (passes > 1)
+        notice(tr("Every curve will be milled in %1 passes.").arg(passes));
+
+    QString feedRate = QString::number(settings.feedRate);
+    QString plungeRate = QString::number(settings.plungeRate);
+
+    BoundingBox extents;
+
+    foreach (const MillPath& path, paths)
+    {
+        foreach (const PathNode& node, path.nodes)
+            extents.include(node.x, node.y);
+    }
+
+    QVector<PanelInstance> instances = panelInstances(extents);
+    QVector<PathNode> nodes;
+    QVector<PathNode> nextNodes;
+
+    int total = paths.size() * instances.size();
+    int step = qMax(1, total / 100);
+
+    for (int i = 0; i < total; ++i)
+    {
+        int board;
+        int path = panelPath(i, paths.size(), board);
+
+        placePath(paths[path].nodes, instances[board], nodes);
+
+        if (i % step == 0)
+            emit progress(i, total);
+
+        if (_interrupted)
+            break;
+
+        const int count = nodes.size();
+
+        // Open paths are walked back and forth, closed ones always in the same direction
+        bool closed = count > 2 && nodes.first().x == nodes.last().x &&
+            nodes.first().y == nodes.last().y;
+        bool backward = false;
+
+        for (int pass = 1; pass <= passes && count > 0; ++pass)
+        {
+            backward = !closed && pass % 2 == 0;
+
+            double top = (pass == 1) ? 0.0 : settings.depth * (pass - 1) / passes;
+            double bottom = (pass == passes) ? settings.depth : settings.depth * pass / passes;
+
+            const PathNode& first = nodes[backward ? count - 1 : 0];
+
+            values.set(GcodeTemplate::SlotX, Writer::coordinate(first.x));
+            values.set(GcodeTemplate::SlotY, Writer::coordinate(first.y));
+            values.set(GcodeTemplate::SlotDepth, Writer::height(settings.rampEntry ? top : bottom));
+
+            curveStart.render(writer, values);
+
+            if (settings.rampEntry)
+            {
+                bool ramped = false;
+
+                if (count > 1)
+                {
+                    const PathNode& second = nodes[backward ? count - 2 : 1];
+                    const PathNode& entry = backward ? first : second;
+
+                    ramped = !entry.isArc() && rampEntry(writer, first, second, top, bottom);
+                }
+
+                if (!ramped)
+                {
+                    writer.line(QString("G1 Z%1 F%2").arg(Writer::height(bottom), plungeRate));
+                    writer.line(QString("G1 F%1").arg(feedRate));
+                }
+            }
+
+            for (int j = 1; j < count; ++j)
+            {
+                const PathNode& previous = nodes[backward ? count - j : j - 1];
+                const PathNode& node = nodes[backward ? count - 1 - j : j];
+
+                // A node keeps the move that arrives at it, backwards it is the next node
+                const PathNode& move = backward ? previous : node;
+
+                values.set(GcodeTemplate::SlotX, Writer::coordinate(node.x));
+                values.set(GcodeTemplate::SlotY, Writer::coordinate(node.y));
+
+                if (!move.isArc())
+                {
+                    vertex.render(writer, values);
+                    continue;
+                }
+
+                bool clockwise = (move.motion == PathNode::MotionClockwise) != backward;
+
+                writer.beginLine();
+                writer.buffer().append(clockwise ? "G2" : "G3")
+                    .append(" X").append(values.at(GcodeTemplate::SlotX))
+                    .append(" Y").append(values.at(GcodeTemplate::SlotY));
+
+                if (Dialect::arcRadius)
+                {
+                    double dx = static_cast<double>(previous.x - move.centerX);
+                    double dy = static_cast<double>(previous.y - move.centerY);
+
+                    writer.buffer().append(" R").append(
+                        Writer::coordinate(qRound64(qSqrt(dx * dx + dy * dy))));
+                }
+                else
+                {
+                    writer.buffer()
+                        .append(" I").append(Writer::coordinate(move.centerX - previous.x))
+                        .append(" J").append(Writer::coordinate(move.centerY - previous.y));
+                }
+
+                writer.endLine();
+            }
+        }
+
+        values.set(GcodeTemplate::SlotDepth, Writer::height(settings.depth));
+
+        // The path ends where the last pass ends
+        int end = backward ? 0 : count - 1;
+
+        bool shortMove = false;
+
+        if (travel && i + 1 < total && count > 0)
+        {
+            int nextBoard;
+            int next = panelPath(i + 1, paths.size(), nextBoard);
+
+            placePath(paths[next].nodes, instances[nextBoard], nextNodes);
+
+            shortMove = !nextNodes.isEmpty() && isShortMove(nodes[end].x, nodes[end].y,
+                nextNodes.first().x, nextNodes.first().y, travelDistance);
+        }
+
+        if (shortMove)
+            ++shortMoves;
+
+        values.set(GcodeTemplate::SlotSafeZ, shortMove ? travelZ : safeZ);
+        curveEnd.render(writer, values);
+    }
+
+    if (shortMoves > 0)
+    {
+        notice(tr("%1 of %2 moves between the curves use the travel height.")
+            .arg(shortMoves).arg(qMax(0, total - 1)));
+    }
+
+    if (!_interrupted)
+        epilogue.render(writer, values);
+
+    if (_compression != GcodeCompressor::OptionNone)
+        reportCompression(compressor);
+
+    // Remove the line break after the last line
+    program.chop(1);
+
+    return !_interrupted;
+}
+
+template <class Dialect>
+void ProgramGenerator::helicalHole(GcodeWriter<Dialect>& writer, const DrillHit& hit,
+    qint64 endMill, const DrillingSettings& settings)
+{
+    typedef GcodeWriter<Dialect> Writer;
+
+    qint64 radius = (hit.diameter - endMill) / 2;
+
+    // Quarter turns through the four extreme points of the circle, each one lowers
+    // the tool by a quarter of the pitch. One more turn at the full depth cleans the
+    // bottom. Half turns would be ill-conditioned for the R form, as the rounded
+    // chord of a 180 degree arc can be longer than its diameter.
+    double height = settings.startHeight - settings.depth;
+    int quarters = qMax(1, qCeil(height / (settings.helixPitch / 4.0)));
+
+    const int directionX[4] = { 1, 0, -1, 0 };
+    const int directionY[4] = { 0, 1, 0, -1 };
+
+    QString offset = Writer::coordinate(radius);
+
+    writer.line(QString("G0 X%1 Y%2").arg(Writer::coordinate(hit.x + radius),
+        Writer::coordinate(hit.y)));
+    writer.line(QString("G0 Z%1").arg(Writer::height(settings.startHeight)));
+
+    for (int i = 0; i < quarters + 4; ++i)
+    {
+        int from = i % 4;
+        int to = (i + 1) % 4;
+
+        // G3 is the climb direction inside the hole for a clockwise spindle
+        writer.beginLine();
+        writer.buffer()
+            .append("G3 X").append(Writer::coordinate(hit.x + directionX[to] * radius))
+            .append(" Y").append(Writer::coordinate(hit.y + directionY[to] * radius));
+
+        if (i < quarters)
+        {
+            double z = (i + 1 == quarters) ? settings.depth
+                : settings.startHeight - height * (i + 1) / quarters;
+
+            writer.buffer().append(" Z").append(Writer::height(z));
+        }
+
+        if (Dialect::arcRadius)
+        {
+            writer.buffer().append(" R").append(offset);
+        }
+        else
+        {
+            writer.buffer()
+                .append(" I").append(Writer::coordinate(-directionX[from] * radius))
+                .append(" J").append(Writer::coordinate(-directionY[from] * radius));
+        }
+
+        writer.endLine();
+    }
+
+    // Leave the wall before the retract
+    writer.line(QString("G1 X%1 Y%2").arg(Writer::coordinate(hit.x), Writer::coordinate(hit.y)));
+}
+
+template <class Dialect>
+bool ProgramGenerator::rampEntry(GcodeWriter<Dialect>& writer, const PathNode& from,
+    const PathNode& to, double top, double bottom)
+{
+    typedef GcodeWriter<Dialect> Writer;
+
+    // The ramp runs back and forth along the first segment with a slope of 1:10
+    // and ends at its start, so the pass itself cuts the segment at full depth
+    const double slope = 10.0;
+    const int maximumLegs = 20;
+
+    double dx = static_cast<double>(to.x - from.x);
+    double dy = static_cast<double>(to.y - from.y);
+    double length = qSqrt(dx * dx + dy * dy);
+    double run = (top - bottom) * 1000.0 * slope;
+
+    if (run <= 0.0 || length <= 0.0)
+        return false;
+
+    double reach = qMin(length, run / 2.0);
+    int legs = qCeil(run / reach - 1e-9);
+    legs += legs % 2;
+
+    if (legs > maximumLegs)
+        return false;
+
+    QString startX = Writer::coordinate(from.x);
+    QString startY = Writer::coordinate(from.y);
+    QString turnX = Writer::coordinate(from.x + qRound64(dx * reach / length));
+    QString turnY = Writer::coordinate(from.y + qRound64(dy * reach / length));
+
+    for (int i = 1; i <= legs; ++i)
+    {
+        double z = (i == legs) ? bottom : top - (top - bottom) * i / legs;
+
+        writer.line(QString("G1 X%1 Y%2 Z%3").arg(i % 2 ? turnX : startX,
+            i % 2 ? turnY : startY, Writer::height(z)));
+    }
+
+    return true;
+}
+
+QVector<PanelInstance> ProgramGenerator::panelInstances(const BoundingBox& extents)
+{
+    if (_panel.isSingle())
+        return QVector<PanelInstance>(1);
+
+    notice(tr("The program covers a panel of %1 \xC3\x97 %2 boards.")
+        .arg(qMax(1, _panel.columns)).arg(qMax(1, _panel.rows)));
+
+    qint64 width = extents.maxX - extents.minX;
+    qint64 height = extents.maxY - extents.minY;
+
+    if (std::fmod(_panel.rotation, 180.0) != 0.0)
+    {
+        // The extents of the turned copies, the boards in between keep theirs
+        double radians = qDegreesToRadians(_panel.rotation);
+        double cosine = qAbs(qCos(radians));
+        double sine = qAbs(qSin(radians));
+
+        qint64 turnedWidth = qRound64(width * cosine + height * sine);
+        qint64 turnedHeight = qRound64(width * sine + height * cosine);
+
+        width = _panel.alternate ? qMax(width, turnedWidth) : turnedWidth;
+        height = _panel.alternate ? qMax(height, turnedHeight) : turnedHeight;
+    }
+
+    if (!extents.isEmpty() && ((_panel.columns > 1 && _panel.pitchX < width) ||
+        (_panel.rows > 1 && _panel.pitchY < height)))
+    {
+        warning(tr("The boards of the panel overlap, the board is %1 \xC3\x97 %2 mm.")
+            .arg(Utilities::coordinateToString(width), Utilities::coordinateToString(height)));
+    }
+
+    return _panel.instances();
+}
+
+bool ProgramGenerator::isShortMove(qint64 fromX, qint64 fromY, qint64 toX, qint64 toY,
+    qint64 limit)
+{
+    // The moves run between the features, so they never leave the board area
+    double dx = static_cast<double>(toX - fromX);
+    double dy = static_cast<double>(toY - fromY);
+    double length = static_cast<double>(limit);
+
+    return dx * dx + dy * dy <= length * length;
+}
+
+int ProgramGenerator::assignEndMill(qint64 endMill, int endMillTool, ToolTable& tools,
+    QVector<DrillHit>& hits)
+{
+    ToolTable drilled;
+    drilled.insert(0);
+
+    QVector<bool> large(tools.upperBound(), false);
+
+    for (int id = 1; id < tools.upperBound(); ++id)
+    {
+        if (!tools.contains(id))
+            continue;
+
+        int diameter = tools[id].diameter();
+
+        // The helix needs a radius of at least one micrometre
+        if (diameter - endMill >= 2)
+        {
+            large[id] = true;
+
+            notice(tr("The holes of tool #%1 (%2 mm) will be milled with the %3 mm end mill.")
+                .arg(id).arg(Utilities::coordinateToString(diameter))
+                .arg(Utilities::coordinateToString(endMill)));
+        }
+        else
+        {
+            drilled.insert(id, diameter);
+        }
+    }
+
+    int milled = 0;
+
+    for (int i = 0; i < hits.size(); ++i)
+    {
+        DrillHit& hit = hits[i];
+
+        if (hit.tool < large.size() && large[hit.tool])
+        {
+            hit.diameter = tools[hit.tool].diameter();
+            hit.tool = endMillTool;
+            ++milled;
+        }
+    }
+
+    if (milled > 0)
+        notice(tr("%1 holes will be milled along a helix.").arg(milled));
+
+    tools = drilled;
+
+    return milled;
+}
+
+void ProgramGenerator::mapDrillBits(const DrillLibrary& library, ToolTable& tools,
+    QVector<DrillHit>& hits)
+{
+    ToolTable mapped;
+    mapped.insert(0);
+
+    QVector<int> remap(tools.upperBound(), 0);
+    QVector<int> owners(library.count(), -1);
+
+    int merged = 0;
+
+    for (int id = 1; id < tools.upperBound(); ++id)
+    {
+        if (!tools.contains(id))
+            continue;
+
+        int diameter = tools[id].diameter();
+        int bit = library.find(diameter);
+
+        if (bit < 0)
+        {
+            warning(tr("There is no drill bit in the library for tool #%1 (%2 mm).")
+                .arg(id).arg(Utilities::coordinateToString(diameter)));
+
+            mapped.insert(id, diameter);
+            remap[id] = id;
+
+            continue;
+        }
+
+        // The first tool mapped to a bit owns it, the others are merged into that tool
+        if (owners[bit] < 0)
+        {
+            owners[bit] = id;
+            mapped.insert(id, library.diameter(bit));
+        }
+        else
+        {
+            ++merged;
+        }
+
+        remap[id] = owners[bit];
+
+        if (remap[id] != id || library.diameter(bit) != diameter)
+        {
+            notice(tr("Tool #%1 (%2 mm) will be drilled with the %3 mm bit of tool #%4.")
+                .arg(id).arg(Utilities::coordinateToString(diameter))
+                .arg(Utilities::coordinateToString(library.diameter(bit))).arg(remap[id]));
+        }
+    }
+
+    for (int i = 0; i < hits.size(); ++i)
+    {
+        if (hits[i].tool < remap.size())
+            hits[i].tool = remap[hits[i].tool];
+    }
+
+    if (merged > 0)
+        notice(tr("%1 tools have been merged using the drill bit library.").arg(merged));
+
+    tools = mapped;
+}
+
+void ProgramGenerator::compileTemplate(GcodeTemplate& compiled, const QString& text,
+    const QString& name)
+{
+    compiled.compile(text);
+
+    for (int i = 0; i < compiled.unknownPlaceholders().size(); ++i)
+    {
+        warning(tr("Unknown placeholder %1 in the %2 template.\n"
+            "It will be copied to the program as is.")
+            .arg(compiled.unknownPlaceholders().at(i), name));
+    }
+}
+
+QString ProgramGenerator::epilogueText(const QString& text) const
+{
+    if (_programEnd)
+        return text;
+
+    QStringList lines = text.split('\n');
+    QStringList kept;
+
+    foreach (const QString& line, lines)
+    {
+        QString word = line.trimmed().toUpper();
+
+        if (word != "M2" && word != "M02" && word != "M30")
+            kept.append(line);
+    }
+
+    return kept.join('\n');
+}
+
+void ProgramGenerator::reportCompression(const GcodeCompressor& compressor)
+{
+    if (compressor.inputSize() < 1)
+        return;
+
+    qint64 removed = compressor.inputSize() - compressor.outputSize();
+
+    notice(tr("Redundant words have been removed from the program.\n"
+        "The program size is reduced by %1% (%2 bytes).")
+        .arg(removed * 100 / compressor.inputSize()).arg(removed));
+}
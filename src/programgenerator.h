@@ -0,0 +1,279 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef PROGRAMGENERATOR_H
+#define PROGRAMGENERATOR_H
+
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+
+#include "logitem.h"
+#include "gcodedialect.h"
+#include "drilllibrary.h"
+#include "geometrytransform.h"
+#include "panel.h"
+
+
+class AbstractParser;
+class GcodeTemplate;
+class GcodeCompressor;
+class ToolTable;
+class DrillHit;
+class PathNode;
+
+template <class Dialect>
+class GcodeWriter;
+
+
+class DrillingSettings
+{
+public:
+    enum Cycle
+    {
+        CycleNone = 0,
+        CycleG81,
+        CycleG83,
+        CycleG73
+    };
+
+    enum ToolOrder
+    {
+        ToolOrderFile = 0,
+        ToolOrderNumber,
+        ToolOrderDiameter
+    };
+
+    DrillingSettings()
+        : spindleSpeed(10000)
+        , feedRate(1)
+        , safeZ(1.0)
+        , reducedTravel(false)
+        , travelZ(0.5)
+        , travelDistance(10.0)
+        , depth(0.0)
+        , startHeight(0.5)
+        , tcHeightEnabled(false)
+        , tcHeight(0.0)
+        , singleTool(false)
+        , toolOrder(ToolOrderNumber)
+        , removeDuplicates(true)
+        , duplicateTolerance(0.01)
+        , helicalMilling(false)
+        , endMillDiameter(1.0)
+        , helixPitch(0.5)
+        , cycle(CycleNone)
+        , peckDepth(0.5)
+    {
+    }
+
+    int spindleSpeed;
+    int feedRate;
+    double safeZ;
+    bool reducedTravel;
+    double travelZ;
+    double travelDistance;
+    double depth;
+    double startHeight;
+    bool tcHeightEnabled;
+    double tcHeight;
+    bool singleTool;
+    int toolOrder;
+    bool removeDuplicates;
+    double duplicateTolerance;
+    bool helicalMilling;
+    double endMillDiameter;
+    double helixPitch;
+    int cycle;
+    double peckDepth;
+
+    DrillLibrary drillLibrary;
+
+    QString prologue;
+    QString epilogue;
+    QString toolChange;
+    QString hole;
+};
+
+
+class MillingSettings
+{
+public:
+    MillingSettings()
+        : spindleSpeed(10000)
+        , feedRate(1)
+        , plungeRate(1)
+        , safeZ(1.0)
+        , reducedTravel(false)
+        , travelZ(0.5)
+        , travelDistance(10.0)
+        , depth(0.0)
+        , multiPass(false)
+        , stepDown(0.5)
+        , rampEntry(false)
+        , joinPaths(true)
+        , arcs(true)
+        , arcTolerance(0.02)
+        , simplify(true)
+        , simplifyTolerance(0.01)
+        , cutterDiameter(0.0)
+        , tcHeightEnabled(false)
+        , tcHeight(0.0)
+    {
+    }
+
+    int spindleSpeed;
+    int feedRate;
+    int plungeRate;
+    double safeZ;
+    bool reducedTravel;
+    double travelZ;
+    double travelDistance;
+    double depth;
+    bool multiPass;
+    double stepDown;
+    bool rampEntry;
+    bool joinPaths;
+    bool arcs;
+    double arcTolerance;
+    bool simplify;
+    double simplifyTolerance;
+
+    // The cutter is loaded by the tool change template when the milling continues
+    // a program after the drill bits
+    double cutterDiameter;
+    bool tcHeightEnabled;
+    double tcHeight;
+
+    QString prologue;
+    QString epilogue;
+    QString toolChange;
+    QString curveStart;
+    QString vertex;
+    QString curveEnd;
+};
+
+
+class ProgramGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit ProgramGenerator(QObject* parent = nullptr);
+
+    void setDialect(int dialect);
+    int dialect() const { return _dialect; }
+
+    void setCompression(int options) { _compression = options; }
+    int compression() const { return _compression; }
+
+    void setTransform(const GeometryTransform& transform) { _transform = transform; }
+    const GeometryTransform& transform() const { return _transform; }
+
+    void setPanel(const Panel& panel) { _panel = panel; }
+    const Panel& panel() const { return _panel; }
+
+    // Without the end, the epilogue leaves out M2 and M30, so another operation of the
+    // job can follow in the same program
+    void setProgramEnd(bool end) { _programEnd = end; }
+    bool programEnd() const { return _programEnd; }
+
+    // An operation that continues the program of another one changes the tool first
+    // when it needs another tool. The milling cutter is numbered after the drill bits.
+    void setProgramStart(bool start) { _programStart = start; }
+    bool programStart() const { return _programStart; }
+
+    bool generateDrilling(const AbstractParser& parser, const DrillingSettings& settings,
+        QString& program);
+    bool generateMilling(const AbstractParser& parser, const MillingSettings& settings,
+        QString& program);
+
+    void warning(const QString& description, const QString& line = QString());
+    void notice(const QString& description, const QString& line = QString());
+
+    bool isInterrupted() const { return _interrupted; }
+
+public slots:
+    void interrupt();
+
+signals:
+    void log(int severity, const QString& description, const QString& line);
+    void started(const QString& operation);
+    void progress(int done, int total);
+    void finished();
+
+private:
+    template <class Dialect>
+    bool drilling(const AbstractParser& parser, const DrillingSettings& settings,
+        QString& program);
+
+    template <class Dialect>
+    bool milling(const AbstractParser& parser, const MillingSettings& settings,
+        QString& program);
+
+    template <class Dialect>
+    void helicalHole(GcodeWriter<Dialect>& writer, const DrillHit& hit, qint64 endMill,
+        const DrillingSettings& settings);
+
+    template <class Dialect>
+    static bool rampEntry(GcodeWriter<Dialect>& writer, const PathNode& from, const PathNode& to,
+        double top, double bottom);
+
+    QVector<PanelInstance> panelInstances(const BoundingBox& extents);
+
+    static bool isShortMove(qint64 fromX, qint64 fromY, qint64 toX, qint64 toY, qint64 limit);
+
+    int assignEndMill(qint64 endMill, int endMillTool, ToolTable& tools, QVector<DrillHit>& hits);
+    void mapDrillBits(const DrillLibrary& library, ToolTable& tools, QVector<DrillHit>& hits);
+
+    void compileTemplate(GcodeTemplate& compiled, const QString& text, const QString& name);
+    QString epilogueText(const QString& text) const;
+    void reportCompression(const GcodeCompressor& compressor);
+
+    int _dialect;
+    int _compression;
+    bool _interrupted;
+    bool _programEnd;
+    bool _programStart;
+
+    // The tool in the spindle, the highest tool number used and the number of the
+    // milling cutter in the current program, zero when unknown
+    int _tool;
+    int _toolCount;
+    int _millingTool;
+
+    GeometryTransform _transform;
+    Panel _panel;
+};
+
+
+inline void ProgramGenerator::warning(const QString& description, const QString& line)
+{
+    emit log(LogItem::SeverityWarning, description, line);
+}
+
+inline void ProgramGenerator::notice(const QString& description, const QString& line)
+{
+    emit log(LogItem::SeverityNotice, description, line);
+}
+
+
+#endif // PROGRAMGENERATOR_H
@@ -1,6 +1,6 @@
 PROJECT_ROOT = $${PWD}/..
 
-QT += core gui widgets
+QT += core gui widgets concurrent
 
 TARGET = StepCAM
 TEMPLATE = app
@@ -13,27 +13,71 @@ INCLUDEPATH += $${PROJECT_ROOT}/dep
 
 SOURCES += \
     aboutdialog.cpp \
+    arcfitter.cpp \
+    boundingbox.cpp \
+    designrulecheck.cpp \
+    drilllibrary.cpp \
     excellonparser.cpp \
+    gcodecompressor.cpp \
+    gcodereader.cpp \
+    gcodetemplate.cpp \
+    geometrytransform.cpp \
+    holededuplication.cpp \
     hpglparser.cpp \
+    job.cpp \
     logfiltermodel.cpp \
     logtablemodel.cpp \
+    machiningestimator.cpp \
     main.cpp \
     mainwindow.cpp \
     mousewheeleventfilter.cpp \
+    panel.cpp \
+    pathchainer.cpp \
+    pathsimplifier.cpp \
+    previewbuilder.cpp \
+    previewscene.cpp \
+    programgenerator.cpp \
     progressstatuswidget.cpp \
+    toolgrouping.cpp \
+    toolpathpreview.cpp \
     utilities.cpp
 
 HEADERS += \
     aboutdialog.h \
     abstractparser.h \
+    arcfitter.h \
+    boundingbox.h \
+    designrulecheck.h \
+    drillhit.h \
+    drilllibrary.h \
     excellonparser.h \
+    gcodecompressor.h \
+    gcodedialect.h \
+    gcodereader.h \
+    gcodetemplate.h \
+    gcodewriter.h \
+    geometrytransform.h \
+    holededuplication.h \
     hpglparser.h \
+    job.h \
     logfiltermodel.h \
     logitem.h \
     logtablemodel.h \
+    machiningestimator.h \
     mainwindow.h \
+    millpath.h \
     mousewheeleventfilter.h \
+    panel.h \
+    pathchainer.h \
+    pathsimplifier.h \
+    previewbuilder.h \
+    previewscene.h \
+    programgenerator.h \
     progressstatuswidget.h \
+    toolgrouping.h \
+    toolpath.h \
+    toolpathpreview.h \
+    tooltable.h \
     utilities.h
 
 FORMS += \
@@ -0,0 +1,114 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "toolgrouping.h"
+
+#include <algorithm>
+
+#include "tooltable.h"
+
+
+namespace
+{
+
+class DiameterLess
+{
+public:
+    explicit DiameterLess(const ToolTable& tools)
+        : _tools(tools)
+    {
+    }
+
+    bool operator()(int left, int right) const
+    {
+        return _tools.at(left).diameter() < _tools.at(right).diameter();
+    }
+
+private:
+    const ToolTable& _tools;
+};
+
+} // namespace
+
+
+int ToolGrouping::group(QVector<DrillHit>& hits, const ToolTable& tools, bool byDiameter)
+{
+    int before = toolChanges(hits);
+
+    int upperBound = tools.upperBound();
+
+    for (int i = 0; i < hits.size(); ++i)
+        upperBound = qMax(upperBound, hits[i].tool + 1);
+
+    QVector<int> offsets(upperBound, 0);
+
+    for (int i = 0; i < hits.size(); ++i)
+        ++offsets[hits[i].tool];
+
+    // Holes drilled before any tool selection (tool #0) need no change and stay first
+    QVector<int> order;
+
+    for (int tool = 1; tool < upperBound; ++tool)
+    {
+        if (offsets[tool] > 0)
+            order.append(tool);
+    }
+
+    if (byDiameter)
+        std::stable_sort(order.begin(), order.end(), DiameterLess(tools));
+
+    order.prepend(0);
+
+    // Turn the counts into the first index of every run
+    int position = 0;
+
+    for (int i = 0; i < order.size(); ++i)
+    {
+        int count = offsets[order[i]];
+        offsets[order[i]] = position;
+        position += count;
+    }
+
+    QVector<DrillHit> grouped(hits.size());
+
+    for (int i = 0; i < hits.size(); ++i)
+        grouped[offsets[hits[i].tool]++] = hits[i];
+
+    hits.swap(grouped);
+
+    return before - toolChanges(hits);
+}
+
+int ToolGrouping::toolChanges(const QVector<DrillHit>& hits)
+{
+    int changes = 0;
+    int tool = 0;
+
+    for (int i = 0; i < hits.size(); ++i)
+    {
+        if (hits[i].tool != tool)
+        {
+            tool = hits[i].tool;
+            ++changes;
+        }
+    }
+
+    return changes;
+}
@@ -0,0 +1,90 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef TOOLPATH_H
+#define TOOLPATH_H
+
+
+#include <QVector>
+
+
+// A single move of the machine. The move starts where the previous one ends,
+// the first one starts at the origin. Coordinates are in millimetres.
+class ToolpathMove
+{
+public:
+    enum Type
+    {
+        TypeRapid = 0,
+        TypeLinear,
+        TypeClockwise,
+        TypeCounterClockwise
+    };
+
+    ToolpathMove()
+        : type(TypeRapid)
+        , x(0.0)
+        , y(0.0)
+        , z(0.0)
+        , centerX(0.0)
+        , centerY(0.0)
+        , feed(0.0)
+        , spindle(0.0)
+        , tool(0)
+        , line(0)
+    {
+    }
+
+    bool isArc() const { return type == TypeClockwise || type == TypeCounterClockwise; }
+
+    int type;
+    double x;
+    double y;
+    double z;
+    double centerX;
+    double centerY;
+    double feed;
+    double spindle;
+    int tool;
+    int line;
+};
+
+
+// The moves of a G-code program in the machine coordinates
+class Toolpath
+{
+public:
+    Toolpath()
+        : toolChanges(0)
+    {
+    }
+
+    void clear()
+    {
+        moves.clear();
+        toolChanges = 0;
+    }
+
+    QVector<ToolpathMove> moves;
+    int toolChanges;
+};
+
+
+#endif // TOOLPATH_H
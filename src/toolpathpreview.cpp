@@ -0,0 +1,481 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "toolpathpreview.h"
+
+#include <QPainter>
+#include <QMouseEvent>
+#include <QWheelEvent>
+#include <QThread>
+#include <QtConcurrent>
+#include <QtMath>
+
+#include <algorithm>
+
+
+namespace
+{
+
+const int TileSize = 256;
+
+// The scale doubles every four levels, 1 pixel per millimetre at the level zero
+const int LevelsPerOctave = 4;
+const int MinimumLevel = -40;
+const int MaximumLevel = 60;
+
+// Enough for a few screens of tiles at several levels
+const int MaximumTiles = 256;
+
+const int FitMargin = 16;
+
+const QRgb BackgroundColor = 0xffffff;
+
+
+inline double scaleOf(int level)
+{
+    return qPow(2.0, static_cast<double>(level) / LevelsPerOctave);
+}
+
+inline quint64 tileKey(int level, int x, int y)
+{
+    return (static_cast<quint64>(static_cast<quint16>(level)) << 48) |
+        (static_cast<quint64>(static_cast<quint32>(x) & 0xffffff) << 24) |
+        (static_cast<quint32>(y) & 0xffffff);
+}
+
+// The position of the cursor in the widget, without the accessors Qt deprecates
+inline QPointF wheelPosition(const QWheelEvent* event)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    return event->position();
+#else
+    return event->posF();
+#endif
+}
+
+inline QPoint mousePosition(const QMouseEvent* event)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
+    return event->position().toPoint();
+#else
+    return event->pos();
+#endif
+}
+
+QSharedPointer<const PreviewScene> buildPreviewScene(QVector<PreviewItem> items,
+    QVector<QTransform> instances)
+{
+    return QSharedPointer<const PreviewScene>(new PreviewScene(items, instances));
+}
+
+QImage renderTile(QSharedPointer<const PreviewScene> scene, int level, int x, int y)
+{
+    QImage image(TileSize, TileSize, QImage::Format_ARGB32_Premultiplied);
+    image.fill(QColor(BackgroundColor));
+
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+
+    scene->render(painter, QRectF(x * TileSize, y * TileSize, TileSize, TileSize),
+        scaleOf(level));
+
+    return image;
+}
+
+} // namespace
+
+
+ToolpathPreview::ToolpathPreview(QWidget* parent)
+    : QWidget(parent)
+    , _generation(0)
+    , _itemsChanged(false)
+    , _clock(0)
+    , _level(0)
+    , _dragging(false)
+    , _wheelDelta(0)
+{
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setMouseTracking(false);
+    setCursor(Qt::OpenHandCursor);
+
+    connect(&_builder, SIGNAL(finished()), this, SLOT(sceneBuilt()));
+}
+
+ToolpathPreview::~ToolpathPreview()
+{
+    _builder.waitForFinished();
+
+    for (QHash<TileWatcher*, Tile>::const_iterator job = _jobs.constBegin();
+        job != _jobs.constEnd(); ++job)
+    {
+        job.key()->waitForFinished();
+    }
+}
+
+void ToolpathPreview::setItems(const QVector<PreviewItem>& items,
+    const QVector<QTransform>& instances)
+{
+    _items = items;
+    _instances = instances;
+    _itemsChanged = true;
+
+    if (!_builder.isRunning())
+        buildScene();
+}
+
+void ToolpathPreview::clear()
+{
+    _tiles.clear();
+    _queue.clear();
+
+    setItems(QVector<PreviewItem>());
+}
+
+void ToolpathPreview::fitToView()
+{
+    if (!_scene || _scene->isEmpty())
+        return;
+
+    QRectF bounds = _scene->bounds();
+
+    double width = qMax(bounds.width(), 0.001);
+    double height = qMax(bounds.height(), 0.001);
+    double scale = qMin((this->width() - 2 * FitMargin) / width,
+        (this->height() - 2 * FitMargin) / height);
+
+    int level = MaximumLevel;
+
+    if (scale > 0.0)
+        level = qFloor(LevelsPerOctave * qLn(scale) / qLn(2.0));
+
+    _level = qBound(MinimumLevel, level, MaximumLevel);
+
+    scale = scaleOf(_level);
+
+    _offset = QPointF(bounds.center().x() * scale - this->width() / 2.0,
+        -bounds.center().y() * scale - this->height() / 2.0);
+
+    requestTiles();
+    update();
+}
+
+void ToolpathPreview::paintEvent(QPaintEvent* event)
+{
+    Q_UNUSED(event);
+
+    QPainter painter(this);
+    painter.fillRect(rect(), QColor(BackgroundColor));
+
+    if (!_scene || _scene->isEmpty())
+    {
+        if (!_builder.isRunning())
+        {
+            painter.setPen(palette().color(QPalette::Mid));
+            painter.drawText(rect(), Qt::AlignCenter, tr("Nothing to preview"));
+        }
+
+        return;
+    }
+
+    double scale = scaleOf(_level);
+    QRectF view(_offset, QSizeF(width(), height()));
+
+    // The tiles of the other levels and of the previous scenes go first, the
+    // closer the level, the later the tile is drawn
+    QVector<const Tile*> fallbacks;
+
+    for (QHash<quint64, Tile>::const_iterator tile = _tiles.constBegin();
+        tile != _tiles.constEnd(); ++tile)
+    {
+        if (tile->level == _level && tile->generation == _generation)
+            continue;
+
+        double ratio = scale / scaleOf(tile->level);
+        QRectF target(tile->x * TileSize * ratio, tile->y * TileSize * ratio,
+            TileSize * ratio, TileSize * ratio);
+
+        if (target.intersects(view))
+            fallbacks.append(&tile.value());
+    }
+
+    int level = _level;
+
+    std::stable_sort(fallbacks.begin(), fallbacks.end(), [level](const Tile* a, const Tile* b)
+    {
+        return qAbs(a->level - level) > qAbs(b->level - level);
+    });
+
+    foreach (const Tile* tile, fallbacks)
+    {
+        double ratio = scale / scaleOf(tile->level);
+        QRectF target(tile->x * TileSize * ratio - _offset.x(),
+            tile->y * TileSize * ratio - _offset.y(), TileSize * ratio, TileSize * ratio);
+
+        painter.drawImage(target, tile->image);
+    }
+
+    int left = qFloor(view.left() / TileSize);
+    int top = qFloor(view.top() / TileSize);
+    int right = qFloor((view.right() - 1.0) / TileSize);
+    int bottom = qFloor((view.bottom() - 1.0) / TileSize);
+
+    for (int y = top; y <= bottom; ++y)
+    {
+        for (int x = left; x <= right; ++x)
+        {
+            QHash<quint64, Tile>::iterator tile = _tiles.find(tileKey(_level, x, y));
+
+            if (tile == _tiles.end() || tile->generation != _generation)
+                continue;
+
+            tile->used = ++_clock;
+
+            painter.drawImage(QPointF(x * TileSize - _offset.x(), y * TileSize - _offset.y()),
+                tile->image);
+        }
+    }
+}
+
+void ToolpathPreview::resizeEvent(QResizeEvent* event)
+{
+    QWidget::resizeEvent(event);
+    requestTiles();
+}
+
+void ToolpathPreview::showEvent(QShowEvent* event)
+{
+    QWidget::showEvent(event);
+    requestTiles();
+}
+
+void ToolpathPreview::wheelEvent(QWheelEvent* event)
+{
+    // Touchpads send the small steps, they are collected into the whole ones
+    _wheelDelta += event->angleDelta().y();
+
+    int steps = _wheelDelta / 120;
+    _wheelDelta -= steps * 120;
+
+    if (steps != 0)
+        setLevel(_level + steps, wheelPosition(event));
+
+    event->accept();
+}
+
+void ToolpathPreview::mousePressEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton || event->button() == Qt::MiddleButton)
+    {
+        _dragging = true;
+        _dragPosition = mousePosition(event);
+
+        setCursor(Qt::ClosedHandCursor);
+    }
+
+    QWidget::mousePressEvent(event);
+}
+
+void ToolpathPreview::mouseMoveEvent(QMouseEvent* event)
+{
+    if (_dragging)
+    {
+        _offset -= QPointF(mousePosition(event) - _dragPosition);
+        _dragPosition = mousePosition(event);
+
+        requestTiles();
+        update();
+    }
+
+    QWidget::mouseMoveEvent(event);
+}
+
+void ToolpathPreview::mouseReleaseEvent(QMouseEvent* event)
+{
+    if (_dragging && !(event->buttons() & (Qt::LeftButton | Qt::MiddleButton)))
+    {
+        _dragging = false;
+        setCursor(Qt::OpenHandCursor);
+    }
+
+    QWidget::mouseReleaseEvent(event);
+}
+
+void ToolpathPreview::mouseDoubleClickEvent(QMouseEvent* event)
+{
+    if (event->button() == Qt::LeftButton)
+        fitToView();
+
+    QWidget::mouseDoubleClickEvent(event);
+}
+
+void ToolpathPreview::sceneBuilt()
+{
+    QSharedPointer<const PreviewScene> scene = _builder.result();
+
+    // A new panel of boards does not fit where the single board did
+    bool fit = !_scene || _scene->isEmpty() || _scene->instances() != scene->instances();
+
+    _scene = scene;
+    ++_generation;
+
+    // The jobs of the previous scene still complete, but their tiles are stale
+    _pending.clear();
+
+    if (fit)
+        fitToView();
+
+    requestTiles();
+    update();
+
+    if (_itemsChanged)
+        buildScene();
+}
+
+void ToolpathPreview::tileRendered()
+{
+    TileWatcher* watcher = static_cast<TileWatcher*>(sender());
+    Tile tile = _jobs.take(watcher);
+
+    tile.image = watcher->result();
+    watcher->deleteLater();
+
+    quint64 key = tileKey(tile.level, tile.x, tile.y);
+
+    if (tile.generation == _generation)
+        _pending.remove(key);
+
+    QHash<quint64, Tile>::iterator cached = _tiles.find(key);
+
+    // A stale tile never replaces a fresh one
+    if (cached == _tiles.end() || cached->generation <= tile.generation)
+    {
+        tile.used = ++_clock;
+        _tiles.insert(key, tile);
+    }
+
+    while (_tiles.size() > MaximumTiles)
+    {
+        QHash<quint64, Tile>::iterator oldest = _tiles.begin();
+
+        for (QHash<quint64, Tile>::iterator i = _tiles.begin(); i != _tiles.end(); ++i)
+        {
+            if (i->used < oldest->used)
+                oldest = i;
+        }
+
+        _tiles.erase(oldest);
+    }
+
+    update();
+    startRendering();
+}
+
+void ToolpathPreview::buildScene()
+{
+    _itemsChanged = false;
+    _builder.setFuture(QtConcurrent::run(buildPreviewScene, _items, _instances));
+}
+
+void ToolpathPreview::requestTiles()
+{
+    _queue.clear();
+
+    if (!_scene || _scene->isEmpty() || !isVisible())
+        return;
+
+    QRectF view(_offset, QSizeF(width(), height()));
+
+    int left = qFloor(view.left() / TileSize);
+    int top = qFloor(view.top() / TileSize);
+    int right = qFloor((view.right() - 1.0) / TileSize);
+    int bottom = qFloor((view.bottom() - 1.0) / TileSize);
+
+    for (int y = top; y <= bottom; ++y)
+    {
+        for (int x = left; x <= right; ++x)
+        {
+            quint64 key = tileKey(_level, x, y);
+
+            if (_pending.contains(key))
+                continue;
+
+            QHash<quint64, Tile>::const_iterator cached = _tiles.constFind(key);
+
+            if (cached != _tiles.constEnd() && cached->generation == _generation)
+                continue;
+
+            Tile tile;
+            tile.level = _level;
+            tile.x = x;
+            tile.y = y;
+            tile.generation = _generation;
+
+            _queue.append(tile);
+        }
+    }
+
+    // The tiles in the middle of the view are drawn first
+    QPointF center = view.center();
+
+    std::stable_sort(_queue.begin(), _queue.end(), [center](const Tile& a, const Tile& b)
+    {
+        QPointF first = QPointF((a.x + 0.5) * TileSize, (a.y + 0.5) * TileSize) - center;
+        QPointF second = QPointF((b.x + 0.5) * TileSize, (b.y + 0.5) * TileSize) - center;
+
+        return QPointF::dotProduct(first, first) < QPointF::dotProduct(second, second);
+    });
+
+    startRendering();
+}
+
+void ToolpathPreview::startRendering()
+{
+    int limit = qMax(1, QThread::idealThreadCount());
+
+    while (_jobs.size() < limit && !_queue.isEmpty())
+    {
+        Tile tile = _queue.takeFirst();
+
+        TileWatcher* watcher = new TileWatcher(this);
+        connect(watcher, SIGNAL(finished()), this, SLOT(tileRendered()));
+
+        _jobs.insert(watcher, tile);
+        _pending.insert(tileKey(tile.level, tile.x, tile.y));
+
+        watcher->setFuture(QtConcurrent::run(renderTile, _scene, tile.level, tile.x, tile.y));
+    }
+}
+
+void ToolpathPreview::setLevel(int level, const QPointF& anchor)
+{
+    level = qBound(MinimumLevel, level, MaximumLevel);
+
+    if (level == _level)
+        return;
+
+    // The scene point under the anchor stays in place
+    double ratio = scaleOf(level) / scaleOf(_level);
+
+    _offset = (_offset + anchor) * ratio - anchor;
+    _level = level;
+
+    requestTiles();
+    update();
+}
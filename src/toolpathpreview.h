@@ -0,0 +1,125 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef TOOLPATHPREVIEW_H
+#define TOOLPATHPREVIEW_H
+
+
+#include <QWidget>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <QHash>
+#include <QImage>
+#include <QSet>
+
+#include "previewscene.h"
+
+
+// Shows a preview scene from the top. The scene is built and drawn on the worker
+// threads: the view is split into square tiles, every zoom level has its own
+// tiles, and the tiles are kept in a cache. Until a tile is drawn, the tiles of
+// the other zoom levels and of the previous scene fill its place, so panning and
+// zooming never wait for the drawing.
+class ToolpathPreview : public QWidget
+{
+    Q_OBJECT
+
+public:
+    explicit ToolpathPreview(QWidget* parent = nullptr);
+    virtual ~ToolpathPreview();
+
+    // The previous scene stays on the screen until the new one has been built
+    void setItems(const QVector<PreviewItem>& items,
+        const QVector<QTransform>& instances = QVector<QTransform>());
+    void clear();
+
+    const QVector<PreviewItem>& items() const { return _items; }
+
+public slots:
+    void fitToView();
+
+protected:
+    virtual void paintEvent(QPaintEvent* event);
+    virtual void resizeEvent(QResizeEvent* event);
+    virtual void showEvent(QShowEvent* event);
+    virtual void wheelEvent(QWheelEvent* event);
+    virtual void mousePressEvent(QMouseEvent* event);
+    virtual void mouseMoveEvent(QMouseEvent* event);
+    virtual void mouseReleaseEvent(QMouseEvent* event);
+    virtual void mouseDoubleClickEvent(QMouseEvent* event);
+
+private slots:
+    void sceneBuilt();
+    void tileRendered();
+
+private:
+    class Tile
+    {
+    public:
+        Tile()
+            : level(0)
+            , x(0)
+            , y(0)
+            , generation(0)
+            , used(0)
+        {
+        }
+
+        QImage image;
+        int level;
+        int x;
+        int y;
+        int generation;
+        quint64 used;
+    };
+
+    typedef QFutureWatcher<QSharedPointer<const PreviewScene> > SceneWatcher;
+    typedef QFutureWatcher<QImage> TileWatcher;
+
+    void buildScene();
+    void requestTiles();
+    void startRendering();
+    void setLevel(int level, const QPointF& anchor);
+
+    QSharedPointer<const PreviewScene> _scene;
+    int _generation;
+
+    SceneWatcher _builder;
+    QVector<PreviewItem> _items;
+    QVector<QTransform> _instances;
+    bool _itemsChanged;
+
+    QHash<quint64, Tile> _tiles;
+    QList<Tile> _queue;
+    QHash<TileWatcher*, Tile> _jobs;
+    QSet<quint64> _pending;
+    quint64 _clock;
+
+    // The zoom level and the scene pixel shown in the top left corner
+    int _level;
+    QPointF _offset;
+
+    QPoint _dragPosition;
+    bool _dragging;
+    int _wheelDelta;
+};
+
+
+#endif // TOOLPATHPREVIEW_H
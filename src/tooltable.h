@@ -0,0 +1,128 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef TOOLTABLE_H
+#define TOOLTABLE_H
+
+
+#include <QVector>
+
+
+class AbstractTool
+{
+public:
+    AbstractTool()
+        : _id(0)
+        , _diameter(0)
+    {
+    }
+
+    int id() const { return _id; }
+    int diameter() const { return _diameter; }
+
+private:
+    int _id;
+    int _diameter;
+
+    friend class ToolTable;
+    friend class ExcellonParser;
+    friend class HpglParser;
+};
+
+
+// Tool numbers are small (Excellon allows T1..T9999), so the table is a plain
+// array indexed by the tool number. Lookups are a bounds check and an index.
+class ToolTable
+{
+public:
+    ToolTable()
+        : _count(0)
+    {
+    }
+
+    void clear();
+
+    AbstractTool& insert(int id);
+    AbstractTool& insert(int id, int diameter);
+
+    bool contains(int id) const;
+    const AbstractTool& at(int id) const;
+    const AbstractTool& operator[](int id) const { return at(id); }
+
+    int count() const { return _count; }
+    int upperBound() const { return _tools.size(); }
+
+private:
+    QVector<AbstractTool> _tools;
+    QVector<bool> _defined;
+
+    int _count;
+};
+
+
+inline void ToolTable::clear()
+{
+    _tools.clear();
+    _defined.clear();
+    _count = 0;
+}
+
+inline AbstractTool& ToolTable::insert(int id)
+{
+    Q_ASSERT(id >= 0);
+
+    if (id >= _tools.size())
+    {
+        _tools.resize(id + 1);
+        _defined.resize(id + 1);
+    }
+
+    if (!_defined[id])
+    {
+        _defined[id] = true;
+        _tools[id]._id = id;
+        ++_count;
+    }
+
+    return _tools[id];
+}
+
+inline AbstractTool& ToolTable::insert(int id, int diameter)
+{
+    AbstractTool& tool = insert(id);
+    tool._diameter = diameter;
+
+    return tool;
+}
+
+inline bool ToolTable::contains(int id) const
+{
+    return id >= 0 && id < _defined.size() && _defined[id];
+}
+
+inline const AbstractTool& ToolTable::at(int id) const
+{
+    static const AbstractTool none;
+
+    return contains(id) ? _tools[id] : none;
+}
+
+
+#endif // TOOLTABLE_H
@@ -20,8 +20,31 @@
 
 #include "utilities.h"
 
+#include <QThread>
+#include <QtConcurrent>
+
+
+namespace
+{
+
+class PrefixBlock
+{
+public:
+    int begin;
+    int end;
+    int open;
+    qint64 carry;
+};
+
+} // namespace
+
 
 QString Utilities::coordinateToString(qint64 coordinate, bool trim)
+{
+    return coordinateToString(coordinate, 3, trim);
+}
+
+QString Utilities::coordinateToString(qint64 coordinate, int precision, bool trim)
 {
     bool negative = false;
 
@@ -31,24 +54,41 @@ QString Utilities::coordinateToString(qint64 coordinate, bool trim)
         coordinate = -coordinate;
     }
 
-    QString result = QString::number(coordinate % 1000);
+    precision = qMax(0, precision);
 
-    while (result.size() < 3)
+    // The coordinates are whole micrometres, the decimals beyond them are zeros
+    int decimals = qMin(precision, 3);
+
+    // Round to the requested number of decimals (half away from zero)
+    qint64 divider = 1;
+    for (int i = decimals; i < 3; ++i)
+        divider *= 10;
+
+    coordinate = (coordinate + divider / 2) / divider;
+
+    qint64 scale = 1000 / divider;
+
+    QString result = QString::number(coordinate % scale);
+
+    while (result.size() < decimals)
         result.prepend('0');
 
     while (trim && !result.isEmpty() && result.at(result.size() - 1) == '0')
         result.chop(1);
 
-    if (result.isEmpty())
+    if (result.isEmpty() || decimals == 0)
     {
-        result = QString::number(coordinate / 1000);
+        result = QString::number(coordinate / scale);
     }
     else
     {
-        result.prepend(QString::number(coordinate / 1000) + '.');
+        result.prepend(QString::number(coordinate / scale) + '.');
+
+        if (!trim)
+            result.append(QString(precision - decimals, '0'));
     }
 
-    if (negative)
+    if (negative && coordinate != 0)
         result.prepend('-');
 
     return result;
@@ -69,3 +109,77 @@ QString Utilities::doubleToString(double value, int precision, bool trim)
 
     return result;
 }
+
+QString Utilities::durationToString(double seconds)
+{
+    qint64 total = qRound64(qMax(seconds, 0.0));
+
+    return QString("%1:%2:%3").arg(total / 3600)
+        .arg(total / 60 % 60, 2, 10, QChar('0')).arg(total % 60, 2, 10, QChar('0'));
+}
+
+void Utilities::prefixSum(QVector<qint64>& values, const QVector<bool>& relative)
+{
+    const int size = qMin(values.size(), relative.size());
+    const int minimumBlock = 16384;
+
+    int count = qBound(1, size / minimumBlock, QThread::idealThreadCount() * 4);
+    int length = (size + count - 1) / qMax(count, 1);
+
+    QVector<PrefixBlock> blocks;
+
+    for (int begin = 0; begin < size; begin += length)
+    {
+        PrefixBlock block;
+        block.begin = begin;
+        block.end = qMin(begin + length, size);
+        block.open = block.end;
+        block.carry = 0;
+        blocks << block;
+    }
+
+    qint64* data = values.data();
+    const bool* flags = relative.constData();
+
+    // Scan every block on its own, remembering where the first absolute value is
+    QtConcurrent::blockingMap(blocks, [data, flags](PrefixBlock& block)
+    {
+        for (int i = block.begin; i < block.end; ++i)
+        {
+            if (!flags[i])
+            {
+                if (block.open == block.end)
+                    block.open = i;
+            }
+            else if (i > block.begin)
+            {
+                data[i] += data[i - 1];
+            }
+        }
+    });
+
+    // Carry the running value from block to block
+    qint64 carry = 0;
+
+    for (int i = 0; i < blocks.size(); ++i)
+    {
+        PrefixBlock& block = blocks[i];
+
+        block.carry = carry;
+
+        if (block.open < block.end)
+            carry = data[block.end - 1];
+        else
+            carry += data[block.end - 1];
+    }
+
+    // Values up to the first absolute one still lack the carry of the previous blocks
+    QtConcurrent::blockingMap(blocks, [data](PrefixBlock& block)
+    {
+        if (block.carry == 0)
+            return;
+
+        for (int i = block.begin; i < block.open; ++i)
+            data[i] += block.carry;
+    });
+}
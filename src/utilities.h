@@ -23,13 +23,20 @@
 
 
 #include <QString>
+#include <QVector>
 
 
 class Utilities
 {
 public:
     static QString coordinateToString(qint64 coordinate, bool trim = true);
+    static QString coordinateToString(qint64 coordinate, int precision, bool trim = true);
     static QString doubleToString(double value, int precision = 2, bool trim = true);
+    static QString durationToString(double seconds);
+
+    // Resolves relative values in place: every relative value is added to the result
+    // before it, an absolute one starts over. The result equals the sequential walk.
+    static void prefixSum(QVector<qint64>& values, const QVector<bool>& relative);
 };
 
 
@@ -0,0 +1,15 @@
+IN;
+SP1;
+PU;
+PA0,0;
+PD;
+PA2000,0;
+PA2000,1400;
+AA1800,1400,90;
+PA0,1600;
+PA0,0;
+PU;
+PA1000,800;
+CI120;
+PU;
+SP0;
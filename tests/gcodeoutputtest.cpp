@@ -0,0 +1,451 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include <QtTest>
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTemporaryFile>
+
+#include "excellonparser.h"
+#include "gcodecompressor.h"
+#include "gcodedialect.h"
+#include "gcodereader.h"
+#include "gcodetemplate.h"
+#include "gcodewriter.h"
+#include "hpglparser.h"
+#include "programgenerator.h"
+
+
+namespace
+{
+
+const char* const DialectNames[GcodeDialect::DialectCount] =
+{
+    "linuxcnc",
+    "grbl",
+    "mach3",
+    "marlin"
+};
+
+const int AllOptions = GcodeCompressor::OptionModalWords |
+    GcodeCompressor::OptionUnchangedAxes | GcodeCompressor::OptionTrimZeros;
+
+// The templates of the settings page with the feeds and depths of a 1.6 mm board
+DrillingSettings drillingSettings()
+{
+    DrillingSettings settings;
+    settings.spindleSpeed = 12000;
+    settings.feedRate = 120;
+    settings.safeZ = 2.0;
+    settings.depth = -1.8;
+    settings.startHeight = 0.5;
+    settings.tcHeightEnabled = true;
+    settings.tcHeight = 25.0;
+    settings.cycle = DrillingSettings::CycleG81;
+
+    settings.prologue = "( Drilling )\nG90\nG61";
+    settings.epilogue = "M5\nM30\n";
+    settings.toolChange = "M5\n( Tool Change T{tool} / {diameter} mm )\nG0 Z{tc_height}\n"
+        "{tool_change}\nG1 F{feed}\nM3 S{spindle}";
+    settings.hole = "G0 X{x} Y{y}\nG0 Z{start_height}\nG1 Z{depth}\nG0 Z{safe_z}";
+
+    return settings;
+}
+
+MillingSettings millingSettings()
+{
+    MillingSettings settings;
+    settings.spindleSpeed = 18000;
+    settings.feedRate = 300;
+    settings.plungeRate = 60;
+    settings.safeZ = 2.0;
+    settings.depth = -1.7;
+
+    // Three passes of 0.5667 mm show the precision of the dialects
+    settings.multiPass = true;
+    settings.stepDown = 0.6;
+
+    settings.prologue = "( Milling )\nG90\nG61";
+    settings.epilogue = "M5\nM30\n";
+    settings.curveStart = "G0 X{x} Y{y}\nG1 Z{depth} F{plunge}\nG1 F{feed}";
+    settings.vertex = "G1 X{x} Y{y}";
+    settings.curveEnd = "G0 Z{safe_z}";
+
+    return settings;
+}
+
+bool load(AbstractParser& parser, const QString& fileName)
+{
+    QFile file(fileName);
+
+    return file.open(QIODevice::ReadOnly | QIODevice::Text) && parser.parse(file);
+}
+
+// The plain text substitution the compiled templates have to reproduce
+QString substitute(const QString& text, const GcodeTemplate::Values& values)
+{
+    QString result;
+
+    if (text.trimmed().isEmpty())
+        return result;
+
+    foreach (QString line, text.split('\n'))
+    {
+        bool defined = true;
+
+        for (int slot = 0; slot < GcodeTemplate::SlotCount && defined; ++slot)
+        {
+            QString placeholder = QString("{%1}").arg(GcodeTemplate::slotName(slot));
+
+            if (!line.contains(placeholder))
+                continue;
+
+            defined = !values.at(slot).isEmpty();
+            line.replace(placeholder, values.at(slot));
+        }
+
+        if (defined)
+            result.append(line).append('\n');
+    }
+
+    return result;
+}
+
+// The moves that change the position, the compressor drops the others
+QVector<ToolpathMove> motion(const QString& program)
+{
+    Toolpath toolpath;
+
+    GcodeReader reader;
+    reader.read(program.toLatin1(), toolpath);
+
+    QVector<ToolpathMove> result;
+
+    foreach (const ToolpathMove& move, toolpath.moves)
+    {
+        if (!result.isEmpty() && !move.isArc() && move.x == result.last().x &&
+            move.y == result.last().y && move.z == result.last().z)
+        {
+            continue;
+        }
+
+        result.append(move);
+    }
+
+    return result;
+}
+
+} // namespace
+
+
+// The programs of every dialect are compared with the golden files, the compressed
+// programs and the compiled templates with their plain counterparts
+class GcodeOutputTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void goldenPrograms_data();
+    void goldenPrograms();
+
+    void templateRoundTrip_data();
+    void templateRoundTrip();
+
+    void compressorRoundTrip_data();
+    void compressorRoundTrip();
+
+    void readBack_data();
+    void readBack();
+
+    void throughput_data();
+    void throughput();
+
+private:
+    void addProgramRows();
+    QString program(int dialect, bool milling, int compression);
+    qint64 generationTime(int dialect, const DrillingSettings& settings);
+
+    ExcellonParser _drilling;
+    HpglParser _milling;
+    ExcellonParser _largeDrilling;
+};
+
+
+void GcodeOutputTest::initTestCase()
+{
+    QVERIFY(load(_drilling, QFINDTESTDATA("data/board.drl")));
+    QVERIFY(load(_milling, QFINDTESTDATA("data/board.plt")));
+
+    // 10 000 holes of three tools for the throughput benchmark
+    QByteArray data("M48\nMETRIC,TZ\nT1C0.800\nT2C1.000\nT3C3.200\n%\nG05\n");
+
+    for (int tool = 1; tool <= 3; ++tool)
+    {
+        data.append(QString("T%1\n").arg(tool).toLatin1());
+
+        for (int i = 0; i < 3334; ++i)
+        {
+            double x = 0.5 * tool + 1.27 * (i % 58);
+            double y = 1.27 * (i / 58);
+
+            data.append(QString("X%1Y%2\n").arg(x, 0, 'f', 3).arg(y, 0, 'f', 3).toLatin1());
+        }
+    }
+
+    data.append("M30\n");
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    QCOMPARE(file.write(data), static_cast<qint64>(data.size()));
+    QVERIFY(file.seek(0));
+    QVERIFY(_largeDrilling.parse(file));
+}
+
+void GcodeOutputTest::goldenPrograms_data()
+{
+    addProgramRows();
+}
+
+void GcodeOutputTest::goldenPrograms()
+{
+    QFETCH(int, dialect);
+    QFETCH(bool, milling);
+
+    // The golden program is named after the row
+    QString fileName = QFINDTESTDATA(QString("golden/%1.ngc").arg(QTest::currentDataTag()));
+
+    QFile file(fileName);
+    QVERIFY2(file.open(QIODevice::ReadOnly | QIODevice::Text), QTest::currentDataTag());
+
+    QStringList expected = QString::fromLatin1(file.readAll()).split('\n');
+    QStringList actual = (program(dialect, milling, GcodeCompressor::OptionNone) + '\n')
+        .split('\n');
+
+    for (int i = 0; i < qMin(expected.size(), actual.size()); ++i)
+    {
+        QVERIFY2(actual.at(i) == expected.at(i), qPrintable(QString("Line %1: '%2' instead of '%3'")
+            .arg(i + 1).arg(actual.at(i), expected.at(i))));
+    }
+
+    QCOMPARE(actual.size(), expected.size());
+}
+
+void GcodeOutputTest::templateRoundTrip_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::addColumn<QStringList>("unknown");
+
+    QTest::newRow("literal") << "( Drilling )\nG90\nG61" << QStringList();
+    QTest::newRow("slots") << "G0 X{x} Y{y}\nG1 Z{depth} F{feed}\nG0 Z{safe_z}" << QStringList();
+    QTest::newRow("repeated slot") << "G0 X{x} Y{y}\n( {x} / {y} )" << QStringList();
+    QTest::newRow("undefined slot") << "M5\nG0 Z{tc_height}\n{tool_change}\nM3 S{spindle}"
+        << QStringList();
+    QTest::newRow("empty lines") << "M5\n\nM30\n" << QStringList();
+    QTest::newRow("empty") << "" << QStringList();
+    QTest::newRow("blank") << " \n\t\n" << QStringList();
+    QTest::newRow("unknown placeholder") << "G4 P{dwell}\nG0 Z{safe_z}"
+        << (QStringList() << "{dwell}");
+}
+
+void GcodeOutputTest::templateRoundTrip()
+{
+    QFETCH(QString, text);
+    QFETCH(QStringList, unknown);
+
+    GcodeTemplate::Values values;
+    values.set(GcodeTemplate::SlotX, "12.7");
+    values.set(GcodeTemplate::SlotY, "-3.175");
+    values.set(GcodeTemplate::SlotTool, "3");
+    values.set(GcodeTemplate::SlotDiameter, "0.8");
+    values.set(GcodeTemplate::SlotFeed, "300");
+    values.set(GcodeTemplate::SlotSpindle, "12000");
+    values.set(GcodeTemplate::SlotSafeZ, "2");
+    values.set(GcodeTemplate::SlotDepth, "-1.8");
+    values.set(GcodeTemplate::SlotToolChange, "M6 T3");
+
+    GcodeTemplate compiled;
+    compiled.compile(text);
+
+    QString output;
+    GcodeWriter<LinuxCncDialect> writer(output);
+    compiled.render(writer, values);
+
+    QCOMPARE(output, substitute(text, values));
+    QCOMPARE(compiled.unknownPlaceholders(), unknown);
+    QCOMPARE(compiled.isEmpty(), text.trimmed().isEmpty());
+}
+
+void GcodeOutputTest::compressorRoundTrip_data()
+{
+    addProgramRows();
+}
+
+void GcodeOutputTest::compressorRoundTrip()
+{
+    QFETCH(int, dialect);
+    QFETCH(bool, milling);
+
+    QString plain = program(dialect, milling, GcodeCompressor::OptionNone);
+    QString compressed = program(dialect, milling, AllOptions);
+
+    QVERIFY(compressed.size() < plain.size());
+
+    // The machine has to make the same moves at the same feeds
+    QVector<ToolpathMove> expected = motion(plain);
+    QVector<ToolpathMove> actual = motion(compressed);
+
+    QCOMPARE(actual.size(), expected.size());
+
+    for (int i = 0; i < expected.size(); ++i)
+    {
+        QCOMPARE(actual.at(i).type, expected.at(i).type);
+        QCOMPARE(actual.at(i).x, expected.at(i).x);
+        QCOMPARE(actual.at(i).y, expected.at(i).y);
+        QCOMPARE(actual.at(i).z, expected.at(i).z);
+        QCOMPARE(actual.at(i).centerX, expected.at(i).centerX);
+        QCOMPARE(actual.at(i).centerY, expected.at(i).centerY);
+        QCOMPARE(actual.at(i).feed, expected.at(i).feed);
+        QCOMPARE(actual.at(i).tool, expected.at(i).tool);
+    }
+}
+
+void GcodeOutputTest::readBack_data()
+{
+    addProgramRows();
+}
+
+void GcodeOutputTest::readBack()
+{
+    QFETCH(int, dialect);
+    QFETCH(bool, milling);
+
+    Toolpath toolpath;
+
+    GcodeReader reader;
+    QCOMPARE(reader.read(program(dialect, milling, AllOptions).toLatin1(), toolpath), 0);
+
+    // Every drill bit is changed once, whatever the dialect writes for the change
+    int tools = milling ? 0 : 3;
+
+    QCOMPARE(toolpath.toolChanges, tools);
+    QVERIFY(!toolpath.moves.isEmpty());
+    QCOMPARE(toolpath.moves.last().tool, tools);
+}
+
+void GcodeOutputTest::throughput_data()
+{
+    QTest::addColumn<int>("dialect");
+
+    for (int dialect = 0; dialect < GcodeDialect::DialectCount; ++dialect)
+        QTest::newRow(DialectNames[dialect]) << dialect;
+}
+
+void GcodeOutputTest::throughput()
+{
+    QFETCH(int, dialect);
+
+    ProgramGenerator generator;
+    generator.setDialect(dialect);
+
+    DrillingSettings settings = drillingSettings();
+    settings.cycle = DrillingSettings::CycleNone;
+
+    QString result;
+
+    QBENCHMARK
+    {
+        result.clear();
+        generator.generateDrilling(_largeDrilling, settings, result);
+    }
+
+    QVERIFY(!result.isEmpty());
+
+    // The policy against the default dialect, measured the same way for both
+    double ratio = static_cast<double>(generationTime(dialect, settings)) /
+        static_cast<double>(qMax(Q_INT64_C(1),
+        generationTime(GcodeDialect::DialectLinuxCnc, settings)));
+
+    qInfo("%s: %.2f times the generation time of the default dialect",
+        DialectNames[dialect], ratio);
+}
+
+void GcodeOutputTest::addProgramRows()
+{
+    QTest::addColumn<int>("dialect");
+    QTest::addColumn<bool>("milling");
+
+    for (int dialect = 0; dialect < GcodeDialect::DialectCount; ++dialect)
+    {
+        QTest::newRow(qPrintable(QString("drilling-%1").arg(DialectNames[dialect])))
+            << dialect << false;
+        QTest::newRow(qPrintable(QString("milling-%1").arg(DialectNames[dialect])))
+            << dialect << true;
+    }
+}
+
+QString GcodeOutputTest::program(int dialect, bool milling, int compression)
+{
+    ProgramGenerator generator;
+    generator.setDialect(dialect);
+    generator.setCompression(compression);
+
+    QString result;
+
+    if (milling)
+        generator.generateMilling(_milling, millingSettings(), result);
+    else
+        generator.generateDrilling(_drilling, drillingSettings(), result);
+
+    return result;
+}
+
+// The best time of several runs, in nanoseconds
+qint64 GcodeOutputTest::generationTime(int dialect, const DrillingSettings& settings)
+{
+    ProgramGenerator generator;
+    generator.setDialect(dialect);
+
+    qint64 best = 0;
+
+    for (int i = 0; i < 5; ++i)
+    {
+        QString result;
+
+        QElapsedTimer timer;
+        timer.start();
+
+        generator.generateDrilling(_largeDrilling, settings, result);
+
+        qint64 time = timer.nsecsElapsed();
+
+        if (i == 0 || time < best)
+            best = time;
+    }
+
+    return best;
+}
+
+
+QTEST_GUILESS_MAIN(GcodeOutputTest)
+
+#include "gcodeoutputtest.moc"
@@ -0,0 +1,58 @@
+PROJECT_ROOT = $${PWD}/..
+
+QT += core gui concurrent testlib
+
+TARGET = gcodeoutputtest
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CONFIG += c++11 console testcase
+CONFIG -= app_bundle
+
+INCLUDEPATH += $${PROJECT_ROOT}/src
+
+SOURCES += \
+    $${PROJECT_ROOT}/src/arcfitter.cpp \
+    $${PROJECT_ROOT}/src/boundingbox.cpp \
+    $${PROJECT_ROOT}/src/drilllibrary.cpp \
+    $${PROJECT_ROOT}/src/excellonparser.cpp \
+    $${PROJECT_ROOT}/src/gcodecompressor.cpp \
+    $${PROJECT_ROOT}/src/gcodereader.cpp \
+    $${PROJECT_ROOT}/src/gcodetemplate.cpp \
+    $${PROJECT_ROOT}/src/geometrytransform.cpp \
+    $${PROJECT_ROOT}/src/holededuplication.cpp \
+    $${PROJECT_ROOT}/src/hpglparser.cpp \
+    $${PROJECT_ROOT}/src/panel.cpp \
+    $${PROJECT_ROOT}/src/pathchainer.cpp \
+    $${PROJECT_ROOT}/src/pathsimplifier.cpp \
+    $${PROJECT_ROOT}/src/programgenerator.cpp \
+    $${PROJECT_ROOT}/src/toolgrouping.cpp \
+    $${PROJECT_ROOT}/src/utilities.cpp \
+    gcodeoutputtest.cpp
+
+HEADERS += \
+    $${PROJECT_ROOT}/src/abstractparser.h \
+    $${PROJECT_ROOT}/src/arcfitter.h \
+    $${PROJECT_ROOT}/src/boundingbox.h \
+    $${PROJECT_ROOT}/src/drillhit.h \
+    $${PROJECT_ROOT}/src/drilllibrary.h \
+    $${PROJECT_ROOT}/src/excellonparser.h \
+    $${PROJECT_ROOT}/src/gcodecompressor.h \
+    $${PROJECT_ROOT}/src/gcodedialect.h \
+    $${PROJECT_ROOT}/src/gcodereader.h \
+    $${PROJECT_ROOT}/src/gcodetemplate.h \
+    $${PROJECT_ROOT}/src/gcodewriter.h \
+    $${PROJECT_ROOT}/src/geometrytransform.h \
+    $${PROJECT_ROOT}/src/holededuplication.h \
+    $${PROJECT_ROOT}/src/hpglparser.h \
+    $${PROJECT_ROOT}/src/logitem.h \
+    $${PROJECT_ROOT}/src/millpath.h \
+    $${PROJECT_ROOT}/src/panel.h \
+    $${PROJECT_ROOT}/src/pathchainer.h \
+    $${PROJECT_ROOT}/src/pathsimplifier.h \
+    $${PROJECT_ROOT}/src/programgenerator.h \
+    $${PROJECT_ROOT}/src/toolgrouping.h \
+    $${PROJECT_ROOT}/src/toolpath.h \
+    $${PROJECT_ROOT}/src/tooltable.h \
+    $${PROJECT_ROOT}/src/utilities.h
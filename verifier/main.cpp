@@ -0,0 +1,164 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include "gcodereader.h"
+#include "programverifier.h"
+
+
+namespace
+{
+
+bool readProgram(const QString& fileName, Toolpath& toolpath, QTextStream& output)
+{
+    QFile file(fileName);
+
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        output << fileName << ": " << file.errorString() << '\n';
+        return false;
+    }
+
+    GcodeReader reader;
+    int ignored = reader.read(file, toolpath);
+
+    output << fileName << ": " << reader.lines() << " lines, " << toolpath.moves.size()
+        << " moves, " << ignored << " lines with unsupported commands" << '\n';
+
+    return true;
+}
+
+void printFeatures(const QVector<ProgramFeature>& features, const QString& title,
+    const QString& fileName, int limit, QTextStream& output)
+{
+    if (features.isEmpty())
+        return;
+
+    output << title << ": " << features.size() << '\n';
+
+    for (int i = 0; i < features.size() && i < limit; ++i)
+    {
+        const ProgramFeature& feature = features[i];
+
+        output << "  " << fileName << ':' << feature.line << ": ";
+
+        if (feature.type == ProgramFeature::TypeHole)
+            output << "hole";
+        else
+            output << "chain of " << QString::number(feature.length, 'f', 3) << " mm from";
+
+        output << " X" << QString::number(feature.x, 'f', 3) << " Y"
+            << QString::number(feature.y, 'f', 3) << " Z"
+            << QString::number(feature.depth, 'f', 3) << '\n';
+    }
+
+    if (features.size() > limit)
+        output << "  ..." << '\n';
+}
+
+} // namespace
+
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication application(argc, argv);
+
+    application.setApplicationName("StepCAM Verifier");
+    application.setApplicationVersion("2.2.0");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Compares what two G-code programs cut, regardless of "
+        "the order of the features and the direction of the cuts.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("reference", "The reference program.");
+    parser.addPositionalArgument("candidate", "The program to verify.");
+
+    QCommandLineOption toleranceOption(QStringList() << "t" << "tolerance",
+        "The largest allowed deviation, mm (0.01 by default).", "tolerance", "0.01");
+    parser.addOption(toleranceOption);
+
+    QCommandLineOption surfaceOption(QStringList() << "s" << "surface",
+        "The Z of the workpiece surface, mm (0 by default).", "surface", "0");
+    parser.addOption(surfaceOption);
+
+    QCommandLineOption limitOption(QStringList() << "l" << "limit",
+        "The number of the differences listed per kind (20 by default).", "limit", "20");
+    parser.addOption(limitOption);
+
+    parser.process(application);
+
+    QStringList files = parser.positionalArguments();
+
+    if (files.size() != 2)
+        parser.showHelp(2);
+
+    bool valid = true;
+    double tolerance = parser.value(toleranceOption).toDouble(&valid);
+
+    if (!valid || tolerance <= 0.0)
+    {
+        QTextStream(stderr) << "Invalid tolerance: " << parser.value(toleranceOption) << '\n';
+        return 2;
+    }
+
+    double surface = parser.value(surfaceOption).toDouble(&valid);
+
+    if (!valid)
+    {
+        QTextStream(stderr) << "Invalid surface: " << parser.value(surfaceOption) << '\n';
+        return 2;
+    }
+
+    int limit = qMax(0, parser.value(limitOption).toInt());
+
+    QTextStream output(stdout);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    Toolpath reference;
+    Toolpath candidate;
+
+    if (!readProgram(files[0], reference, output) || !readProgram(files[1], candidate, output))
+        return 2;
+
+    // The statistics of the programs are shown while they are compared
+    output.flush();
+
+    VerificationReport report = ProgramVerifier::verify(reference, candidate, tolerance, surface);
+
+    output << "Holes: " << report.referenceHoles << " / " << report.candidateHoles
+        << ", chains: " << report.referenceChains << " / " << report.candidateChains << '\n';
+    output << "Maximum deviation: " << QString::number(report.maximumDeviation, 'f', 4)
+        << " mm, maximum hole depth deviation: "
+        << QString::number(report.maximumDepthDeviation, 'f', 4) << " mm" << '\n';
+
+    printFeatures(report.missing, "Missing", files[0], limit, output);
+    printFeatures(report.extra, "Extra", files[1], limit, output);
+
+    output << (report.passed() ? "PASSED" : "FAILED") << " in " << timer.elapsed() << " ms" << '\n';
+
+    return report.passed() ? 0 : 1;
+}
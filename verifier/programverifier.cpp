@@ -0,0 +1,552 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#include "programverifier.h"
+
+#include <QHash>
+#include <QtConcurrent>
+#include <QtMath>
+
+
+namespace
+{
+
+// Smaller XY offsets do not count as a lateral movement, mm
+const double Lateral = 1e-6;
+
+// The grid cells are never smaller than that to keep the number of pieces sane, mm
+const double MinimumCell = 0.5;
+
+// The points of a chain are checked at least that densely, mm
+const double MinimumSpacing = 0.005;
+
+const int MaximumArcSegments = 10000;
+
+
+class Segment
+{
+public:
+    Segment()
+        : x1(0.0)
+        , y1(0.0)
+        , x2(0.0)
+        , y2(0.0)
+    {
+    }
+
+    Segment(double x1, double y1, double x2, double y2)
+        : x1(x1)
+        , y1(y1)
+        , x2(x2)
+        , y2(y2)
+    {
+    }
+
+    double length() const { return qSqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1)); }
+
+    double x1;
+    double y1;
+    double x2;
+    double y2;
+};
+
+
+class Chain
+{
+public:
+    Chain()
+        : begin(0)
+        , end(0)
+        , feature(0)
+        , deviation(0.0)
+        , matched(true)
+    {
+    }
+
+    int begin;
+    int end;
+    int feature;
+    double deviation;
+    bool matched;
+};
+
+
+// The holes and the cuts of a program
+class Geometry
+{
+public:
+    QVector<ProgramFeature> holes;
+    QVector<ProgramFeature> features;
+    QVector<Segment> segments;
+    QVector<Chain> chains;
+};
+
+
+inline qint64 cellOf(double coordinate, double size)
+{
+    return static_cast<qint64>(qFloor(coordinate / size));
+}
+
+inline quint64 cellKey(qint64 x, qint64 y)
+{
+    return (static_cast<quint64>(static_cast<quint32>(x)) << 32) | static_cast<quint32>(y);
+}
+
+double segmentDistance(const Segment& segment, double x, double y)
+{
+    double dx = segment.x2 - segment.x1;
+    double dy = segment.y2 - segment.y1;
+    double square = dx * dx + dy * dy;
+    double t = 0.0;
+
+    if (square > 0.0)
+        t = qBound(0.0, ((x - segment.x1) * dx + (y - segment.y1) * dy) / square, 1.0);
+
+    double px = segment.x1 + t * dx - x;
+    double py = segment.y1 + t * dy - y;
+
+    return qSqrt(px * px + py * py);
+}
+
+
+// Buckets the cuts of a program for the nearest cut queries. The cuts are split
+// into pieces not longer than a cell and every piece is put into all the cells
+// its box grown by the tolerance touches, so one cell answers a query.
+class SegmentGrid
+{
+public:
+    SegmentGrid(const QVector<Segment>& segments, double tolerance);
+
+    // Returns the distance to the nearest cut, or a negative value if there is no
+    // cut within the tolerance
+    double distance(double x, double y) const;
+
+private:
+    double _size;
+    double _tolerance;
+
+    QVector<Segment> _pieces;
+    QHash<quint64, int> _cells;
+    QVector<int> _entryPiece;
+    QVector<int> _entryNext;
+};
+
+SegmentGrid::SegmentGrid(const QVector<Segment>& segments, double tolerance)
+    : _size(qMax(tolerance, MinimumCell))
+    , _tolerance(tolerance)
+{
+    foreach (const Segment& segment, segments)
+    {
+        int count = qMax(1, qCeil(segment.length() / _size));
+
+        for (int i = 0; i < count; ++i)
+        {
+            double from = static_cast<double>(i) / count;
+            double to = static_cast<double>(i + 1) / count;
+
+            Segment piece(segment.x1 + (segment.x2 - segment.x1) * from,
+                segment.y1 + (segment.y2 - segment.y1) * from,
+                segment.x1 + (segment.x2 - segment.x1) * to,
+                segment.y1 + (segment.y2 - segment.y1) * to);
+
+            int index = _pieces.size();
+            _pieces.append(piece);
+
+            qint64 left = cellOf(qMin(piece.x1, piece.x2) - tolerance, _size);
+            qint64 right = cellOf(qMax(piece.x1, piece.x2) + tolerance, _size);
+            qint64 bottom = cellOf(qMin(piece.y1, piece.y2) - tolerance, _size);
+            qint64 top = cellOf(qMax(piece.y1, piece.y2) + tolerance, _size);
+
+            for (qint64 cellX = left; cellX <= right; ++cellX)
+            {
+                for (qint64 cellY = bottom; cellY <= top; ++cellY)
+                {
+                    // Every cell refers to its last entry, the others are chained
+                    QHash<quint64, int>::iterator cell = _cells.find(cellKey(cellX, cellY));
+
+                    _entryPiece.append(index);
+
+                    if (cell == _cells.end())
+                    {
+                        _entryNext.append(-1);
+                        _cells.insert(cellKey(cellX, cellY), _entryPiece.size() - 1);
+                    }
+                    else
+                    {
+                        _entryNext.append(cell.value());
+                        cell.value() = _entryPiece.size() - 1;
+                    }
+                }
+            }
+        }
+    }
+}
+
+double SegmentGrid::distance(double x, double y) const
+{
+    QHash<quint64, int>::const_iterator cell =
+        _cells.constFind(cellKey(cellOf(x, _size), cellOf(y, _size)));
+
+    if (cell == _cells.constEnd())
+        return -1.0;
+
+    double result = -1.0;
+
+    for (int entry = cell.value(); entry >= 0; entry = _entryNext[entry])
+    {
+        double distance = segmentDistance(_pieces[_entryPiece[entry]], x, y);
+
+        if (distance <= _tolerance && (result < 0.0 || distance < result))
+            result = distance;
+    }
+
+    return result;
+}
+
+
+void appendArc(const ToolpathMove& move, double x, double y, double tolerance,
+    QVector<Segment>& segments)
+{
+    double radius = qSqrt((x - move.centerX) * (x - move.centerX) +
+        (y - move.centerY) * (y - move.centerY));
+
+    double start = qAtan2(y - move.centerY, x - move.centerX);
+    double sweep = qAtan2(move.y - move.centerY, move.x - move.centerX) - start;
+
+    if (move.type == ToolpathMove::TypeClockwise && sweep >= 0.0)
+        sweep -= 2.0 * M_PI;
+    else if (move.type == ToolpathMove::TypeCounterClockwise && sweep <= 0.0)
+        sweep += 2.0 * M_PI;
+
+    // The chords stay within a quarter of the tolerance from the arc
+    int count = 1;
+    double error = tolerance / 4.0;
+
+    if (radius > error)
+    {
+        double step = 2.0 * qAcos(1.0 - error / radius);
+        count = qBound(1, qCeil(qAbs(sweep) / step), MaximumArcSegments);
+    }
+
+    double lastX = x;
+    double lastY = y;
+
+    for (int i = 1; i <= count; ++i)
+    {
+        double nextX = move.x;
+        double nextY = move.y;
+
+        if (i < count)
+        {
+            double angle = start + sweep * i / count;
+
+            nextX = move.centerX + radius * qCos(angle);
+            nextY = move.centerY + radius * qSin(angle);
+        }
+
+        segments.append(Segment(lastX, lastY, nextX, nextY));
+
+        lastX = nextX;
+        lastY = nextY;
+    }
+}
+
+// Splits the toolpath into the series of feed moves, rapid moves and tool changes
+// end a series. The series cutting below the surface become holes or chains.
+void extract(const Toolpath& toolpath, double tolerance, double surface, Geometry& geometry)
+{
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+    int tool = 0;
+
+    bool open = false;
+    bool below = false;
+    bool lateral = false;
+    int begin = 0;
+    int line = 0;
+    double holeX = 0.0;
+    double holeY = 0.0;
+    double depth = 0.0;
+
+    // The hole of the previous series, the pecks of a hole are joined
+    int previousHole = -1;
+
+    for (int i = 0; i <= toolpath.moves.size(); ++i)
+    {
+        const ToolpathMove* move = (i < toolpath.moves.size()) ? &toolpath.moves[i] : nullptr;
+
+        bool boundary = !move || move->type == ToolpathMove::TypeRapid || move->tool != tool;
+
+        if (boundary && open)
+        {
+            open = false;
+
+            if (below && lateral)
+            {
+                ProgramFeature feature;
+                feature.type = ProgramFeature::TypeChain;
+                feature.x = geometry.segments[begin].x1;
+                feature.y = geometry.segments[begin].y1;
+                feature.depth = depth;
+                feature.line = line;
+
+                for (int j = begin; j < geometry.segments.size(); ++j)
+                    feature.length += geometry.segments[j].length();
+
+                Chain chain;
+                chain.begin = begin;
+                chain.end = geometry.segments.size();
+                chain.feature = geometry.features.size();
+
+                geometry.features.append(feature);
+                geometry.chains.append(chain);
+
+                previousHole = -1;
+            }
+            else if (below)
+            {
+                if (previousHole >= 0 && qAbs(geometry.holes[previousHole].x - holeX) <= Lateral &&
+                    qAbs(geometry.holes[previousHole].y - holeY) <= Lateral)
+                {
+                    ProgramFeature& hole = geometry.holes[previousHole];
+                    hole.depth = qMin(hole.depth, depth);
+                }
+                else
+                {
+                    ProgramFeature hole;
+                    hole.type = ProgramFeature::TypeHole;
+                    hole.x = holeX;
+                    hole.y = holeY;
+                    hole.depth = depth;
+                    hole.line = line;
+
+                    previousHole = geometry.holes.size();
+                    geometry.holes.append(hole);
+                }
+            }
+        }
+
+        if (!move)
+            break;
+
+        tool = move->tool;
+
+        if (move->type != ToolpathMove::TypeRapid)
+        {
+            if (!open)
+            {
+                open = true;
+                below = false;
+                lateral = false;
+                begin = geometry.segments.size();
+                line = move->line;
+            }
+
+            double bottom = qMin(z, move->z);
+
+            if (bottom < surface)
+            {
+                if (!below || bottom < depth)
+                {
+                    depth = bottom;
+                    holeX = (z < move->z) ? x : move->x;
+                    holeY = (z < move->z) ? y : move->y;
+                }
+
+                below = true;
+
+                if (move->isArc())
+                {
+                    appendArc(*move, x, y, tolerance, geometry.segments);
+                    lateral = true;
+                }
+                else if (qAbs(move->x - x) > Lateral || qAbs(move->y - y) > Lateral)
+                {
+                    geometry.segments.append(Segment(x, y, move->x, move->y));
+                    lateral = true;
+                }
+            }
+        }
+
+        x = move->x;
+        y = move->y;
+        z = move->z;
+    }
+}
+
+void matchHoles(const QVector<ProgramFeature>& reference,
+    const QVector<ProgramFeature>& candidate, double tolerance, VerificationReport& report)
+{
+    double size = qMax(tolerance, Lateral);
+
+    QHash<quint64, int> cells;
+    cells.reserve(candidate.size());
+
+    QVector<int> next(candidate.size(), -1);
+    QVector<bool> used(candidate.size(), false);
+
+    for (int i = 0; i < candidate.size(); ++i)
+    {
+        quint64 key = cellKey(cellOf(candidate[i].x, size), cellOf(candidate[i].y, size));
+        QHash<quint64, int>::iterator cell = cells.find(key);
+
+        if (cell == cells.end())
+        {
+            cells.insert(key, i);
+        }
+        else
+        {
+            next[i] = cell.value();
+            cell.value() = i;
+        }
+    }
+
+    foreach (const ProgramFeature& hole, reference)
+    {
+        qint64 cellX = cellOf(hole.x, size);
+        qint64 cellY = cellOf(hole.y, size);
+
+        int found = -1;
+        double nearest = tolerance;
+
+        for (int dx = -1; dx <= 1; ++dx)
+        {
+            for (int dy = -1; dy <= 1; ++dy)
+            {
+                QHash<quint64, int>::const_iterator cell =
+                    cells.constFind(cellKey(cellX + dx, cellY + dy));
+
+                if (cell == cells.constEnd())
+                    continue;
+
+                for (int j = cell.value(); j >= 0; j = next[j])
+                {
+                    if (used[j])
+                        continue;
+
+                    double distanceX = candidate[j].x - hole.x;
+                    double distanceY = candidate[j].y - hole.y;
+                    double distance = qSqrt(distanceX * distanceX + distanceY * distanceY);
+
+                    if (distance <= nearest)
+                    {
+                        nearest = distance;
+                        found = j;
+                    }
+                }
+            }
+        }
+
+        if (found < 0)
+        {
+            report.missing.append(hole);
+            continue;
+        }
+
+        used[found] = true;
+
+        report.maximumDeviation = qMax(report.maximumDeviation, nearest);
+        report.maximumDepthDeviation = qMax(report.maximumDepthDeviation,
+            qAbs(candidate[found].depth - hole.depth));
+    }
+
+    for (int i = 0; i < candidate.size(); ++i)
+    {
+        if (!used[i])
+            report.extra.append(candidate[i]);
+    }
+}
+
+// Checks every point of the chains against the cuts of the other program
+void matchChains(Geometry& geometry, const SegmentGrid& grid, double tolerance)
+{
+    const QVector<Segment>& segments = geometry.segments;
+    double spacing = qMax(tolerance, MinimumSpacing);
+
+    QtConcurrent::blockingMap(geometry.chains, [&segments, &grid, spacing](Chain& chain)
+    {
+        for (int i = chain.begin; i < chain.end && chain.matched; ++i)
+        {
+            const Segment& segment = segments[i];
+            int count = qMax(1, qCeil(segment.length() / spacing));
+
+            for (int j = (i == chain.begin) ? 0 : 1; j <= count; ++j)
+            {
+                double t = static_cast<double>(j) / count;
+                double distance = grid.distance(segment.x1 + (segment.x2 - segment.x1) * t,
+                    segment.y1 + (segment.y2 - segment.y1) * t);
+
+                if (distance < 0.0)
+                {
+                    chain.matched = false;
+                    break;
+                }
+
+                chain.deviation = qMax(chain.deviation, distance);
+            }
+        }
+    });
+}
+
+} // namespace
+
+
+VerificationReport ProgramVerifier::verify(const Toolpath& reference,
+    const Toolpath& candidate, double tolerance, double surface)
+{
+    VerificationReport report;
+
+    tolerance = qMax(tolerance, Lateral);
+
+    Geometry first;
+    Geometry second;
+
+    extract(reference, tolerance, surface, first);
+    extract(candidate, tolerance, surface, second);
+
+    report.referenceHoles = first.holes.size();
+    report.candidateHoles = second.holes.size();
+    report.referenceChains = first.chains.size();
+    report.candidateChains = second.chains.size();
+
+    matchHoles(first.holes, second.holes, tolerance, report);
+
+    matchChains(first, SegmentGrid(second.segments, tolerance), tolerance);
+    matchChains(second, SegmentGrid(first.segments, tolerance), tolerance);
+
+    foreach (const Chain& chain, first.chains)
+    {
+        if (chain.matched)
+            report.maximumDeviation = qMax(report.maximumDeviation, chain.deviation);
+        else
+            report.missing.append(first.features[chain.feature]);
+    }
+
+    foreach (const Chain& chain, second.chains)
+    {
+        if (chain.matched)
+            report.maximumDeviation = qMax(report.maximumDeviation, chain.deviation);
+        else
+            report.extra.append(second.features[chain.feature]);
+    }
+
+    return report;
+}
@@ -0,0 +1,103 @@
+//
+// This file is part of StepCAM 2.
+// Project URL: https://github.com/vdm-dev/StepCAM
+// Copyright (c) 2020  Dmitry Lavygin (vdm.inbox@gmail.com).
+//
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+//
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+//
+
+
+#ifndef PROGRAMVERIFIER_H
+#define PROGRAMVERIFIER_H
+
+
+#include <QVector>
+
+#include "toolpath.h"
+
+
+// A hole or a milling chain of a program, coordinates are in millimetres
+class ProgramFeature
+{
+public:
+    enum Type
+    {
+        TypeHole = 0,
+        TypeChain
+    };
+
+    ProgramFeature()
+        : type(TypeHole)
+        , x(0.0)
+        , y(0.0)
+        , depth(0.0)
+        , length(0.0)
+        , line(0)
+    {
+    }
+
+    int type;
+    double x;
+    double y;
+    double depth;
+    double length;
+    int line;
+};
+
+
+class VerificationReport
+{
+public:
+    VerificationReport()
+        : referenceHoles(0)
+        , candidateHoles(0)
+        , referenceChains(0)
+        , candidateChains(0)
+        , maximumDeviation(0.0)
+        , maximumDepthDeviation(0.0)
+    {
+    }
+
+    bool passed() const { return missing.isEmpty() && extra.isEmpty(); }
+
+    int referenceHoles;
+    int candidateHoles;
+    int referenceChains;
+    int candidateChains;
+
+    // The largest distance between the matched features in the XY plane and in Z
+    double maximumDeviation;
+    double maximumDepthDeviation;
+
+    // The features of the reference which the candidate lacks and vice versa
+    QVector<ProgramFeature> missing;
+    QVector<ProgramFeature> extra;
+};
+
+
+// Compares two programs by what they cut, regardless of the order of the features
+// and the direction of the cuts. Only the moves below the surface are taken into
+// account. A feed move series without any lateral movement is a hole, the holes
+// are paired through a spatial hash. Any other series is a chain, every point of a
+// chain must lie within the tolerance of a cut of the other program, so chains
+// split or joined differently still match.
+class ProgramVerifier
+{
+public:
+    static VerificationReport verify(const Toolpath& reference, const Toolpath& candidate,
+        double tolerance, double surface = 0.0);
+};
+
+
+#endif // PROGRAMVERIFIER_H
@@ -0,0 +1,24 @@
+PROJECT_ROOT = $${PWD}/..
+
+QT += core concurrent
+QT -= gui
+
+TARGET = verifier
+TEMPLATE = app
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+INCLUDEPATH += $${PROJECT_ROOT}/src
+
+SOURCES += \
+    $${PROJECT_ROOT}/src/gcodereader.cpp \
+    main.cpp \
+    programverifier.cpp
+
+HEADERS += \
+    $${PROJECT_ROOT}/src/gcodereader.h \
+    $${PROJECT_ROOT}/src/toolpath.h \
+    programverifier.h